@@ -5,9 +5,25 @@
 #ifndef PYULB_EXPRESSION_HH
 #define PYULB_EXPRESSION_HH
 
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
 #include <type_traits>
-
-#include "utils.hh"
+#include <utility>
+#include <valarray>
+
+/*
+ * Static expression templates: every node knows the types of its operands, so an expression like a * b + c is a
+ * single type, whose operator()(i) the compiler inlines completely. eval and Variable::operator= run one fused loop
+ * over the elements, which the compiler can vectorise:
+ *
+ *    Variable<double> a(n), b(n), c(n);
+ *    Variable<double> d = eval(a * b + c * 2.0);
+ *
+ * Variables are referenced by the nodes, all other operands are kept by value, so temporaries of an expression are
+ * safe while the variables have to outlive it.
+ */
 
 namespace Expr
 {
@@ -26,23 +42,37 @@ using is_number = std::disjunction<std::is_arithmetic<std::remove_reference_t<T>
 template<typename T>
 static constexpr bool is_number_v = is_number<T>::value;
 
-template<typename T>
-struct Expression;
-
-template<typename Left, typename Right, typename Result = decltype(std::declval<Left>() * std::declval<Right>())>
-struct Multiply;
+/**
+ * Base of all expressions, which forwards to the node type Derived without virtual calls.
+ */
+template<typename Derived>
+struct Expression
+{
+   const Derived& self() const noexcept
+   {
+      return static_cast<const Derived&>(*this);
+   }
 
-template<typename Left, typename Right, typename Result = decltype(std::declval<Left>() / std::declval<Right>())>
-struct Divide;
+   decltype(auto) operator()(std::size_t i) const
+   {
+      return self()(i);
+   }
 
-template<typename Left, typename Right, typename Result = decltype(std::declval<Left>() + std::declval<Right>())>
-struct Add;
+   /**
+    * @return The number of elements, 0 for constants, which have any size
+    */
+   std::size_t size() const
+   {
+      return self().size();
+   }
+};
 
-template<typename Left, typename Right, typename Result = decltype(std::declval<Left>() - std::declval<Right>())>
-struct Subtract;
+template<typename T>
+using is_expression = std::is_base_of<Expression<std::remove_cv_t<std::remove_reference_t<T>>>,
+                                      std::remove_cv_t<std::remove_reference_t<T>>>;
 
 template<typename T>
-struct Negate;
+static constexpr bool is_expression_v = is_expression<T>::value;
 
 template<typename T>
 struct Constant;
@@ -50,184 +80,164 @@ struct Constant;
 template<typename T>
 struct Variable;
 
+template<typename T>
+struct is_variable : std::false_type
+{
+};
+
+template<typename T>
+struct is_variable<Variable<T>> : std::true_type
+{
+};
+
+/**
+ * How a node keeps an operand given as E: variables given as lvalue by reference, everything else by value.
+ */
+template<typename E, typename R = std::remove_cv_t<std::remove_reference_t<E>>>
+using operand_t = std::conditional_t<std::is_lvalue_reference_v<E> && is_variable<R>::value, const R&, R>;
+
 template<typename T, typename R = std::remove_cv_t<std::remove_reference_t<T>>>
 std::enable_if_t<is_number_v<R>, Constant<R>>
 expr(T&& number)
 {
-   return Constant<R>(std::move(number));
+   return Constant<R>(std::forward<T>(number));
 }
 
-/*template<typename T, typename R = std::remove_reference_t<T>>
-std::enable_if_t<std::is_base_of_v<Expression<R>, R>, R>
-expr(T&& number)
-{
-   return number;
-}*/
-
 template<typename T>
-auto eval(const Expression<T>& expr);
-
-template<typename T>
-struct Expression
+std::enable_if_t<is_expression_v<T>, T&&>
+expr(T&& expression)
 {
-   virtual inline T operator()(std::size_t i) const = 0;
-
-   virtual std::size_t size() const = 0;
+   return std::forward<T>(expression);
+}
 
-   /*template<typename Right, typename R = std::remove_reference_t<Right>>
-   Multiply<T, R> operator*(Right&& r)
-   {
-      return Multiply<T, R>(std::move(*this), std::move(expr(r)));
-   }*/
+/**
+ * The node type for an operand given as E, numbers become constants.
+ */
+template<typename E>
+using node_t = std::conditional_t<is_number_v<E>, Constant<std::remove_cv_t<std::remove_reference_t<E>>>,
+                                  operand_t<E>>;
 
-   template<typename Right>
-   Variable<Right> operator=(const Expression<Right>& r)
-   {
-      return eval(r);
-   }
+template<typename E>
+using value_t = typename std::remove_cv_t<std::remove_reference_t<E>>::value_type;
 
-   template<typename Right>
-   Multiply<T, Right> operator*(const Expression<Right>& r)
-   {
-      return Multiply<T, Right>(std::move(*this), std::move(const_cast<Expression<Right>&>(r)));
-   }
-
-   template<typename Right>
-   Divide<T, Right> operator/(const Expression<Right>& r)
+template<typename Derived, typename Left, typename Right>
+struct BinaryOperator : public Expression<Derived>
+{
+   template<typename L, typename R>
+   BinaryOperator(L&& l, R&& r) : l(expr(std::forward<L>(l))), r(expr(std::forward<R>(r)))
    {
-      return Divide<T, Right>(std::move(*this), std::move(const_cast<Expression<Right>&>(r)));
+      if (this->l.size() != 0 && this->r.size() != 0 && this->l.size() != this->r.size())
+         throw std::length_error("Operands of an expression differ in size");
    }
 
-   template<typename Right>
-   Add<T, Right> operator+(const Expression<Right>& r)
+   auto operator()(std::size_t i) const
    {
-      return Add<T, Right>(std::move(*this), std::move(const_cast<Expression<Right>&>(r)));
+      return Derived::apply(l(i), r(i));
    }
 
-   template<typename Right>
-   Subtract<T, Right> operator-(const Expression<Right>& r)
+   std::size_t size() const
    {
-      return Subtract<T, Right>(std::move(*this), std::move(const_cast<Expression<Right>&>(r)));
+      return std::max(l.size(), r.size());
    }
 
-   template<typename Right>
-   Negate<T> operator-()
-   {
-      return Negate<T>(std::move(*this));
-   }
+   Left l;
+   Right r;
 };
 
-template<typename Left, typename Right, typename Result>
-struct BinaryOperator : public Expression<Result>
+template<typename Derived, typename T>
+struct UnaryOperator : public Expression<Derived>
 {
-   BinaryOperator(Expression<Left>&& l, Expression<Right>&& r) : l(std::forward<Expression<Left>&>(l)), r(std::forward<Expression<Right>&>(r)) {}
+   template<typename E>
+   explicit UnaryOperator(E&& expr) : expr(std::forward<E>(expr))
+   {}
 
-   std::size_t size() const override
+   auto operator()(std::size_t i) const
    {
-      return std::max(l.size(), r.size());
+      return Derived::apply(expr(i));
    }
 
-   Expression<Left>& l;
-   Expression<Right>& r;
-};
-
-template<typename T>
-struct UnaryOperator : public Expression<T>
-{
-   explicit UnaryOperator(Expression<T>&& expr) : expr(expr){}
-
-   std::size_t size() const override
+   std::size_t size() const
    {
       return expr.size();
    }
 
-   Expression<T>& expr;
+   T expr;
 };
 
 template<typename T>
-struct Negate : public UnaryOperator<T>
+struct Negate : public UnaryOperator<Negate<T>, T>
 {
-   using super = UnaryOperator<T>;
-   using super::UnaryOperator;
+   using value_type = decltype(-std::declval<value_t<T>>());
+   using UnaryOperator<Negate<T>, T>::UnaryOperator;
 
-   T operator()(std::size_t i) const override
+   static auto apply(const value_t<T>& value)
    {
-      return -super::expr(i);
+      return -value;
    }
 };
 
-template<typename Left, typename Right, typename Result>
-struct Add : public BinaryOperator<Left, Right, Result>
+template<typename Left, typename Right>
+struct Add : public BinaryOperator<Add<Left, Right>, Left, Right>
 {
-   using super = BinaryOperator<Left, Right, Result>;
-   using super::BinaryOperator;
+   using value_type = decltype(std::declval<value_t<Left>>() + std::declval<value_t<Right>>());
+   using BinaryOperator<Add<Left, Right>, Left, Right>::BinaryOperator;
 
-   Result operator()(std::size_t i) const override
+   static auto apply(const value_t<Left>& l, const value_t<Right>& r)
    {
-      return super::l(i) + super::r(i);
+      return l + r;
    }
 };
 
-template<typename Left, typename Right, typename Result>
-struct Subtract : public BinaryOperator<Left, Right, Result>
+template<typename Left, typename Right>
+struct Subtract : public BinaryOperator<Subtract<Left, Right>, Left, Right>
 {
-   using super = BinaryOperator<Left, Right, Result>;
-   using super::BinaryOperator;
+   using value_type = decltype(std::declval<value_t<Left>>() - std::declval<value_t<Right>>());
+   using BinaryOperator<Subtract<Left, Right>, Left, Right>::BinaryOperator;
 
-   Result operator()(std::size_t i) const override
+   static auto apply(const value_t<Left>& l, const value_t<Right>& r)
    {
-      return super::l(i) - super::r(i);
+      return l - r;
    }
 };
 
-template<typename Left, typename Right, typename Result>
-struct Multiply : public BinaryOperator<Left, Right, Result>
+template<typename Left, typename Right>
+struct Multiply : public BinaryOperator<Multiply<Left, Right>, Left, Right>
 {
-   using super = BinaryOperator<Left, Right, Result>;
-   using super::BinaryOperator;
+   using value_type = decltype(std::declval<value_t<Left>>() * std::declval<value_t<Right>>());
+   using BinaryOperator<Multiply<Left, Right>, Left, Right>::BinaryOperator;
 
-   Result operator()(std::size_t i) const override
+   static auto apply(const value_t<Left>& l, const value_t<Right>& r)
    {
-      return super::l(i) * super::r(i);
+      return l * r;
    }
 };
 
-template<typename Left, typename Right, typename Result>
-struct Divide : public BinaryOperator<Left, Right, Result>
+template<typename Left, typename Right>
+struct Divide : public BinaryOperator<Divide<Left, Right>, Left, Right>
 {
-   using super = BinaryOperator<Left, Right, Result>;
-   using super::BinaryOperator;
+   using value_type = decltype(std::declval<value_t<Left>>() / std::declval<value_t<Right>>());
+   using BinaryOperator<Divide<Left, Right>, Left, Right>::BinaryOperator;
 
-   Result operator()(std::size_t i) const override
+   static auto apply(const value_t<Left>& l, const value_t<Right>& r)
    {
-      return super::l(i) / super::r(i);
+      return l / r;
    }
 };
 
-template<typename Expr, template<typename> class Result>
-using enable_if_expression =
-std::enable_if_t<std::is_base_of_v<Expression, std::remove_reference_t<Expr>>,
-                 Result<std::remove_reference_t<Expr>>>;
-
-template<typename Left, template<typename, typename> class Operator, typename Right, typename Result = decltype(std::declval<Operator>()(0))>
-using enable_if_binary_expression =
-std::enable_if_t<std::conjunction_v<std::is_base_of<Expression<Result>, std::remove_reference_t<Left>>,
-        std::is_base_of<Expression<Result>, std::remove_reference_t<Right>>,
-        std::is_base_of<BinaryOperator<std::remove_reference_t<Left>, std::remove_reference_t<Right>, Result>,
-                              Operator<std::remove_reference_t<Left>, std::remove_reference_t<Right>>>>,
-        Operator<std::remove_reference_t<Left>, std::remove_reference_t<Right>>>;
-
 template<typename T>
-struct Constant : public Expression<T>
+struct Constant : public Expression<Constant<T>>
 {
-   explicit Constant(T&& value) : value(std::forward<T>(value)) {}
+   using value_type = T;
 
-   T operator()(std::size_t i) const override
+   explicit Constant(T value) : value(std::move(value))
+   {}
+
+   const T& operator()(std::size_t) const noexcept
    {
       return value;
    }
 
-   std::size_t size() const override
+   std::size_t size() const noexcept
    {
       return 0;
    }
@@ -236,13 +246,46 @@ struct Constant : public Expression<T>
 };
 
 template<typename T>
-struct Variable : public Expression<T>
+auto eval(const Expression<T>& expr);
+
+template<typename T>
+struct Variable : public Expression<Variable<T>>
 {
-   explicit Variable(std::valarray<T>&& value) : value(std::forward<std::valarray<T>>(value)) {}
+   using value_type = T;
 
-   explicit Variable(std::size_t s) : value(std::valarray<T>(s)) {}
+   explicit Variable(std::valarray<T>&& value) : value(std::move(value))
+   {}
 
-   T operator()(std::size_t i) const override
+   explicit Variable(std::size_t s) : value(std::valarray<T>(s))
+   {}
+
+   Variable(const Variable&) = default;
+
+   Variable(Variable&&) noexcept = default;
+
+   Variable& operator=(const Variable&) = default;
+
+   Variable& operator=(Variable&&) noexcept = default;
+
+   /**
+    * Evaluates the expression into the variable in one loop, the elements of the variable may be used by it.
+    */
+   template<typename E>
+   Variable& operator=(const Expression<E>& expression)
+   {
+      const E& e = expression.self();
+      const std::size_t n = e.size();
+      if (n != 0 && n != value.size())
+         value.resize(n);
+      T* out = std::begin(value);
+      const std::size_t m = value.size();
+#pragma omp simd
+      for (std::size_t i = 0; i < m; ++i)
+         out[i] = e(i);
+      return *this;
+   }
+
+   const T& operator()(std::size_t i) const
    {
       return value[i];
    }
@@ -252,12 +295,11 @@ struct Variable : public Expression<T>
       return value;
    }
 
-   std::size_t size() const override
+   std::size_t size() const
    {
       return value.size();
    }
 
-
    T& operator[](std::size_t i)
    {
       return value[i];
@@ -266,62 +308,55 @@ struct Variable : public Expression<T>
    std::valarray<T> value;
 };
 
-/*template<typename Left, template<typename, typename> class Operator, typename Right, typename Result = decltype(std::declval<Operator>()(0))>
-struct BinaryExpression : public Expression<Result>
+template<typename E>
+auto eval(const Expression<E>& expression)
 {
-   BinaryExpression(Left&& l, Right&& r) : op(std::forward<Left>(l), std::forward<Right>(r)) {}
-
-   Result operator()(std::size_t i) const override
-   {
-      return op(i);
-   }
+   Variable<typename E::value_type> result(expression.size());
+   result = expression;
+   return result;
+}
 
-   Operator<Left, Right> op;
-};*/
+template<typename Left, typename Right>
+using enable_if_binary_expression = std::enable_if_t<
+        (is_expression_v<Left> || is_expression_v<Right>) &&
+        (is_expression_v<Left> || is_number_v<Left>) && (is_expression_v<Right> || is_number_v<Right>)>;
 
-template<typename T>
-auto eval(const Expression<T>& expr)
+template<typename Left, typename Right, typename = enable_if_binary_expression<Left, Right>>
+Multiply<node_t<Left>, node_t<Right>> operator*(Left&& l, Right&& r)
 {
-   Variable<T> res(expr.size());
-   for (std::size_t i = 0; i < expr.size(); ++i) {
-      res[i] = expr(i);
-   }
-   return res;
+   return Multiply<node_t<Left>, node_t<Right>>(std::forward<Left>(l), std::forward<Right>(r));
 }
 
-/*template<typename Left, typename Right, typename L = std::remove_reference_t<Left>, typename R = std::remove_reference_t<Right>>
-enable_if_binary_expression<L, Multiply, R>
-operator*(Left&& l, Right&& r)
+template<typename Left, typename Right, typename = enable_if_binary_expression<Left, Right>>
+Divide<node_t<Left>, node_t<Right>> operator/(Left&& l, Right&& r)
 {
-   return enable_if_binary_expression<L, Multiply, R>(std::move(l), std::move(r));
+   return Divide<node_t<Left>, node_t<Right>>(std::forward<Left>(l), std::forward<Right>(r));
 }
 
-template<typename Left, typename Right, typename L = std::remove_reference_t<Left>, typename R = std::remove_reference_t<Right>>
-enable_if_binary_expression<L, typename Add<L, R>, R>
-operator+(Left&& l, Right&& r)
+template<typename Left, typename Right, typename = enable_if_binary_expression<Left, Right>>
+Add<node_t<Left>, node_t<Right>> operator+(Left&& l, Right&& r)
 {
-   return enable_if_binary_expression<L, Add, R>(std::move(l), std::move(r));
+   return Add<node_t<Left>, node_t<Right>>(std::forward<Left>(l), std::forward<Right>(r));
 }
 
-template<typename Expr>
-enable_if_expression<Expr, Negate>
-operator-(Expr&& expr)
+template<typename Left, typename Right, typename = enable_if_binary_expression<Left, Right>>
+Subtract<node_t<Left>, node_t<Right>> operator-(Left&& l, Right&& r)
 {
-   return enable_if_expression<Expr, Negate>(std::move(expr));
+   return Subtract<node_t<Left>, node_t<Right>>(std::forward<Left>(l), std::forward<Right>(r));
 }
 
-template<typename Left, typename Right>
-auto operator-(Left&& l, Right&& r)
+template<typename E, typename = std::enable_if_t<is_expression_v<E>>>
+Negate<node_t<E>> operator-(E&& expression)
 {
-   return l + (-r);
-}*/
+   return Negate<node_t<E>>(std::forward<E>(expression));
+}
 
-/*template<typename Expr>
-enable_if_binary_expression<Expr, Multiply, Expr>
-sq(Expr&& expr)
+template<typename E, typename = std::enable_if_t<is_expression_v<E>>>
+auto sq(E&& expression)
 {
-   return enable_if_binary_expression<Expr, Multiply, Expr>(std::move(expr), std::move(expr));
-}*/
+   // The operand is copied for the second factor, unless it is a variable
+   return Multiply<node_t<E>, node_t<E>>(expression, std::forward<E>(expression));
+}
 
 }
 
@@ -0,0 +1,375 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <string>
+
+#include "pyulb.h"
+#include "system.h"
+#include "systemview.h"
+
+using namespace std;
+using namespace mesh;
+
+/**
+ * A system opened by a view or a borrowed live system.
+ */
+struct pyulb_system_s
+{
+   shared_ptr<SystemView> view;
+   SystemBase* system = nullptr;
+   // Names of the segments of a borrowed system, which are only returned as string otherwise
+   vector<string> segment_names;
+};
+
+static thread_local string last_error;
+
+/**
+ * Runs f and turns exceptions into the error code and message of the C interface.
+ */
+static int guarded(const function<void()>& f)
+{
+   try {
+      f();
+      return 0;
+   } catch (const exception& e) {
+      last_error = e.what();
+   } catch (...) {
+      last_error = "Unknown error";
+   }
+   return -1;
+}
+
+static void checkHandle(const void* handle)
+{
+   if (handle == nullptr)
+      throw invalid_argument("Null handle");
+}
+
+/**
+ * Tensor of an array, which keeps the view the array belongs to alive.
+ */
+struct ManagedTensor
+{
+   DLManagedTensor tensor{};
+   shared_ptr<SystemView> owner;
+   array<int64_t, 8> shape{};
+   array<int64_t, 8> strides{};
+};
+
+/**
+ * @param strides The strides in elements, row major if empty
+ */
+static DLManagedTensor* exportTensor(const void* data, DLDataType dtype, const vector<int64_t>& shape,
+                                     const shared_ptr<SystemView>& owner, const vector<int64_t>& strides = {})
+{
+   auto managed = make_unique<ManagedTensor>();
+   if (shape.size() > managed->shape.size())
+      throw out_of_range("Too many tensor dimensions");
+   copy(shape.begin(), shape.end(), managed->shape.begin());
+   copy(strides.begin(), strides.end(), managed->strides.begin());
+   managed->owner = owner;
+   DLTensor& tensor = managed->tensor.dl_tensor;
+   tensor.data = const_cast<void*>(data);
+   tensor.device = {kDLCPU, 0};
+   tensor.ndim = static_cast<int32_t>(shape.size());
+   tensor.dtype = dtype;
+   tensor.shape = managed->shape.data();
+   tensor.strides = strides.empty() ? nullptr : managed->strides.data();
+   tensor.byte_offset = 0;
+   managed->tensor.manager_ctx = managed.get();
+   managed->tensor.deleter = [](DLManagedTensor* self) {
+      delete static_cast<ManagedTensor*>(self->manager_ctx);
+   };
+   return &managed.release()->tensor;
+}
+
+template<typename T>
+static DLDataType dataType()
+{
+   if constexpr (is_floating_point_v<T>)
+      return {kDLFloat, static_cast<uint8_t>(8 * sizeof(T)), 1};
+   else if constexpr (is_signed_v<T>)
+      return {kDLInt, static_cast<uint8_t>(8 * sizeof(T)), 1};
+   else
+      return {kDLUInt, static_cast<uint8_t>(8 * sizeof(T)), 1};
+}
+
+static DLDataType dataType(ScalarType type)
+{
+   switch (type) {
+      case ScalarType::FLOAT64:
+         return dataType<double>();
+      case ScalarType::FLOAT32:
+         return dataType<float>();
+      case ScalarType::INT64:
+         return dataType<int64_t>();
+      case ScalarType::INT32:
+         return dataType<int32_t>();
+      case ScalarType::UINT8:
+         return dataType<uint8_t>();
+   }
+   throw logic_error("Unknown scalar type");
+}
+
+static DLManagedTensor* exportIDs(const ID* data, size_t size, const shared_ptr<SystemView>& owner)
+{
+   return exportTensor(data, dataType<ID>(), {static_cast<int64_t>(size)}, owner);
+}
+
+static DLManagedTensor* exportIDs(const ArrayView<ID>& ids, const shared_ptr<SystemView>& owner)
+{
+   return exportIDs(ids.data(), ids.size(), owner);
+}
+
+/**
+ * The IDs of the simplices of a segment or interface of a borrowed system.
+ */
+static DLManagedTensor* exportReferences(const SegmentBase* segment, uint simplex_dim)
+{
+   const vector<ID>* ids = segment->mesh()->simplices(simplex_dim).referencedIDs();
+   if (ids == nullptr)
+      throw logic_error("Segment mesh does not refer to the system mesh");
+   return exportIDs(ids->data(), ids->size(), nullptr);
+}
+
+/**
+ * The shape of an attribute, with the number of entities in front of the extents. Extents of 1 are left out.
+ */
+static vector<int64_t> attributeShape(const vector<size_t>& extents, size_t size)
+{
+   vector<int64_t> shape{static_cast<int64_t>(size)};
+   for (const size_t extent : extents) {
+      if (extent == 1)
+         continue;
+      if (extent == 0 || shape.front() % extent != 0)
+         throw runtime_error("Attribute size does not match its extents");
+      shape.front() /= static_cast<int64_t>(extent);
+      shape.push_back(static_cast<int64_t>(extent));
+   }
+   return shape;
+}
+
+extern "C" {
+
+const char* pyulb_last_error(void)
+{
+   return last_error.c_str();
+}
+
+int pyulb_system_open(const char* path, pyulb_system* system)
+{
+   return guarded([&] {
+      auto handle = make_unique<pyulb_system_s>();
+      handle->view = SystemView::open(path);
+      *system = handle.release();
+   });
+}
+
+int pyulb_system_attach(const char* name, pyulb_system* system)
+{
+   return guarded([&] {
+      auto handle = make_unique<pyulb_system_s>();
+      handle->view = SystemView::attach(name);
+      *system = handle.release();
+   });
+}
+
+int pyulb_system_borrow(uint64_t address, uint32_t dim, uint32_t topdim, pyulb_system* system)
+{
+   return guarded([&] {
+      checkHandle(reinterpret_cast<const void*>(address));
+      auto handle = make_unique<pyulb_system_s>();
+      switch (10 * dim + topdim) {
+         case 11:
+            handle->system = reinterpret_cast<System<1, 1>*>(address);
+            break;
+         case 21:
+            handle->system = reinterpret_cast<System<2, 1>*>(address);
+            break;
+         case 22:
+            handle->system = reinterpret_cast<System<2, 2>*>(address);
+            break;
+         case 31:
+            handle->system = reinterpret_cast<System<3, 1>*>(address);
+            break;
+         case 32:
+            handle->system = reinterpret_cast<System<3, 2>*>(address);
+            break;
+         case 33:
+            handle->system = reinterpret_cast<System<3, 3>*>(address);
+            break;
+         default:
+            throw invalid_argument("Unsupported system dimensions");
+      }
+      *system = handle.release();
+   });
+}
+
+void pyulb_system_free(pyulb_system system)
+{
+   delete system;
+}
+
+int pyulb_system_dimensions(pyulb_system system, uint32_t* dim, uint32_t* topdim)
+{
+   return guarded([&] {
+      checkHandle(system);
+      if (system->view) {
+         *dim = system->view->getDimension();
+         *topdim = system->view->getTopologyDimension();
+      } else {
+         *dim = system->system->mesh()->getDimension();
+         *topdim = system->system->mesh()->getTopologyDimension();
+      }
+   });
+}
+
+int pyulb_system_num_segments(pyulb_system system, size_t* nsegments)
+{
+   return guarded([&] {
+      checkHandle(system);
+      *nsegments = system->view ? system->view->getNumSegments() : system->system->getNumSegments();
+   });
+}
+
+int pyulb_system_segment_name(pyulb_system system, size_t segment, const char** name)
+{
+   return guarded([&] {
+      checkHandle(system);
+      if (system->view) {
+         *name = system->view->segmentName(segment).c_str();
+         return;
+      }
+      auto& names = system->segment_names;
+      for (size_t iseg = names.size(); iseg < system->system->getNumSegments(); ++iseg)
+         names.push_back(system->system->segment(static_cast<ID>(iseg))->getName());
+      if (segment >= names.size())
+         throw out_of_range("Segment index out of range");
+      *name = names[segment].c_str();
+   });
+}
+
+int pyulb_system_coordinates(pyulb_system system, DLManagedTensor** tensor)
+{
+   return guarded([&] {
+      checkHandle(system);
+      if (system->view) {
+         const ArrayView<double> coordinates = system->view->coordinates();
+         const int64_t dim = system->view->getDimension();
+         *tensor = exportTensor(coordinates.data(), dataType<double>(),
+                                {static_cast<int64_t>(coordinates.size()) / dim, dim}, system->view);
+      } else {
+         const MeshBase* mesh = system->system->mesh();
+         const vector<double>& coordinates = mesh->getPointList();
+         const int64_t dim = mesh->getDimension();
+         *tensor = exportTensor(coordinates.data(), dataType<double>(),
+                                {static_cast<int64_t>(coordinates.size()) / dim, dim}, nullptr);
+      }
+   });
+}
+
+int pyulb_system_connectivity(pyulb_system system, uint32_t simplex_dim, DLManagedTensor** tensor)
+{
+   return guarded([&] {
+      checkHandle(system);
+      const int64_t nvertices = simplex_dim + 1;
+      if (system->view) {
+         const ArrayView<ID> ids = system->view->connectivity(simplex_dim);
+         *tensor = exportTensor(ids.data(), dataType<ID>(), {static_cast<int64_t>(ids.size()) / nvertices, nvertices},
+                                system->view);
+      } else {
+         const vector<ID>& ids = system->system->mesh()->simplices(simplex_dim).connectivity();
+         *tensor = exportTensor(ids.data(), dataType<ID>(), {static_cast<int64_t>(ids.size()) / nvertices, nvertices},
+                                nullptr);
+      }
+   });
+}
+
+int pyulb_system_segment_simplices(pyulb_system system, size_t segment, uint32_t simplex_dim,
+                                   DLManagedTensor** tensor)
+{
+   return guarded([&] {
+      checkHandle(system);
+      if (system->view) {
+         *tensor = exportIDs(system->view->segmentSimplices(segment, simplex_dim), system->view);
+         return;
+      }
+      const SegmentBase* seg = system->system->segment(static_cast<ID>(segment));
+      if (seg == nullptr)
+         throw out_of_range("Segment index out of range");
+      *tensor = exportReferences(seg, simplex_dim);
+   });
+}
+
+int pyulb_system_interface_simplices(pyulb_system system, size_t segment1, size_t segment2, uint32_t simplex_dim,
+                                     DLManagedTensor** tensor)
+{
+   return guarded([&] {
+      checkHandle(system);
+      const ID seg1 = static_cast<ID>(segment1);
+      const ID seg2 = static_cast<ID>(segment2);
+      if (system->view) {
+         for (size_t iint = 0; iint < system->view->getNumInterfaces(); ++iint) {
+            const auto segs = system->view->interfaceSegments(iint);
+            if (minmax(segs.first, segs.second) == minmax(seg1, seg2)) {
+               *tensor = exportIDs(system->view->interfaceSimplices(iint, simplex_dim), system->view);
+               return;
+            }
+         }
+         *tensor = exportIDs(nullptr, 0, nullptr);
+         return;
+      }
+      const SegmentBase* intf = system->system->interface(seg1, seg2);
+      if (intf == nullptr)
+         intf = system->system->interface(seg2, seg1);
+      *tensor = intf != nullptr ? exportReferences(intf, simplex_dim) : exportIDs(nullptr, 0, nullptr);
+   });
+}
+
+int pyulb_system_attribute(pyulb_system system, const char* name, DLManagedTensor** tensor)
+{
+   return guarded([&] {
+      checkHandle(system);
+      if (system->view) {
+         for (const auto& attribute : system->view->attributes()) {
+            if (attribute.name == name) {
+               *tensor = exportTensor(attribute.data, dataType(attribute.type),
+                                      attributeShape(attribute.extents, attribute.size), system->view);
+               return;
+            }
+         }
+         throw out_of_range(string("No attribute named ") + name);
+      }
+      const AttributeBase* attribute = system->system->getAttribute(name);
+      vector<size_t> extents;
+      for (size_t d = 0; d < attribute->getExtents().getDimension(); ++d)
+         extents.push_back(attribute->getExtents().getExtent(d));
+      const size_t nentities = attribute->getNumEntities();
+      const vector<int64_t> shape = attributeShape(extents, nentities * attribute->getExtents().getSize());
+      vector<int64_t> strides;
+      switch (attribute->getLayoutBlock()) {
+         case 1:
+            break;
+         case 0:
+            // Every component is an array over the entities
+            strides.resize(shape.size());
+            strides.front() = 1;
+            if (shape.size() > 1) {
+               strides.back() = static_cast<int64_t>(nentities);
+               for (size_t d = shape.size() - 2; d > 0; --d)
+                  strides[d] = strides[d + 1] * shape[d + 1];
+            }
+            break;
+         default:
+            throw logic_error(string("Attribute ") + name + " is stored in blocks, which have no strided view");
+      }
+      *tensor = exportTensor(attribute->data(), dataType(attribute->getScalarType()), shape, nullptr, strides);
+   });
+}
+
+}
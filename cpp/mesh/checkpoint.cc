@@ -0,0 +1,440 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef ZLIB_ENABLED
+#include <zlib.h>
+#endif
+
+#include "checkpoint.h"
+#include "checkpointformat.hh"
+#include "system.h"
+
+using namespace std;
+
+namespace mesh
+{
+
+struct CheckpointWriter::Snapshot
+{
+   struct Entry
+   {
+      string name;
+      checkpoint::EntryHeader header;
+      vector<uint64_t> extents;
+      // Values in AoS order and as stored, the capacity is kept from snapshot to snapshot
+      vector<char> values;
+      vector<char> stored;
+   };
+
+   uint64_t step = 0;
+   double time = 0.0;
+   vector<Entry> entries;
+};
+
+static checkpoint::FileHeader fileHeader(const char (&magic)[8])
+{
+   checkpoint::FileHeader header{};
+   memcpy(header.magic, magic, sizeof(header.magic));
+   header.version = checkpoint::version;
+   header.byte_order = checkpoint::byte_order_mark;
+   return header;
+}
+
+static void checkHeader(const MappedFile& file, const char (&magic)[8])
+{
+   checkpoint::FileHeader header{};
+   if (file.size() < sizeof(header))
+      throw runtime_error(file.path() + " is not a checkpoint file");
+   memcpy(&header, file.data(), sizeof(header));
+   if (memcmp(header.magic, magic, sizeof(header.magic)) != 0)
+      throw runtime_error(file.path() + " is not a checkpoint file");
+   if (header.byte_order != checkpoint::byte_order_mark)
+      throw runtime_error(file.path() + " was written with a different byte order");
+   if (header.version != checkpoint::version)
+      throw runtime_error("Unsupported checkpoint file version in " + file.path());
+}
+
+/**
+ * @return The complete entries of an index file, a partially written last entry is left out
+ */
+static vector<checkpoint::IndexEntry> readIndex(const MappedFile& file)
+{
+   checkHeader(file, checkpoint::index_magic);
+   vector<checkpoint::IndexEntry> entries((file.size() - sizeof(checkpoint::FileHeader))
+                                          / sizeof(checkpoint::IndexEntry));
+   if (!entries.empty())
+      memcpy(entries.data(), file.data() + sizeof(checkpoint::FileHeader),
+             entries.size() * sizeof(checkpoint::IndexEntry));
+   return entries;
+}
+
+CheckpointWriter::CheckpointWriter(const string& path, const CheckpointOptions& options)
+        : path(path), options(options)
+{
+   if (options.buffers == 0)
+      throw invalid_argument("Checkpoints need at least one buffer");
+#ifndef ZLIB_ENABLED
+   this->options.compress = false;
+#endif
+   const string index_path = path + ".index";
+   if (filesystem::exists(path)) {
+      // The series is continued after its last complete record
+      if (!filesystem::exists(index_path))
+         throw runtime_error(path + " exists, but has no index");
+      checkHeader(MappedFile(path), checkpoint::magic);
+      const vector<checkpoint::IndexEntry> entries = readIndex(MappedFile(index_path));
+      end = sizeof(checkpoint::FileHeader);
+      if (!entries.empty()) {
+         end = entries.back().offset + entries.back().size;
+         has_steps = true;
+         last_step = entries.back().step;
+      }
+      if (filesystem::file_size(path) < end)
+         throw runtime_error(path + " is shorter than its index");
+      filesystem::resize_file(path, end);
+      filesystem::resize_file(index_path, sizeof(checkpoint::FileHeader)
+                                          + entries.size() * sizeof(checkpoint::IndexEntry));
+      data.open(path, ios::binary | ios::app);
+      index.open(index_path, ios::binary | ios::app);
+   } else {
+      data.open(path, ios::binary | ios::trunc);
+      index.open(index_path, ios::binary | ios::trunc);
+      const checkpoint::FileHeader data_header = fileHeader(checkpoint::magic);
+      const checkpoint::FileHeader index_header = fileHeader(checkpoint::index_magic);
+      data.write(reinterpret_cast<const char*>(&data_header), sizeof(data_header));
+      index.write(reinterpret_cast<const char*>(&index_header), sizeof(index_header));
+      data.flush();
+      index.flush();
+      end = sizeof(checkpoint::FileHeader);
+   }
+   if (!data || !index)
+      throw runtime_error("Cannot open checkpoint file " + path);
+   thread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+   try {
+      close();
+   } catch (...) {
+   }
+}
+
+void CheckpointWriter::write(const SystemBase& system, uint64_t step, double time, const vector<string>& names)
+{
+   lock_guard<std::mutex> serial(writing);
+   if (has_steps && step <= last_step)
+      throw invalid_argument("Steps of a checkpoint series have to grow");
+   unique_ptr<Snapshot> snapshot;
+   {
+      unique_lock<std::mutex> lock(mutex);
+      if (closing)
+         throw logic_error("Checkpoint writer is closed");
+      // Backpressure: wait for a free buffer
+      changed.wait(lock, [&] { return !free.empty() || nbuffers < options.buffers || error; });
+      if (error)
+         rethrow_exception(error);
+      if (free.empty()) {
+         snapshot = make_unique<Snapshot>();
+         ++nbuffers;
+      } else {
+         snapshot = move(free.back());
+         free.pop_back();
+      }
+   }
+
+   try {
+      const vector<string> all = names.empty() ? system.getAttributeNames() : vector<string>();
+      const vector<string>& selected = names.empty() ? all : names;
+      snapshot->step = step;
+      snapshot->time = time;
+      snapshot->entries.resize(selected.size());
+      for (size_t i = 0; i < selected.size(); ++i) {
+         const AttributeBase* attribute = system.getAttribute(selected[i]);
+         Snapshot::Entry& entry = snapshot->entries[i];
+         entry.name = selected[i];
+         entry.extents.clear();
+         for (size_t d = 0; d < attribute->getExtents().getDimension(); ++d)
+            entry.extents.push_back(attribute->getExtents().getExtent(d));
+         entry.header = checkpoint::EntryHeader{};
+         entry.header.location = attribute->getLocation();
+         entry.header.type = static_cast<uint32_t>(attribute->getScalarType());
+         entry.header.ndims = uint32_t(entry.extents.size());
+         entry.header.name_length = uint32_t(entry.name.size());
+         entry.header.nentities = attribute->getNumEntities();
+         entry.header.size = entry.header.nentities * attribute->getExtents().getSize()
+                             * scalarSize(attribute->getScalarType());
+         entry.values.resize(entry.header.size);
+         attribute->copyTo(entry.values.data());
+      }
+   } catch (...) {
+      lock_guard<std::mutex> lock(mutex);
+      free.push_back(move(snapshot));
+      throw;
+   }
+
+   lock_guard<std::mutex> lock(mutex);
+   pending.push_back(move(snapshot));
+   has_steps = true;
+   last_step = step;
+   changed.notify_all();
+}
+
+void CheckpointWriter::flush()
+{
+   unique_lock<std::mutex> lock(mutex);
+   changed.wait(lock, [&] { return pending.empty() && !busy; });
+   if (error)
+      rethrow_exception(error);
+}
+
+void CheckpointWriter::close()
+{
+   {
+      lock_guard<std::mutex> lock(mutex);
+      closing = true;
+   }
+   changed.notify_all();
+   if (thread.joinable())
+      thread.join();
+   data.close();
+   index.close();
+   if (error)
+      rethrow_exception(error);
+}
+
+void CheckpointWriter::run()
+{
+   unique_lock<std::mutex> lock(mutex);
+   while (true) {
+      changed.wait(lock, [&] { return !pending.empty() || closing; });
+      if (pending.empty())
+         return;
+      unique_ptr<Snapshot> snapshot = move(pending.front());
+      pending.pop_front();
+      busy = true;
+      // After an error the series ends with the last complete record
+      const bool failed = bool(error);
+      lock.unlock();
+      exception_ptr failure = nullptr;
+      try {
+         if (!failed)
+            append(*snapshot);
+      } catch (...) {
+         failure = current_exception();
+      }
+      lock.lock();
+      if (failure && !error)
+         error = failure;
+      busy = false;
+      free.push_back(move(snapshot));
+      changed.notify_all();
+   }
+}
+
+/**
+ * Stores the values of the entry compressed, if that makes them smaller.
+ */
+static void storeValues(vector<char>& values, vector<char>& stored, checkpoint::EntryHeader& header, bool compress,
+                        int level)
+{
+   header.compression = checkpoint::NONE;
+   header.stored = header.size;
+#ifdef ZLIB_ENABLED
+   if (compress && !values.empty()) {
+      uLongf size = compressBound(values.size());
+      stored.resize(size);
+      if (compress2(reinterpret_cast<Bytef*>(stored.data()), &size, reinterpret_cast<const Bytef*>(values.data()),
+                    values.size(), level) != Z_OK)
+         throw runtime_error("Compressing checkpoint values failed");
+      if (size < values.size()) {
+         stored.resize(size);
+         header.compression = checkpoint::ZLIB;
+         header.stored = size;
+      }
+   }
+#endif
+}
+
+void CheckpointWriter::append(Snapshot& snapshot)
+{
+   checkpoint::RecordHeader record{};
+   record.step = snapshot.step;
+   record.time = snapshot.time;
+   record.nentries = snapshot.entries.size();
+   record.size = sizeof(record);
+   for (Snapshot::Entry& entry : snapshot.entries) {
+      storeValues(entry.values, entry.stored, entry.header, options.compress, options.level);
+      record.size += sizeof(entry.header) + entry.extents.size() * sizeof(uint64_t) + entry.name.size()
+                     + entry.header.stored;
+   }
+   data.write(reinterpret_cast<const char*>(&record), sizeof(record));
+   for (const Snapshot::Entry& entry : snapshot.entries) {
+      data.write(reinterpret_cast<const char*>(&entry.header), sizeof(entry.header));
+      data.write(reinterpret_cast<const char*>(entry.extents.data()), entry.extents.size() * sizeof(uint64_t));
+      data.write(entry.name.data(), entry.name.size());
+      const vector<char>& values = entry.header.compression == checkpoint::NONE ? entry.values : entry.stored;
+      data.write(values.data(), entry.header.stored);
+   }
+   data.flush();
+   if (!data)
+      throw runtime_error("Writing checkpoint file " + path + " failed");
+
+   // The record only counts once it is indexed
+   const checkpoint::IndexEntry entry{record.step, record.time, end, record.size};
+   index.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+   index.flush();
+   if (!index)
+      throw runtime_error("Writing checkpoint index " + path + ".index failed");
+   end += record.size;
+}
+
+struct CheckpointReader::Record
+{
+   struct Entry
+   {
+      checkpoint::EntryHeader header;
+      vector<uint64_t> extents;
+      string name;
+      const char* values;
+   };
+
+   vector<Entry> entries;
+};
+
+CheckpointReader::CheckpointReader(const string& path) : data(path)
+{
+   checkHeader(data, checkpoint::magic);
+   for (const checkpoint::IndexEntry& entry : readIndex(MappedFile(path + ".index"))) {
+      if (entry.offset + entry.size > data.size())
+         break;
+      if (!steps.empty() && entry.step <= steps.back().step)
+         throw runtime_error("Steps in " + path + " are not sorted");
+      steps.push_back({entry.step, entry.time});
+      offsets.push_back(entry.offset);
+      sizes.push_back(entry.size);
+   }
+}
+
+bool CheckpointReader::hasStep(uint64_t step) const
+{
+   const auto it = lower_bound(steps.begin(), steps.end(), step,
+                               [](const CheckpointStep& s, uint64_t step) { return s.step < step; });
+   return it != steps.end() && it->step == step;
+}
+
+CheckpointReader::Record CheckpointReader::record(uint64_t step) const
+{
+   const auto it = lower_bound(steps.begin(), steps.end(), step,
+                               [](const CheckpointStep& s, uint64_t step) { return s.step < step; });
+   if (it == steps.end() || it->step != step)
+      throw out_of_range("No step " + to_string(step) + " in " + data.path());
+   const size_t i = it - steps.begin();
+   const char* p = data.data() + offsets[i];
+   const char* last = p + sizes[i];
+   // Counts in the headers are checked against the remaining bytes, before anything is allocated for them
+   const auto check = [&](uint64_t count, size_t size) {
+      if (count > size_t(last - p) / size)
+         throw runtime_error("Corrupt record in " + data.path());
+   };
+   const auto take = [&](void* out, size_t n) {
+      check(n, 1);
+      memcpy(out, p, n);
+      p += n;
+   };
+
+   checkpoint::RecordHeader header{};
+   take(&header, sizeof(header));
+   if (header.size != sizes[i] || header.step != step)
+      throw runtime_error("Corrupt record in " + data.path());
+   check(header.nentries, sizeof(checkpoint::EntryHeader));
+   Record record;
+   record.entries.resize(header.nentries);
+   for (Record::Entry& entry : record.entries) {
+      take(&entry.header, sizeof(entry.header));
+      check(entry.header.ndims, sizeof(uint64_t));
+      entry.extents.resize(entry.header.ndims);
+      take(entry.extents.data(), entry.extents.size() * sizeof(uint64_t));
+      check(entry.header.name_length, 1);
+      entry.name.resize(entry.header.name_length);
+      take(entry.name.data(), entry.name.size());
+      check(entry.header.stored, 1);
+      entry.values = p;
+      p += entry.header.stored;
+   }
+   return record;
+}
+
+vector<string> CheckpointReader::getAttributeNames(uint64_t step) const
+{
+   vector<string> names;
+   for (const Record::Entry& entry : record(step).entries)
+      names.push_back(entry.name);
+   return names;
+}
+
+void CheckpointReader::read(const Record& record, size_t i, AttributeBase& attribute) const
+{
+   const Record::Entry& entry = record.entries[i];
+   const string& path = data.path();
+   const AttributeExtent& extents = attribute.getExtents();
+   bool same = entry.header.location == attribute.getLocation()
+               && entry.header.type == static_cast<uint32_t>(attribute.getScalarType())
+               && entry.extents.size() == extents.getDimension()
+               && entry.header.nentities == attribute.getNumEntities();
+   for (size_t d = 0; same && d < entry.extents.size(); ++d)
+      same = entry.extents[d] == extents.getExtent(d);
+   if (!same)
+      throw logic_error("Attribute " + entry.name + " in " + path + " does not match the attribute of the system");
+   const size_t n = entry.header.nentities * extents.getSize();
+   if (entry.header.size != n * scalarSize(attribute.getScalarType()))
+      throw runtime_error("Corrupt record in " + path);
+   if (entry.header.compression == checkpoint::NONE) {
+      if (entry.header.stored != entry.header.size)
+         throw runtime_error("Corrupt record in " + path);
+      // The mapping is not necessarily aligned for the values
+      vector<char> values(entry.values, entry.values + entry.header.size);
+      attribute.assign(values.data(), n);
+      return;
+   }
+#ifdef ZLIB_ENABLED
+   vector<char> values(entry.header.size);
+   uLongf size = values.size();
+   if (uncompress(reinterpret_cast<Bytef*>(values.data()), &size, reinterpret_cast<const Bytef*>(entry.values),
+                  entry.header.stored) != Z_OK || size != values.size())
+      throw runtime_error("Corrupt compressed values of " + entry.name + " in " + path);
+   attribute.assign(values.data(), n);
+#else
+   throw runtime_error("Reading compressed checkpoints requires zlib, which was not available at build time");
+#endif
+}
+
+void CheckpointReader::read(uint64_t step, AttributeBase& attribute) const
+{
+   const string name = attribute.getName();
+   const Record values = record(step);
+   for (size_t i = 0; i < values.entries.size(); ++i) {
+      if (values.entries[i].name == name) {
+         read(values, i, attribute);
+         return;
+      }
+   }
+   throw out_of_range("No attribute " + name + " at step " + to_string(step) + " in " + data.path());
+}
+
+void CheckpointReader::read(uint64_t step, SystemBase& system) const
+{
+   const vector<string> names = system.getAttributeNames();
+   const Record values = record(step);
+   for (size_t i = 0; i < values.entries.size(); ++i)
+      if (binary_search(names.begin(), names.end(), values.entries[i].name))
+         read(values, i, *system.getAttribute(values.entries[i].name));
+}
+
+}
@@ -0,0 +1,79 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_CHECKPOINTFORMAT_HH
+#define PYULB_CHECKPOINTFORMAT_HH
+
+#include <cstdint>
+
+/*
+ * Checkpoint time series, in native byte order. Both files are only ever appended to. The data file holds
+ *
+ *   FileHeader
+ *   records, a RecordHeader followed by nentries entries: EntryHeader, uint64 extents[ndims], name, stored values
+ *
+ * The values of an entry are the values of an attribute in AoS order, zlib compressed if compression is ZLIB. The
+ * index file <path>.index holds a FileHeader and one IndexEntry per record, which is appended once the record is
+ * complete, so records without index entry are incomplete and dropped when the series is opened again.
+ */
+
+namespace mesh
+{
+namespace checkpoint
+{
+
+constexpr char magic[8] = {'P', 'Y', 'M', 'E', 'S', 'H', 'T', 'S'};
+constexpr char index_magic[8] = {'P', 'Y', 'M', 'E', 'S', 'H', 'T', 'I'};
+constexpr uint32_t version = 1;
+constexpr uint32_t byte_order_mark = 0x01020304;
+
+enum Compression : uint32_t
+{
+   NONE = 0,
+   ZLIB = 1
+};
+
+struct FileHeader
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t byte_order;
+   uint64_t reserved[2];
+};
+
+struct RecordHeader
+{
+   uint64_t step;
+   double time;
+   uint64_t nentries;
+   // Bytes of the record including this header
+   uint64_t size;
+};
+
+struct EntryHeader
+{
+   uint32_t location;
+   uint32_t type;
+   uint32_t ndims;
+   uint32_t name_length;
+   uint32_t compression;
+   uint32_t reserved;
+   uint64_t nentities;
+   // Bytes of the values before and after compression
+   uint64_t size;
+   uint64_t stored;
+};
+
+struct IndexEntry
+{
+   uint64_t step;
+   double time;
+   uint64_t offset;
+   uint64_t size;
+};
+
+}
+}
+
+#endif //PYULB_CHECKPOINTFORMAT_HH
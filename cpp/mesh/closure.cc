@@ -0,0 +1,126 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <numeric>
+#include <stdexcept>
+
+#include "closure.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+vector<uint> localSimplices(uint topdim, uint dim)
+{
+   vector<uint> masks;
+   for (uint mask = 1; mask < (1u << (topdim + 1)); ++mask)
+      if (static_cast<uint>(__builtin_popcount(mask)) == dim + 1)
+         masks.push_back(mask);
+   // Lexicographic order of the vertex lists, e.g. 01, 02, 03, 12, 13, 23
+   sort(masks.begin(), masks.end(), [](uint a, uint b) {
+      while (a != 0 && b != 0 && (a & -a) == (b & -b)) {
+         a &= a - 1;
+         b &= b - 1;
+      }
+      return (a & -a) < (b & -b);
+   });
+   return masks;
+}
+
+/**
+ * Numbers the unique simplices with N vertices of all cells. Every cell simplex gets a key of its sorted vertices,
+ * the keys are sorted and the position among the unique keys is the ID.
+ */
+template<uint N>
+static void numberSimplices(const vector<ID>& cells, uint topdim, vector<ID>& simplices, vector<ID>& incidence)
+{
+   const vector<uint> locals = localSimplices(topdim, N - 1);
+   const size_t nlocal = locals.size();
+   const size_t ncells = cells.size() / (topdim + 1);
+   vector<pair<array<ID, N>, size_t>> keys(ncells * nlocal);
+#pragma omp parallel for
+   for (long cid = 0; cid < (long) ncells; ++cid) {
+      for (size_t ilocal = 0; ilocal < nlocal; ++ilocal) {
+         auto& [key, index] = keys[cid * nlocal + ilocal];
+         size_t iv = 0;
+         for (uint lv = 0; lv <= topdim; ++lv)
+            if (locals[ilocal] & (1u << lv))
+               key[iv++] = cells[cid * (topdim + 1) + lv];
+         sort(key.begin(), key.end());
+         index = cid * nlocal + ilocal;
+      }
+   }
+   sort(keys.begin(), keys.end());
+
+   incidence.resize(keys.size());
+   simplices.clear();
+   ID id = -1;
+   for (size_t i = 0; i < keys.size(); ++i) {
+      if (i == 0 || keys[i].first != keys[i - 1].first) {
+         ++id;
+         simplices.insert(simplices.end(), keys[i].first.begin(), keys[i].first.end());
+      }
+      incidence[keys[i].second] = id;
+   }
+}
+
+Closure::Closure(const vector<ID>& cells, uint topdim) : topdim(topdim)
+{
+   if (topdim == 0 || topdim > 3)
+      throw logic_error("The closure is only defined for cells of dimension 1 to 3");
+   incidence[0] = cells;
+   for (uint k = 1; k < topdim; ++k) {
+      switch (k) {
+         case 1:
+            numberSimplices<2>(cells, topdim, simplices[k], incidence[k]);
+            break;
+         case 2:
+            numberSimplices<3>(cells, topdim, simplices[k], incidence[k]);
+            break;
+      }
+   }
+
+   const vector<ID>& cell_facets = incidence[topdim - 1];
+   const size_t nfacets = topdim + 1;
+   const size_t nfacet_ids = topdim == 1
+                             ? (cells.empty() ? 0 : *max_element(cells.begin(), cells.end()) + 1)
+                             : simplices[topdim - 1].size() / topdim;
+   facet_offsets.assign(nfacet_ids + 1, 0);
+   for (const ID fid : cell_facets)
+      ++facet_offsets[fid + 1];
+   partial_sum(facet_offsets.begin(), facet_offsets.end(), facet_offsets.begin());
+   facet_cells.resize(cell_facets.size());
+   vector<size_t> filled(facet_offsets.begin(), facet_offsets.end() - 1);
+   for (size_t i = 0; i < cell_facets.size(); ++i)
+      facet_cells[filled[cell_facets[i]]++] = i / nfacets;
+}
+
+void appendClosure(MeshBase* mesh, uint dim, vector<double>&& coordinates, const vector<ID>& cells,
+                   const Closure& closure)
+{
+   const uint topdim = closure.topdim;
+   mesh->getPointList() = move(coordinates);
+   vector<ID> ids(mesh->getPointList().size() / dim);
+   iota(ids.begin(), ids.end(), 0);
+   mesh->simplices(0).append(ids.data(), ids.size());
+   for (uint k = 1; k < topdim; ++k)
+      mesh->simplices(k).append(closure.simplices[k].data(), closure.simplices[k].size() / (k + 1));
+   mesh->simplices(topdim).append(cells.data(), cells.size() / (topdim + 1));
+}
+
+vector<ID> closureOf(const vector<ID>& cell_ids, uint dim, const Closure& closure)
+{
+   const size_t nlocal = localSimplices(closure.topdim, dim).size();
+   vector<ID> ids;
+   ids.reserve(cell_ids.size() * nlocal);
+   for (const ID cid : cell_ids)
+      ids.insert(ids.end(), closure.incidence[dim].begin() + cid * nlocal,
+                 closure.incidence[dim].begin() + (cid + 1) * nlocal);
+   sort(ids.begin(), ids.end());
+   ids.erase(unique(ids.begin(), ids.end()), ids.end());
+   return ids;
+}
+
+}
@@ -0,0 +1,125 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_CLOSURE_HH
+#define PYULB_CLOSURE_HH
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <vector>
+
+#include "system.h"
+#include "segment.h"
+
+namespace mesh
+{
+
+/**
+ * The faces of a simplex of the given dimension as bit masks of its local vertex indices, in lexicographic order.
+ */
+std::vector<uint> localSimplices(uint topdim, uint dim);
+
+/**
+ * The simplices of all dimensions spanned by a list of cells, as read from a mesh file which only stores cells.
+ */
+struct Closure
+{
+   uint topdim = 0;
+   // Vertex IDs of the unique simplices per dimension between the vertices and the cells
+   std::array<std::vector<ID>, 4> simplices;
+   // IDs of the simplices per dimension of every cell in the order of localSimplices, the vertices for dimension 0
+   std::array<std::vector<ID>, 4> incidence;
+   // The cells of every facet from facet_offsets[fid] to facet_offsets[fid + 1]
+   std::vector<std::size_t> facet_offsets;
+   std::vector<ID> facet_cells;
+
+   /**
+    * Builds the closure of the cells, given as topdim + 1 vertex IDs each. The simplices are numbered in the order
+    * of their sorted vertices.
+    */
+   Closure(const std::vector<ID>& cells, uint topdim);
+};
+
+/**
+ * Fills an empty mesh with the points of the given dimension, all of them as vertices, the closure and the cells.
+ * The simplices are unique, therefore they are appended without lookup.
+ */
+void appendClosure(MeshBase* mesh, uint dim, std::vector<double>&& coordinates, const std::vector<ID>& cells,
+                   const Closure& closure);
+
+/**
+ * @return The sorted IDs of the simplices of the given dimension belonging to the cells
+ */
+std::vector<ID> closureOf(const std::vector<ID>& cell_ids, uint dim, const Closure& closure);
+
+/**
+ * References the cells of every segment together with their closure and creates the interfaces from the facets
+ * shared by cells of two different segments. The segments have to exist already, with IDs in order.
+ */
+template<uint Dim, uint TopDim>
+void assembleSegments(System<Dim, TopDim>* system, const Closure& closure,
+                      const std::vector<std::vector<ID>>& segment_cells)
+{
+   const std::size_t nsegs = segment_cells.size();
+   std::vector<std::array<std::vector<ID>, TopDim + 1>> refs(nsegs);
+#pragma omp parallel for schedule(dynamic)
+   for (long iseg = 0; iseg < (long) nsegs; ++iseg) {
+      for (uint k = 0; k < TopDim; ++k)
+         refs[iseg][k] = closureOf(segment_cells[iseg], k, closure);
+      refs[iseg][TopDim] = segment_cells[iseg];
+   }
+   for (std::size_t iseg = 0; iseg < nsegs; ++iseg) {
+      MeshBase* seg_mesh = system->segment(static_cast<ID>(iseg))->mesh();
+      for (uint k = 0; k <= TopDim; ++k)
+         seg_mesh->simplices(k).reference(refs[iseg][k].data(), refs[iseg][k].size());
+   }
+
+   // A cell may belong to several segments, every pair of different segments across a facet shares it
+   const std::size_t ncells = closure.incidence[0].size() / (TopDim + 1);
+   std::vector<std::vector<ID>> cell2segments(ncells);
+   for (std::size_t iseg = 0; iseg < nsegs; ++iseg)
+      for (const ID cid : segment_cells[iseg])
+         cell2segments[cid].push_back(iseg);
+   const std::vector<uint> facets = localSimplices(TopDim, TopDim - 1);
+   std::map<std::pair<ID, ID>, std::vector<ID>> interface_facets;
+   for (std::size_t fid = 0; fid + 1 < closure.facet_offsets.size(); ++fid)
+      for (std::size_t i = closure.facet_offsets[fid]; i < closure.facet_offsets[fid + 1]; ++i)
+         for (std::size_t j = i + 1; j < closure.facet_offsets[fid + 1]; ++j)
+            for (const ID seg1 : cell2segments[closure.facet_cells[i]])
+               for (const ID seg2 : cell2segments[closure.facet_cells[j]])
+                  if (seg1 != seg2)
+                     interface_facets[std::minmax(seg1, seg2)].push_back(fid);
+
+   // The lower simplices of a facet are found through the local simplices of one of its cells
+   for (auto& [segs, facet_ids] : interface_facets) {
+      std::sort(facet_ids.begin(), facet_ids.end());
+      facet_ids.erase(std::unique(facet_ids.begin(), facet_ids.end()), facet_ids.end());
+      MeshBase* int_mesh = system->interface(segs.first, segs.second)->mesh();
+      for (uint k = 0; k + 1 < TopDim; ++k) {
+         const std::vector<uint> locals = localSimplices(TopDim, k);
+         const std::size_t nlocal = locals.size();
+         std::vector<ID> ids;
+         for (const ID fid : facet_ids) {
+            const ID cid = closure.facet_cells[closure.facet_offsets[fid]];
+            const std::size_t nfacets = facets.size();
+            uint mask = 0;
+            for (std::size_t ifacet = 0; ifacet < nfacets; ++ifacet)
+               if (closure.incidence[TopDim - 1][cid * nfacets + ifacet] == fid)
+                  mask = facets[ifacet];
+            for (std::size_t ilocal = 0; ilocal < nlocal; ++ilocal)
+               if ((locals[ilocal] & mask) == locals[ilocal])
+                  ids.push_back(closure.incidence[k][cid * nlocal + ilocal]);
+         }
+         std::sort(ids.begin(), ids.end());
+         ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+         int_mesh->simplices(k).reference(ids.data(), ids.size());
+      }
+      int_mesh->simplices(TopDim - 1).reference(facet_ids.data(), facet_ids.size());
+   }
+}
+
+}
+
+#endif //PYULB_CLOSURE_HH
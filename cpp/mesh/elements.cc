@@ -29,6 +29,12 @@ ID SimplexBase<Dim, SimplexDim>::getID() const noexcept
    return id;
 }
 
+template<uint Dim, uint SimplexDim>
+MeshBase* SimplexBase<Dim, SimplexDim>::getMesh() const noexcept
+{
+   return mesh;
+}
+
 template<uint Dim, uint SimplexDim>
 uint SimplexBase<Dim, SimplexDim>::getTopologyDimension() const noexcept
 {
@@ -107,7 +113,8 @@ VectorXd Simplex<Dim, 2>::center() const
 template<uint Dim>
 VectorXd Simplex<Dim, 3>::center() const
 {
-   return Simplex<Dim, 3>::getPoint(0) + (Simplex<Dim, 3>::getPoint(1) - Simplex<Dim, 3>::getPoint(0)) * 0.5;
+   return (Simplex<Dim, 3>::getPoint(0) + Simplex<Dim, 3>::getPoint(1) + Simplex<Dim, 3>::getPoint(2)
+           + Simplex<Dim, 3>::getPoint(3)) * 0.25;
 }
 
 Polygon::Polygon(const vector<Vector2d>& corners) : corners(corners)
@@ -0,0 +1,595 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+#include "system.h"
+#include "mappedfile.h"
+#include "closure.hh"
+#include "tokens.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+// Gmsh element types of the linear simplices by dimension
+static constexpr int gmsh_simplex_types[] = {15, 1, 2, 4};
+
+/**
+ * @return The dimension and the number of nodes of a Gmsh element type
+ */
+static pair<int, size_t> gmshElementType(int type)
+{
+   switch (type) {
+      case 15: return {0, 1};
+      case 1: return {1, 2};
+      case 8: return {1, 3};
+      case 2: return {2, 3};
+      case 3: return {2, 4};
+      case 9: return {2, 6};
+      case 10: return {2, 9};
+      case 16: return {2, 8};
+      case 4: return {3, 4};
+      case 5: return {3, 8};
+      case 6: return {3, 6};
+      case 7: return {3, 5};
+      case 11: return {3, 10};
+      case 12: return {3, 27};
+      case 13: return {3, 18};
+      case 14: return {3, 14};
+      case 17: return {3, 20};
+      case 18: return {3, 15};
+      case 19: return {3, 13};
+      default:
+         throw runtime_error("Unsupported Gmsh element type " + to_string(type));
+   }
+}
+
+/**
+ * Content of a section of a Gmsh file. The headers are read in order, the large arrays of nodes and elements are
+ * only skipped and converted afterwards on all threads. In binary files every array value has 8 bytes, in ASCII
+ * files it is a token.
+ */
+class GmshSection
+{
+public:
+   GmshSection(const char* begin, const char* end, bool binary) : begin(begin), end(end), binary(binary)
+   {
+      if (!binary)
+         tokens = tokenise(begin, end);
+   }
+
+   template<typename T>
+   T next()
+   {
+      if (binary) {
+         if (sizeof(T) > static_cast<size_t>(end - begin) - position)
+            throw runtime_error("Gmsh section is truncated");
+         T value;
+         memcpy(&value, begin + position, sizeof(T));
+         position += sizeof(T);
+         return value;
+      }
+      if (position >= tokens.size())
+         throw runtime_error("Gmsh section is truncated");
+      return parseToken<T>(begin + tokens[position++], end);
+   }
+
+   /**
+    * Skips an array of n values.
+    *
+    * @return The position of the array
+    */
+   size_t skip(size_t n)
+   {
+      const size_t first = position;
+      const size_t available = binary ? (end - begin - position) / 8 : tokens.size() - position;
+      if (n > available)
+         throw runtime_error("Gmsh section is truncated");
+      position += binary ? 8 * n : n;
+      return first;
+   }
+
+   template<typename T>
+   T value(size_t array, size_t i) const
+   {
+      if (binary) {
+         T value;
+         memcpy(&value, begin + array + 8 * i, sizeof(T));
+         return value;
+      }
+      return parseToken<T>(begin + tokens[array + i], end);
+   }
+
+   /**
+    * @return The text behind the values read so far
+    */
+   const char* current() const
+   {
+      if (binary)
+         return begin + position;
+      return position < tokens.size() ? begin + tokens[position] : end;
+   }
+
+private:
+   const char* begin;
+   const char* end;
+   bool binary;
+   vector<size_t> tokens;
+   size_t position = 0;
+};
+
+/**
+ * Reads the next section header "$Name" and moves the position behind its line.
+ *
+ * @return The name, empty at the end of the file
+ */
+static string nextSection(const char*& pos, const char* end)
+{
+   while (pos < end && isSpace(*pos))
+      ++pos;
+   if (pos == end)
+      return "";
+   if (*pos != '$')
+      throw runtime_error("Malformed Gmsh file, expected a section");
+   const char* name_end = pos;
+   while (name_end < end && !isSpace(*name_end))
+      ++name_end;
+   string name(pos + 1, name_end);
+   pos = name_end;
+   while (pos < end && *pos != '\n')
+      ++pos;
+   if (pos < end)
+      ++pos;
+   return name;
+}
+
+/**
+ * @return The start of the line "$End<name>" at or behind pos
+ */
+static const char* sectionEnd(const char* pos, const char* end, const string& name)
+{
+   const string_view text(pos, end - pos);
+   const string tag = "$End" + name;
+   const size_t found = text.find(tag);
+   if (found == string_view::npos)
+      throw runtime_error("Gmsh section " + name + " is not terminated");
+   return pos + found;
+}
+
+template<uint Dim, uint TopDim>
+unique_ptr<System<Dim, TopDim>> System<Dim, TopDim>::readGmsh(const string& path)
+{
+   const MappedFile file(path);
+   const char* pos = file.data();
+   const char* const end = file.data() + file.size();
+
+   bool binary = false;
+   map<int, string> physical_names;
+   map<int, vector<int>> entity_physicals;
+   size_t nnodes = 0;
+   vector<uint64_t> node_tags;
+   vector<double> coordinates;
+   vector<ID> cells;
+   // First cell, number of cells and entity tag of the cell blocks
+   vector<tuple<size_t, size_t, int>> cell_blocks;
+   bool has_format = false;
+
+   for (string name = nextSection(pos, end); !name.empty(); name = nextSection(pos, end)) {
+      const char* section_end;
+      if (name == "MeshFormat") {
+         section_end = sectionEnd(pos, end, name);
+         istringstream ss(string(pos, min(section_end, find(pos, section_end, '\n'))));
+         string version;
+         int file_type, data_size;
+         if (!(ss >> version >> file_type >> data_size))
+            throw runtime_error("Malformed Gmsh mesh format");
+         if (version.compare(0, 2, "4.") != 0 || version < "4.1")
+            throw runtime_error("Only the Gmsh format 4.1 is supported, the file has version " + version);
+         binary = file_type == 1;
+         if (binary && data_size != sizeof(uint64_t))
+            throw runtime_error("Only Gmsh files with 8 byte sizes are supported");
+         if (binary) {
+            const char* one = find(pos, section_end, '\n') + 1;
+            int value = 0;
+            if (section_end - one >= (long) sizeof(value))
+               memcpy(&value, one, sizeof(value));
+            if (value != 1)
+               throw runtime_error("Gmsh file was written with a different byte order");
+            // The binary value may contain the section end, it is located behind it
+            section_end = sectionEnd(one + sizeof(value), end, name);
+         }
+         has_format = true;
+      } else if (!has_format) {
+         throw runtime_error("Gmsh file does not start with the mesh format");
+      } else if (name == "PhysicalNames") {
+         section_end = sectionEnd(pos, end, name);
+         istringstream ss(string(pos, section_end));
+         size_t count;
+         ss >> count;
+         for (size_t i = 0; i < count; ++i) {
+            int dim, tag;
+            string group;
+            if (!(ss >> dim >> tag >> quoted(group)))
+               throw runtime_error("Malformed Gmsh physical names");
+            if (dim == (int) TopDim)
+               physical_names[tag] = group;
+         }
+      } else if (name == "Entities") {
+         GmshSection section(pos, binary ? end : sectionEnd(pos, end, name), binary);
+         size_t counts[4];
+         for (auto& count : counts)
+            count = section.next<uint64_t>();
+         for (int dim = 0; dim < 4; ++dim) {
+            for (size_t i = 0; i < counts[dim]; ++i) {
+               const int tag = section.next<int32_t>();
+               for (int ic = 0; ic < (dim == 0 ? 3 : 6); ++ic)
+                  section.next<double>();
+               const size_t nphysicals = section.next<uint64_t>();
+               vector<int> physicals;
+               for (size_t ip = 0; ip < nphysicals; ++ip)
+                  physicals.push_back(section.next<int32_t>());
+               if (dim == (int) TopDim)
+                  entity_physicals[tag] = move(physicals);
+               if (dim > 0) {
+                  const size_t nbounding = section.next<uint64_t>();
+                  for (size_t ib = 0; ib < nbounding; ++ib)
+                     section.next<int32_t>();
+               }
+            }
+         }
+         section_end = sectionEnd(section.current(), end, name);
+      } else if (name == "Nodes") {
+         GmshSection section(pos, binary ? end : sectionEnd(pos, end, name), binary);
+         const size_t nblocks = section.next<uint64_t>();
+         nnodes = section.next<uint64_t>();
+         section.next<uint64_t>();
+         section.next<uint64_t>();
+         node_tags.resize(nnodes);
+         coordinates.resize(Dim * nnodes);
+         size_t offset = 0;
+         for (size_t iblock = 0; iblock < nblocks; ++iblock) {
+            const int entity_dim = section.next<int32_t>();
+            section.next<int32_t>();
+            const int parametric = section.next<int32_t>();
+            const size_t n = section.next<uint64_t>();
+            if (n > nnodes - offset)
+               throw runtime_error("Gmsh file contains more nodes than declared");
+            const size_t stride = 3 + (parametric != 0 ? entity_dim : 0);
+            const size_t tags = section.skip(n);
+            const size_t xyz = section.skip(n * stride);
+#pragma omp parallel for
+            for (long i = 0; i < (long) n; ++i) {
+               node_tags[offset + i] = section.value<uint64_t>(tags, i);
+               for (uint d = 0; d < Dim; ++d)
+                  coordinates[Dim * (offset + i) + d] = section.value<double>(xyz, stride * i + d);
+            }
+            offset += n;
+         }
+         if (offset != nnodes)
+            throw runtime_error("Gmsh file contains less nodes than declared");
+         section_end = sectionEnd(section.current(), end, name);
+      } else if (name == "Elements") {
+         GmshSection section(pos, binary ? end : sectionEnd(pos, end, name), binary);
+         const size_t nblocks = section.next<uint64_t>();
+         section.next<uint64_t>();
+         section.next<uint64_t>();
+         section.next<uint64_t>();
+
+         // Node tags are mostly dense, otherwise they are hashed
+         const uint64_t max_tag = node_tags.empty() ? 0 : *max_element(node_tags.begin(), node_tags.end());
+         const bool dense = max_tag <= 2 * nnodes + 1024;
+         vector<ID> tag2id(dense ? max_tag + 1 : 0, -1);
+         unordered_map<uint64_t, ID> tag2id_sparse;
+         for (size_t i = 0; i < nnodes; ++i) {
+            if (dense)
+               tag2id[node_tags[i]] = i;
+            else
+               tag2id_sparse[node_tags[i]] = i;
+         }
+
+         for (size_t iblock = 0; iblock < nblocks; ++iblock) {
+            const int entity_dim = section.next<int32_t>();
+            const int entity_tag = section.next<int32_t>();
+            const int type = section.next<int32_t>();
+            const size_t n = section.next<uint64_t>();
+            const size_t nvertices = gmshElementType(type).second;
+            if (nvertices == 0 || n > numeric_limits<size_t>::max() / (nvertices + 1))
+               throw runtime_error("Malformed Gmsh element block");
+            const size_t elements = section.skip(n * (nvertices + 1));
+            if (entity_dim > (int) TopDim)
+               throw runtime_error("Gmsh file contains elements of a higher dimension than the system");
+            if (entity_dim < (int) TopDim)
+               continue;
+            if (type != gmsh_simplex_types[TopDim])
+               throw runtime_error("Gmsh file contains cells, which are not linear simplices");
+
+            const size_t first = cells.size() / (TopDim + 1);
+            cells.resize(cells.size() + n * (TopDim + 1));
+            bool valid = true;
+#pragma omp parallel for reduction(&&:valid)
+            for (long i = 0; i < (long) n; ++i) {
+               for (uint iv = 0; iv <= TopDim; ++iv) {
+                  const uint64_t tag = section.value<uint64_t>(elements, (TopDim + 2) * i + iv + 1);
+                  ID vid = -1;
+                  if (dense) {
+                     if (tag < tag2id.size())
+                        vid = tag2id[tag];
+                  } else {
+                     const auto it = tag2id_sparse.find(tag);
+                     if (it != tag2id_sparse.end())
+                        vid = it->second;
+                  }
+                  valid = valid && vid >= 0;
+                  cells[(first + i) * (TopDim + 1) + iv] = vid;
+               }
+            }
+            if (!valid)
+               throw runtime_error("Gmsh element refers to a node, which does not exist");
+            cell_blocks.emplace_back(first, n, entity_tag);
+         }
+         section_end = sectionEnd(section.current(), end, name);
+      } else {
+         section_end = sectionEnd(pos, end, name);
+      }
+      pos = section_end;
+      nextSection(pos, end);
+   }
+   if (!has_format)
+      throw runtime_error(path + " is not a Gmsh file");
+
+   // Every physical group of cells becomes a segment, in the order of the physical tags
+   unique_ptr<System<Dim, TopDim>> system(new System<Dim, TopDim>());
+   map<int, ID> physical2segment;
+   for (const auto& [entity, physicals] : entity_physicals)
+      for (const int physical : physicals)
+         physical2segment[physical] = -1;
+   vector<vector<ID>> segment_cells;
+   for (auto& [physical, seg_id] : physical2segment) {
+      const auto it = physical_names.find(physical);
+      seg_id = system->getOrCreateSegment(it != physical_names.end() ? it->second : to_string(physical))->getID();
+      segment_cells.resize(max<size_t>(segment_cells.size(), seg_id + 1));
+   }
+   for (const auto& [first, n, entity] : cell_blocks) {
+      const auto it = entity_physicals.find(entity);
+      if (it == entity_physicals.end())
+         continue;
+      for (const int physical : it->second) {
+         vector<ID>& seg_cells = segment_cells[physical2segment[physical]];
+         for (size_t cid = first; cid < first + n; ++cid)
+            seg_cells.push_back(cid);
+      }
+   }
+   for (auto& seg_cells : segment_cells) {
+      sort(seg_cells.begin(), seg_cells.end());
+      seg_cells.erase(unique(seg_cells.begin(), seg_cells.end()), seg_cells.end());
+   }
+
+   const Closure closure(cells, TopDim);
+   appendClosure(system->_mesh.get(), Dim, move(coordinates), cells, closure);
+   assembleSegments(system.get(), closure, segment_cells);
+   return system;
+}
+
+/**
+ * Writes the values of Gmsh records, in binary as raw values and in ASCII separated by spaces.
+ */
+class GmshWriter
+{
+public:
+   GmshWriter(ostream& out, bool binary) : out(out), binary(binary)
+   {
+      out << setprecision(numeric_limits<double>::max_digits10);
+   }
+
+   template<typename T>
+   GmshWriter& operator<<(const T& value)
+   {
+      if (binary) {
+         out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+      } else {
+         if (!line_start)
+            out << ' ';
+         out << value;
+         line_start = false;
+      }
+      return *this;
+   }
+
+   /**
+    * Ends a record, which is a line in ASCII.
+    */
+   void endRecord()
+   {
+      if (!binary)
+         out << '\n';
+      line_start = true;
+   }
+
+   /**
+    * Starts a section, the header is always text.
+    */
+   void beginSection(const string& name)
+   {
+      out << '$' << name << '\n';
+      line_start = true;
+   }
+
+   void endSection(const string& name)
+   {
+      if (binary)
+         out << '\n';
+      out << "$End" << name << '\n';
+   }
+
+private:
+   ostream& out;
+   bool binary;
+   bool line_start = true;
+};
+
+template<uint Dim, uint TopDim>
+void System<Dim, TopDim>::writeGmsh(ostream& out, bool binary) const
+{
+   MeshBase* root = _mesh.get();
+   const vector<double>& coordinates = root->getPointList();
+   const size_t npoints = coordinates.size() / Dim;
+   const size_t nsegs = segments.size();
+   // Interfaces of 1D systems would be point entities, which can only hold a single node
+   const size_t nints = TopDim > 1 ? interfaces.size() : 0;
+
+   // Cells without segment are written as an entity without physical group
+   MeshElementsProxy& cells = root->simplices(TopDim);
+   vector<bool> assigned(cells.size(), false);
+   for (const auto& seg : segments)
+      for (const auto& cell : seg->mesh()->simplices(TopDim))
+         assigned[cell.getID()] = true;
+   vector<ID> unassigned;
+   for (size_t cid = 0; cid < cells.size(); ++cid)
+      if (!assigned[cid])
+         unassigned.push_back(cid);
+   const bool rest_entity = nsegs == 0 || !unassigned.empty();
+
+   out << "$MeshFormat\n4.1 " << (binary ? 1 : 0) << ' ' << sizeof(uint64_t) << '\n';
+   if (binary) {
+      const int one = 1;
+      out.write(reinterpret_cast<const char*>(&one), sizeof(one));
+      out << '\n';
+   }
+   out << "$EndMeshFormat\n";
+
+   out << "$PhysicalNames\n" << nsegs + nints << '\n';
+   for (size_t iseg = 0; iseg < nsegs; ++iseg)
+      out << TopDim << ' ' << iseg + 1 << ' ' << quoted(segments[iseg]->getName()) << '\n';
+   for (size_t iint = 0; iint < nints; ++iint)
+      out << TopDim - 1 << ' ' << nsegs + iint + 1 << ' ' << quoted(interfaces[iint]->getName()) << '\n';
+   out << "$EndPhysicalNames\n";
+
+   GmshWriter writer(out, binary);
+   const auto boundingBox = [&](MeshBase* mesh) {
+      array<double, 6> box{};
+      if (mesh->simplices(0).size() > 0) {
+         box = {numeric_limits<double>::max(), numeric_limits<double>::max(), numeric_limits<double>::max(),
+                numeric_limits<double>::lowest(), numeric_limits<double>::lowest(), numeric_limits<double>::lowest()};
+         for (uint d = Dim; d < 3; ++d)
+            box[d] = box[3 + d] = 0.0;
+      }
+      for (const auto& vertex : mesh->simplices(0)) {
+         for (uint d = 0; d < Dim; ++d) {
+            box[d] = min(box[d], coordinates[Dim * vertex[0] + d]);
+            box[3 + d] = max(box[3 + d], coordinates[Dim * vertex[0] + d]);
+         }
+      }
+      return box;
+   };
+   const auto writeEntity = [&](int tag, const array<double, 6>& box, int physical) {
+      writer << tag;
+      for (const double value : box)
+         writer << value;
+      writer << static_cast<uint64_t>(physical > 0 ? 1 : 0);
+      if (physical > 0)
+         writer << physical;
+      writer << static_cast<uint64_t>(0);
+      writer.endRecord();
+   };
+   writer.beginSection("Entities");
+   uint64_t counts[4] = {};
+   counts[TopDim] = nsegs + (rest_entity ? 1 : 0);
+   if (nints > 0)
+      counts[TopDim - 1] = nints;
+   for (const uint64_t count : counts)
+      writer << count;
+   writer.endRecord();
+   if (nints > 0)
+      for (size_t iint = 0; iint < nints; ++iint)
+         writeEntity(iint + 1, boundingBox(interfaces[iint]->mesh()), nsegs + iint + 1);
+   for (size_t iseg = 0; iseg < nsegs; ++iseg)
+      writeEntity(iseg + 1, boundingBox(segments[iseg]->mesh()), iseg + 1);
+   if (rest_entity)
+      writeEntity(nsegs + 1, boundingBox(root), 0);
+   writer.endSection("Entities");
+
+   // All nodes belong to the first entity of cells
+   writer.beginSection("Nodes");
+   writer << static_cast<uint64_t>(npoints > 0 ? 1 : 0) << static_cast<uint64_t>(npoints)
+          << static_cast<uint64_t>(npoints > 0 ? 1 : 0) << static_cast<uint64_t>(npoints);
+   writer.endRecord();
+   if (npoints > 0) {
+      writer << static_cast<int>(TopDim) << 1 << 0 << static_cast<uint64_t>(npoints);
+      writer.endRecord();
+      for (size_t vid = 0; vid < npoints; ++vid) {
+         writer << static_cast<uint64_t>(vid + 1);
+         writer.endRecord();
+      }
+      for (size_t vid = 0; vid < npoints; ++vid) {
+         for (uint d = 0; d < 3; ++d)
+            writer << (d < Dim ? coordinates[Dim * vid + d] : 0.0);
+         writer.endRecord();
+      }
+   }
+   writer.endSection("Nodes");
+
+   // Element blocks as entity dimension, entity tag, element dimension and the element IDs
+   vector<tuple<int, int, uint, vector<ID>>> blocks;
+   const auto ids = [](MeshBase* mesh, uint dim) {
+      vector<ID> result;
+      for (const auto& element : mesh->simplices(dim))
+         result.push_back(element.getID());
+      return result;
+   };
+   for (size_t iseg = 0; iseg < nsegs; ++iseg)
+      blocks.emplace_back(TopDim, iseg + 1, TopDim, ids(segments[iseg]->mesh(), TopDim));
+   if (rest_entity)
+      blocks.emplace_back(TopDim, nsegs + 1, TopDim, move(unassigned));
+   for (size_t iint = 0; iint < nints; ++iint)
+      blocks.emplace_back(TopDim - 1, iint + 1, TopDim - 1, ids(interfaces[iint]->mesh(), TopDim - 1));
+   blocks.erase(remove_if(blocks.begin(), blocks.end(), [](const auto& block) {
+      return get<3>(block).empty();
+   }), blocks.end());
+   uint64_t nelements = 0;
+   for (const auto& block : blocks)
+      nelements += get<3>(block).size();
+
+   writer.beginSection("Elements");
+   writer << static_cast<uint64_t>(blocks.size()) << nelements << static_cast<uint64_t>(nelements > 0 ? 1 : 0)
+          << nelements;
+   writer.endRecord();
+   uint64_t tag = 0;
+   for (const auto& [entity_dim, entity_tag, dim, element_ids] : blocks) {
+      writer << entity_dim << entity_tag << gmsh_simplex_types[dim] << static_cast<uint64_t>(element_ids.size());
+      writer.endRecord();
+      MeshElementsProxy& elements = root->simplices(dim);
+      for (const ID eid : element_ids) {
+         writer << ++tag;
+         const MeshElement& element = *elements[eid];
+         for (uint iv = 0; iv <= dim; ++iv)
+            writer << static_cast<uint64_t>(element[iv] + 1);
+         writer.endRecord();
+      }
+   }
+   writer.endSection("Elements");
+}
+
+template unique_ptr<System<1, 1>> System<1, 1>::readGmsh(const string&);
+template unique_ptr<System<2, 1>> System<2, 1>::readGmsh(const string&);
+template unique_ptr<System<2, 2>> System<2, 2>::readGmsh(const string&);
+template unique_ptr<System<3, 1>> System<3, 1>::readGmsh(const string&);
+template unique_ptr<System<3, 2>> System<3, 2>::readGmsh(const string&);
+template unique_ptr<System<3, 3>> System<3, 3>::readGmsh(const string&);
+template void System<1, 1>::writeGmsh(ostream&, bool) const;
+template void System<2, 1>::writeGmsh(ostream&, bool) const;
+template void System<2, 2>::writeGmsh(ostream&, bool) const;
+template void System<3, 1>::writeGmsh(ostream&, bool) const;
+template void System<3, 2>::writeGmsh(ostream&, bool) const;
+template void System<3, 3>::writeGmsh(ostream&, bool) const;
+
+}
@@ -5,11 +5,21 @@
 #ifndef LBM_ATTRIBUTES_H
 #define LBM_ATTRIBUTES_H
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <valarray>
 
+#include "bitset.h"
+#include "layout.h"
+#include "types.h"
+
 //#include "expression.hh"
 
 namespace mesh
@@ -61,6 +71,17 @@ public:
       return sizes[dim];
    }
 
+   /**
+    * @return The number of values per entity, i.e. the product of all extents
+    */
+   std::size_t getSize() const noexcept
+   {
+      std::size_t size = 1;
+      for (const std::size_t extent : sizes)
+         size *= extent;
+      return size;
+   }
+
 private:
    std::vector<std::size_t> sizes;
 };
@@ -74,10 +95,97 @@ enum StorageLocation
    SEGMENT
 };
 
+/**
+ * Scalar types attributes can be stored in files with.
+ */
+enum class ScalarType : uint32_t
+{
+   FLOAT64 = 1,
+   FLOAT32 = 2,
+   INT64 = 3,
+   INT32 = 4,
+   UINT8 = 5
+};
+
+template<typename T>
+constexpr ScalarType scalarType()
+{
+   static_assert(std::is_arithmetic_v<T>, "Only arithmetic attribute types are supported");
+   if constexpr (std::is_same_v<T, double>)
+      return ScalarType::FLOAT64;
+   else if constexpr (std::is_same_v<T, float>)
+      return ScalarType::FLOAT32;
+   else if constexpr (std::is_integral_v<T> && sizeof(T) == 8)
+      return ScalarType::INT64;
+   else if constexpr (std::is_integral_v<T> && sizeof(T) == 4)
+      return ScalarType::INT32;
+   else {
+      static_assert(sizeof(T) == 1, "Attribute type has no scalar type");
+      return ScalarType::UINT8;
+   }
+}
+
+/**
+ * @return The number of bytes of a value of the given scalar type
+ */
+inline std::size_t scalarSize(ScalarType type)
+{
+   switch (type) {
+      case ScalarType::FLOAT64:
+      case ScalarType::INT64:
+         return 8;
+      case ScalarType::FLOAT32:
+      case ScalarType::INT32:
+         return 4;
+      case ScalarType::UINT8:
+         return 1;
+   }
+   throw std::logic_error("Unknown scalar type");
+}
+
+/**
+ * @return The number of entities of the system at the location, e.g. the number of edges for EDGE
+ */
+std::size_t countEntities(const SystemBase* system, StorageLocation location);
+
+MeshBase* systemMesh(const SystemBase* system);
+
+/**
+ * Chooses entities at the storage location. Selectors are evaluated word by word, 64 entities at once, so that
+ * compositions of selectors (see selector.h) need no temporary per operand.
+ */
 template<StorageLocation Location = StorageLocation::VERTEX>
 class SelectorBase
 {
-   virtual std::valarray<bool> operator()(MeshBase* mesh) = 0;
+public:
+   static constexpr StorageLocation location = Location;
+
+   virtual ~SelectorBase() = default;
+
+   /**
+    * Prepares the evaluation for the n entities of the mesh at the location.
+    */
+   virtual void bind(MeshBase* mesh, std::size_t n) const = 0;
+
+   /**
+    * @return The bits of the entities 64 * iword to 64 * iword + 63, bits beyond the entities are ignored
+    */
+   virtual std::uint64_t word(std::size_t iword) const = 0;
+
+   /**
+    * Evaluates the selector for the n entities of the mesh in one pass over the words.
+    */
+   Bitset operator()(MeshBase* mesh, std::size_t n) const
+   {
+      bind(mesh, n);
+      Bitset selected(n);
+      std::uint64_t* words = selected.words();
+#pragma omp parallel for if (n > 100000)
+      for (std::size_t i = 0; i < selected.getNumWords(); ++i)
+         words[i] = word(i);
+      selected.clearTail();
+      return selected;
+   }
 };
 
 
@@ -97,6 +205,79 @@ private:
    AttributeExtent extents;
 };
 
+/**
+ * Ranges of entities changed by the versions of an attribute. Changes nobody has asked for yet are merged into one
+ * range, so that writing values one by one stays cheap. Only the latest ranges are kept, older versions have changed
+ * all entities.
+ */
+class ChangeLog
+{
+public:
+   std::uint64_t getVersion() const noexcept
+   {
+      return version;
+   }
+
+   /**
+    * Records a change of the entities first to last - 1.
+    */
+   void change(std::size_t first, std::size_t last)
+   {
+      if (first >= last)
+         return;
+      ++version;
+      if (!entries.empty() && !observed) {
+         Entry& entry = entries.back();
+         entry.first = std::min(entry.first, first);
+         entry.last = std::max(entry.last, last);
+         entry.version = version;
+         return;
+      }
+      if (entries.size() == capacity) {
+         base = entries.front().version;
+         entries.erase(entries.begin());
+      }
+      entries.push_back({version, first, last});
+      observed = false;
+   }
+
+   /**
+    * @return The range [first, last) of the n entities changed after the given version, empty if nothing changed
+    */
+   std::pair<std::size_t, std::size_t> since(std::uint64_t seen, std::size_t n) const
+   {
+      observed = true;
+      if (seen < base)
+         return {0, n};
+      std::size_t first = n;
+      std::size_t last = 0;
+      for (const Entry& entry : entries) {
+         if (entry.version > seen) {
+            first = std::min(first, entry.first);
+            last = std::max(last, entry.last);
+         }
+      }
+      last = std::min(last, n);
+      return first < last ? std::make_pair(first, last) : std::make_pair(std::size_t(0), std::size_t(0));
+   }
+
+private:
+   struct Entry
+   {
+      std::uint64_t version;
+      std::size_t first;
+      std::size_t last;
+   };
+
+   static constexpr std::size_t capacity = 16;
+
+   std::vector<Entry> entries;
+   std::uint64_t version = 0;
+   // Versions up to base are no longer in the entries
+   std::uint64_t base = 0;
+   mutable bool observed = false;
+};
+
 class AttributeBase
 {
 public:
@@ -105,26 +286,127 @@ public:
    virtual AttributeExtent& getExtents() = 0;
 
    virtual const AttributeExtent& getExtents() const = 0;
+
+   virtual std::string getName() const = 0;
+
+   virtual StorageLocation getLocation() const noexcept = 0;
+
+   virtual ScalarType getScalarType() const noexcept = 0;
+
+   virtual ~AttributeBase() = default;
+
+   /**
+    * @return The system the attribute belongs to
+    */
+   virtual SystemBase* getSystem() const noexcept = 0;
+
+   /**
+    * @return The number of entities at the storage location of the attribute
+    */
+   virtual std::size_t getNumEntities() const = 0;
+
+   /**
+    * @return The number of entities per block of the storage layout, 1 for AoS and 0 for SoA
+    */
+   virtual std::size_t getLayoutBlock() const noexcept = 0;
+
+   /**
+    * @return The stored values as flat array of getScalarType, in the layout of the attribute
+    */
+   virtual const void* data() const = 0;
+
+   /**
+    * @return The number of stored values, including the padding of the last block
+    */
+   virtual std::size_t size() const = 0;
+
+   /**
+    * Replaces the values by the given flat array of getScalarType, with the values of an entity together (AoS).
+    */
+   virtual void assign(const void* values, std::size_t n) = 0;
+
+   /**
+    * Copies the values into a flat array of getScalarType, with the values of an entity together (AoS). The array has
+    * to hold getNumEntities() times getExtents().getSize() values.
+    */
+   virtual void copyTo(void* values) const = 0;
+
+   /**
+    * Copies the values of the given entities into a flat array of getScalarType, entity after entity (AoS).
+    */
+   virtual void gather(const std::vector<ID>& entities, void* values) const = 0;
+
+   /**
+    * Writes the values of the given entities back from a flat array as filled by gather.
+    */
+   virtual void scatter(const std::vector<ID>& entities, const void* values) = 0;
+
+   /**
+    * Records that the values of the entities first to last - 1 were written through a pointer obtained before.
+    */
+   virtual void modified(std::size_t first = 0, std::size_t last = SIZE_MAX) = 0;
+
+   /**
+    * Recomputes all values on the next access, only derived attributes compute their values.
+    */
+   virtual void invalidate() noexcept
+   {}
+
+   /**
+    * @return A counter, which grows whenever values are written or entities are added
+    */
+   virtual std::uint64_t getVersion() const = 0;
+
+   /**
+    * @return The range [first, last) of entities, whose values may have changed after the given version
+    */
+   virtual std::pair<std::size_t, std::size_t> changedSince(std::uint64_t version) const = 0;
 };
 
-template<typename T, StorageLocation Location = StorageLocation::VERTEX>
+/**
+ * Values of type T for every entity at the storage location of a system, all in a single contiguous array. The
+ * layout policy decides the order of the values: AoS stores the values of an entity together (extents in row major
+ * order), SoA every component for all entities in an array of its own, AoSoA<Block> blocks of Block entities
+ * component by component. The array follows the number of entities of the system, so values of appended elements are
+ * added on the next access, initialised to T().
+ *
+ * Every accessor synchronises the values first, the const ones included, which resizes them after the mesh grew and
+ * recomputes derived attributes. Attributes are therefore not safe for concurrent access, not even const one. Parallel
+ * code synchronises them on one thread first, e.g. with getNumEntities, and then reads through value or a pointer
+ * from data, which don't synchronise again.
+ */
+template<typename T, StorageLocation Location = StorageLocation::VERTEX, typename Layout = AoS>
 class Attribute : public AttributeBase
 {
 public:
-   Attribute(SystemBase* mesh, std::string name, const AttributeExtent& extents = AttributeExtent())
-           : extents(extents),
-             mesh(mesh),
-             iextents(extents.getDimension(),
-                      std::numeric_limits<std::size_t>::quiet_NaN()),
+   Attribute(SystemBase* system, std::string name, const AttributeExtent& extents = AttributeExtent())
+           : system(system),
+             extents(extents),
+             iextents(extents.getDimension(), 0),
              idim(0),
              name(std::move(name))
-   {}
+   {
+      sync();
+   }
 
+   /**
+    * Changes the extents, the values of all entities are reset to T().
+    */
    Attribute& resize(const AttributeExtent& extent) override
    {
+      extents = extent;
+      iextents.assign(extents.getDimension(), 0);
+      idim = 0;
+      components = extents.getSize();
+      values.assign(Layout::storageSize(nentities, components), T());
+      log.change(0, nentities);
       return *this;
    }
 
+   /**
+    * Selects an index of the next extent for the following assignment, e.g. attribute[0] = 1.0 only sets the first
+    * component of vector values.
+    */
    Attribute& operator[](std::size_t dim)
    {
       if (idim >= iextents.size()) {
@@ -132,28 +414,285 @@ public:
          ss << "Extent " << idim << " does not exist";
          throw std::range_error(ss.str());
       }
+      if (dim >= extents.getExtent(idim))
+         throw std::out_of_range("Index exceeds the extent");
       iextents[idim] = dim;
       ++idim;
       return *this;
    }
 
+   /**
+    * Restricts the following assignment to the entities chosen by the selector.
+    */
    Attribute& operator()(const SelectorBase<Location>& selector)
    {
-      mask &= selector(mesh);
+      sync();
+      Bitset selected = selector(systemMesh(system), nentities);
+      if (mask.size() == selected.size())
+         mask &= selected;
+      else
+         mask = std::move(selected);
       return *this;
    }
 
+   /**
+    * Sets the selected components of the selected entities, all if nothing is selected, and clears the selection.
+    */
    Attribute& operator=(const T& value)
    {
-      values[mask] = value;
+      sync();
+      const std::size_t n = nentities;
+      if (mask.size() != 0 && mask.size() != n)
+         throw std::logic_error("Selection does not match the number of entities");
+      // Components are selected by a fixed prefix of their index in row major order
+      std::size_t first = 0;
+      std::size_t count = components;
+      for (std::size_t d = 0; d < idim; ++d) {
+         count /= extents.getExtent(d);
+         first += iextents[d] * count;
+      }
+      if (mask.size() == 0) {
+         for (std::size_t c = first; c < first + count; ++c)
+            for (std::size_t i = 0; i < n; ++i)
+               values[Layout::index(i, c, n, components)] = value;
+         log.change(0, n);
+      } else {
+         // Only the selected entities are visited, boundary conditions usually select few of many
+         const std::vector<std::size_t> selected = mask.indices();
+#pragma omp parallel for if (selected.size() * count > 100000)
+         for (std::size_t i = 0; i < selected.size(); ++i)
+            for (std::size_t c = first; c < first + count; ++c)
+               values[Layout::index(selected[i], c, n, components)] = value;
+         if (!selected.empty())
+            log.change(selected.front(), selected.back() + 1);
+      }
+      idim = 0;
+      mask = Bitset();
+      return *this;
+   }
+
+   /**
+    * Copies the values of an attribute with the same extents in another layout.
+    */
+   template<typename OtherLayout>
+   Attribute& assign(const Attribute<T, Location, OtherLayout>& other)
+   {
+      if (other.components != components)
+         throw std::logic_error("Attributes " + name + " and " + other.name + " have different extents");
+      sync();
+      other.sync();
+      if (other.nentities != nentities)
+         throw std::logic_error("Attributes " + name + " and " + other.name + " belong to different systems");
+      convertLayout<OtherLayout, Layout>(other.values.data(), values.data(), nentities, components);
+      log.change(0, nentities);
       return *this;
    }
 
-   std::string getName() const
+   std::string getName() const override
    {
       return name;
    }
 
+   StorageLocation getLocation() const noexcept override
+   {
+      return Location;
+   }
+
+   ScalarType getScalarType() const noexcept override
+   {
+      return scalarType<T>();
+   }
+
+   SystemBase* getSystem() const noexcept override
+   {
+      return system;
+   }
+
+   std::size_t getLayoutBlock() const noexcept override
+   {
+      return Layout::block;
+   }
+
+   std::size_t getNumEntities() const override
+   {
+      sync();
+      return nentities;
+   }
+
+   const void* data() const override
+   {
+      sync();
+      return values.data();
+   }
+
+   /**
+    * Counts as a change of all values, values written through the pointer later on need a call of modified.
+    */
+   T* data()
+   {
+      sync();
+      log.change(0, nentities);
+      return values.data();
+   }
+
+   T* begin()
+   {
+      return data();
+   }
+
+   T* end()
+   {
+      return data() + values.size();
+   }
+
+   /**
+    * @return The value of a component of an entity, the components of the extents counted in row major order
+    */
+   T& at(std::size_t entity, std::size_t component)
+   {
+      sync();
+      if (entity >= nentities || component >= components)
+         throw std::out_of_range("Entity or component does not exist");
+      log.change(entity, entity + 1);
+      return values[Layout::index(entity, component, nentities, components)];
+   }
+
+   const T& at(std::size_t entity, std::size_t component) const
+   {
+      sync();
+      if (entity >= nentities || component >= components)
+         throw std::out_of_range("Entity or component does not exist");
+      return values[Layout::index(entity, component, nentities, components)];
+   }
+
+   /**
+    * @return The value of a component of an entity like at, without bringing the values up to date, for parallel
+    * readers of synchronised values, like the kernels of derived attributes
+    */
+   const T& value(std::size_t entity, std::size_t component) const noexcept
+   {
+      return values[Layout::index(entity, component, nentities, components)];
+   }
+
+   /**
+    * @return The values of the given entity, only in the AoS layout
+    */
+   T* operator()(std::size_t entity)
+   {
+      static_assert(Layout::block == 1, "Values of an entity are only contiguous in the AoS layout");
+      sync();
+      if (entity >= nentities)
+         throw std::out_of_range("Entity does not exist");
+      log.change(entity, entity + 1);
+      return values.data() + entity * components;
+   }
+
+   /**
+    * @return The values of a component for all entities, only in the SoA layout
+    */
+   T* component(std::size_t component)
+   {
+      static_assert(Layout::block == 0, "Components are only contiguous in the SoA layout");
+      sync();
+      if (component >= components)
+         throw std::out_of_range("Component does not exist");
+      log.change(0, nentities);
+      return values.data() + component * nentities;
+   }
+
+   /**
+    * @return The number of blocks of Layout::block entities, the last one may be partially filled
+    */
+   std::size_t getNumBlocks() const
+   {
+      static_assert(Layout::block > 0, "The SoA layout has no blocks");
+      sync();
+      return (nentities + Layout::block - 1) / Layout::block;
+   }
+
+   /**
+    * @return The values of a block, component after component with Layout::block values each
+    */
+   T* block(std::size_t block)
+   {
+      static_assert(Layout::block > 0, "The SoA layout has no blocks");
+      if (block >= getNumBlocks())
+         throw std::out_of_range("Block does not exist");
+      log.change(block * Layout::block, std::min((block + 1) * Layout::block, nentities));
+      return values.data() + block * Layout::block * components;
+   }
+
+   std::size_t size() const override
+   {
+      sync();
+      return values.size();
+   }
+
+   void assign(const void* data, std::size_t n) override
+   {
+      sync();
+      if (n != 0 && n != nentities * components)
+         throw std::runtime_error("Number of values does not match the entities of attribute " + name);
+      if (n != 0)
+         convertLayout<AoS, Layout>(static_cast<const T*>(data), values.data(), nentities, components);
+      log.change(0, nentities);
+   }
+
+   void copyTo(void* data) const override
+   {
+      sync();
+      convertLayout<Layout, AoS>(values.data(), static_cast<T*>(data), nentities, components);
+   }
+
+   void gather(const std::vector<ID>& entities, void* data) const override
+   {
+      checkEntities(entities);
+      T* out = static_cast<T*>(data);
+      const std::size_t n = nentities;
+#pragma omp parallel for if (entities.size() * components > 100000)
+      for (std::size_t i = 0; i < entities.size(); ++i)
+         for (std::size_t c = 0; c < components; ++c)
+            out[i * components + c] = values[Layout::index(entities[i], c, n, components)];
+   }
+
+   /**
+    * Writes back values as gathered, the entities must not repeat.
+    */
+   void scatter(const std::vector<ID>& entities, const void* data) override
+   {
+      checkEntities(entities);
+      const T* in = static_cast<const T*>(data);
+      const std::size_t n = nentities;
+#pragma omp parallel for if (entities.size() * components > 100000)
+      for (std::size_t i = 0; i < entities.size(); ++i)
+         for (std::size_t c = 0; c < components; ++c)
+            values[Layout::index(entities[i], c, n, components)] = in[i * components + c];
+      if (!entities.empty())
+         log.change(std::size_t(*std::min_element(entities.begin(), entities.end())),
+                    std::size_t(*std::max_element(entities.begin(), entities.end())) + 1);
+   }
+
+   /**
+    * Records that the values of the entities first to last - 1 were written through a pointer obtained before.
+    */
+   void modified(std::size_t first = 0, std::size_t last = SIZE_MAX) override
+   {
+      sync();
+      log.change(first, std::min(last, nentities));
+   }
+
+   std::uint64_t getVersion() const override
+   {
+      sync();
+      return log.getVersion();
+   }
+
+   std::pair<std::size_t, std::size_t> changedSince(std::uint64_t version) const override
+   {
+      sync();
+      return log.since(version, nentities);
+   }
+
    AttributeExtent& getExtents() override
    {
       return extents;
@@ -164,14 +703,71 @@ public:
       return extents;
    }
 
+protected:
+   /**
+    * Brings the values up to date after the entities are synchronised on every access, derived attributes recompute
+    * their values here.
+    */
+   virtual void refresh() const
+   {}
+
 private:
-   SystemBase* mesh;
-   std::valarray<T> values;
+   template<typename, StorageLocation, typename> friend class Attribute;
+
+   template<typename, StorageLocation, typename> friend class DerivedAttribute;
+
+   SystemBase* system;
    AttributeExtent extents;
+   std::size_t components = extents.getSize();
+   // The values live as long as the attribute, only their number follows the mesh
+   mutable std::vector<T> values;
+   mutable std::size_t nentities = 0;
    std::vector<std::size_t> iextents;
    std::size_t idim;
-   std::valarray<bool> mask;
+   Bitset mask;
    std::string name;
+   mutable ChangeLog log;
+
+   void checkEntities(const std::vector<ID>& entities) const
+   {
+      sync();
+      for (const ID entity : entities)
+         if (entity < 0 || std::size_t(entity) >= nentities)
+            throw std::out_of_range("Entity does not exist in attribute " + name);
+   }
+
+   /**
+    * Adds the values of entities appended to the system since the last access, then refreshes the values. Writes the
+    * mutable members, hence the const accessors calling it must not run concurrently.
+    */
+   void sync() const
+   {
+      const std::size_t n = countEntities(system, Location);
+      if (n != nentities)
+         resizeEntities(n);
+      refresh();
+   }
+
+   void resizeEntities(std::size_t n) const
+   {
+      if constexpr (Layout::block == 0) {
+         // The components start at multiples of the number of entities, so they move
+         std::vector<T> moved(Layout::storageSize(n, components), T());
+         const std::size_t common = std::min(n, nentities);
+         for (std::size_t c = 0; c < components; ++c)
+            std::copy_n(values.data() + c * nentities, common, moved.data() + c * n);
+         values = std::move(moved);
+      } else {
+         values.resize(Layout::storageSize(n, components), T());
+         // Shrinking leaves values of removed entities in the last block, which is padding now
+         for (std::size_t i = n; i < (n + Layout::block - 1) / Layout::block * Layout::block; ++i)
+            for (std::size_t c = 0; c < components; ++c)
+               values[Layout::index(i, c, n, components)] = T();
+      }
+      // Appended entities count as changed
+      log.change(nentities, n);
+      nentities = n;
+   }
 };
 
 }
@@ -0,0 +1,132 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_BITSET_H
+#define PYULB_BITSET_H
+
+#include <bitset>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace mesh
+{
+
+/**
+ * Packed set of bits with a size chosen at runtime, 64 bits per word.
+ */
+class Bitset
+{
+public:
+   static constexpr std::size_t word_bits = 64;
+
+   Bitset() = default;
+
+   explicit Bitset(std::size_t n) : n(n), bits((n + word_bits - 1) / word_bits, 0)
+   {}
+
+   std::size_t size() const noexcept
+   {
+      return n;
+   }
+
+   std::size_t getNumWords() const noexcept
+   {
+      return bits.size();
+   }
+
+   std::uint64_t* words() noexcept
+   {
+      return bits.data();
+   }
+
+   const std::uint64_t* words() const noexcept
+   {
+      return bits.data();
+   }
+
+   bool test(std::size_t i) const
+   {
+      return (bits[i / word_bits] >> (i % word_bits)) & 1u;
+   }
+
+   void set(std::size_t i)
+   {
+      if (i >= n)
+         throw std::out_of_range("Bit exceeds the size of the bitset");
+      bits[i / word_bits] |= std::uint64_t(1) << (i % word_bits);
+   }
+
+   Bitset& operator&=(const Bitset& other)
+   {
+      checkSize(other);
+      for (std::size_t i = 0; i < bits.size(); ++i)
+         bits[i] &= other.bits[i];
+      return *this;
+   }
+
+   Bitset& operator|=(const Bitset& other)
+   {
+      checkSize(other);
+      for (std::size_t i = 0; i < bits.size(); ++i)
+         bits[i] |= other.bits[i];
+      return *this;
+   }
+
+   /**
+    * Clears the bits of the last word beyond the size, which operations on whole words may have set.
+    */
+   void clearTail() noexcept
+   {
+      if (n % word_bits != 0)
+         bits.back() &= (std::uint64_t(1) << (n % word_bits)) - 1;
+   }
+
+   /**
+    * @return The number of set bits
+    */
+   std::size_t count() const noexcept
+   {
+      std::size_t count = 0;
+      for (const std::uint64_t word : bits)
+         count += std::bitset<word_bits>(word).count();
+      return count;
+   }
+
+   /**
+    * @return The positions of the set bits in ascending order. Every word is placed by the population count of the
+    * words before it, so the words are compacted in parallel.
+    */
+   std::vector<std::size_t> indices() const
+   {
+      std::vector<std::size_t> offsets(bits.size() + 1, 0);
+      for (std::size_t i = 0; i < bits.size(); ++i)
+         offsets[i + 1] = offsets[i] + std::bitset<word_bits>(bits[i]).count();
+      std::vector<std::size_t> result(offsets.back());
+#pragma omp parallel for if (bits.size() > 1000)
+      for (std::size_t i = 0; i < bits.size(); ++i) {
+         std::size_t out = offsets[i];
+         for (std::uint64_t word = bits[i]; word != 0; word &= word - 1) {
+            // The lowest set bit is the number of trailing zeros
+            const std::size_t bit = std::bitset<word_bits>((word & (~word + 1)) - 1).count();
+            result[out++] = i * word_bits + bit;
+         }
+      }
+      return result;
+   }
+
+private:
+   std::size_t n = 0;
+   std::vector<std::uint64_t> bits;
+
+   void checkSize(const Bitset& other) const
+   {
+      if (other.n != n)
+         throw std::logic_error("Bitsets have different sizes");
+   }
+};
+
+}
+
+#endif //PYULB_BITSET_H
@@ -0,0 +1,165 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_CHECKPOINT_H
+#define PYULB_CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "attribute.h"
+#include "mappedfile.h"
+
+namespace mesh
+{
+
+class SystemBase;
+
+struct CheckpointOptions
+{
+   // Compress the values with zlib, they are stored as they are if built without zlib
+   bool compress = true;
+   // zlib level from 1 (fast) to 9 (small)
+   int level = 1;
+   // Snapshots in memory at most, write blocks while all of them wait for the writer thread
+   std::size_t buffers = 2;
+};
+
+/**
+ * Appends the attributes of a system to a time series file every few steps without stalling the solver. write only
+ * copies the values into a snapshot buffer, a background thread compresses and writes it. The number of buffers
+ * bounds the memory, write waits for a free buffer if the disk can't keep up.
+ *
+ * An existing series is continued, steps have to grow. Errors of the background thread are thrown by the next write,
+ * flush or close.
+ */
+class CheckpointWriter
+{
+public:
+   explicit CheckpointWriter(const std::string& path, const CheckpointOptions& options = CheckpointOptions());
+
+   CheckpointWriter(const CheckpointWriter&) = delete;
+
+   CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+   /**
+    * Writes the pending snapshots, errors are lost, call close to see them.
+    */
+   ~CheckpointWriter();
+
+   /**
+    * Snapshots the given attributes of the system, all if none are given, for the step. Concurrent calls are
+    * serialised.
+    */
+   void write(const SystemBase& system, std::uint64_t step, double time,
+              const std::vector<std::string>& names = std::vector<std::string>());
+
+   /**
+    * Waits until all snapshots are written.
+    */
+   void flush();
+
+   /**
+    * Writes the pending snapshots and stops the writer thread.
+    */
+   void close();
+
+   const std::string& getPath() const noexcept
+   {
+      return path;
+   }
+
+private:
+   struct Snapshot;
+
+   std::string path;
+   CheckpointOptions options;
+   std::ofstream data;
+   std::ofstream index;
+   std::uint64_t end = 0;
+   bool has_steps = false;
+   std::uint64_t last_step = 0;
+
+   // Serialises write, so the steps are checked and queued in the same order
+   std::mutex writing;
+   std::mutex mutex;
+   std::condition_variable changed;
+   std::deque<std::unique_ptr<Snapshot>> pending;
+   std::vector<std::unique_ptr<Snapshot>> free;
+   std::size_t nbuffers = 0;
+   bool busy = false;
+   bool closing = false;
+   std::exception_ptr error;
+   std::thread thread;
+
+   void run();
+
+   void append(Snapshot& snapshot);
+};
+
+struct CheckpointStep
+{
+   std::uint64_t step;
+   double time;
+};
+
+/**
+ * Reads a time series written by CheckpointWriter. The index is read once, a step is found by binary search and only
+ * its record is read from the mapped file.
+ */
+class CheckpointReader
+{
+public:
+   explicit CheckpointReader(const std::string& path);
+
+   /**
+    * @return The complete steps at the time the series was opened
+    */
+   const std::vector<CheckpointStep>& getSteps() const noexcept
+   {
+      return steps;
+   }
+
+   bool hasStep(std::uint64_t step) const;
+
+   /**
+    * @return The names of the attributes written for the step
+    */
+   std::vector<std::string> getAttributeNames(std::uint64_t step) const;
+
+   /**
+    * Reads the values of the attribute of the same name at the step, which needs the same type, location, extents
+    * and number of entities.
+    */
+   void read(std::uint64_t step, AttributeBase& attribute) const;
+
+   /**
+    * Reads all attributes of the step into the attributes of the system with the same names.
+    */
+   void read(std::uint64_t step, SystemBase& system) const;
+
+private:
+   struct Record;
+
+   MappedFile data;
+   std::vector<CheckpointStep> steps;
+   std::vector<std::uint64_t> offsets;
+   std::vector<std::uint64_t> sizes;
+
+   Record record(std::uint64_t step) const;
+
+   void read(const Record& record, std::size_t i, AttributeBase& attribute) const;
+};
+
+}
+
+#endif //PYULB_CHECKPOINT_H
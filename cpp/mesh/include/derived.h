@@ -0,0 +1,149 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_DERIVED_H
+#define PYULB_DERIVED_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "attribute.h"
+
+namespace mesh
+{
+
+/**
+ * An attribute computed from other attributes by a kernel, e.g. material properties from the temperature. The values
+ * are recomputed on access, when the version of an input has changed since the last computation, so a derived
+ * attribute whose inputs are unchanged costs a comparison of version counters per access.
+ *
+ * Elementwise kernels compute the values of an entity only from the values of the same entity of the inputs, which
+ * then all have to be at the same location. They are recomputed only for the range of entities changed since, other
+ * kernels for all entities. Inputs may be derived attributes themselves. Changes the versions don't see, like moved
+ * vertices for a kernel using the geometry, need a call of invalidate.
+ */
+template<typename T, StorageLocation Location = StorageLocation::VERTEX, typename Layout = AoS>
+class DerivedAttribute final : public Attribute<T, Location, Layout>
+{
+public:
+   /**
+    * Computes the values of an entity, the components of the extents in row major order. It is called in parallel
+    * for different entities and must not throw. The inputs are up to date when it is called, it must read them
+    * through Attribute::value only, as all other accessors bring them up to date again, which recomputes derived
+    * inputs concurrently.
+    */
+   using Kernel = std::function<void(std::size_t entity, T* values)>;
+
+   DerivedAttribute(SystemBase* system, std::string name, const AttributeExtent& extents,
+                    std::vector<const AttributeBase*> inputs, Kernel kernel, bool elementwise = true)
+           : Attribute<T, Location, Layout>(system, std::move(name), extents),
+             inputs(std::move(inputs)),
+             seen(this->inputs.size(), 0),
+             kernel(std::move(kernel)),
+             elementwise(elementwise)
+   {
+      for (const AttributeBase* input : this->inputs) {
+         if (input == nullptr || input == this)
+            throw std::invalid_argument("Derived attribute " + this->name + " has an invalid input");
+         if (elementwise && input->getLocation() != Location)
+            throw std::logic_error("Inputs of the elementwise attribute " + this->name + " have to be at its location");
+      }
+      if (!this->kernel)
+         throw std::invalid_argument("Derived attribute " + this->name + " has no kernel");
+   }
+
+   const std::vector<const AttributeBase*>& getInputs() const noexcept
+   {
+      return inputs;
+   }
+
+   /**
+    * Recomputes all values on the next access.
+    */
+   void invalidate() noexcept override
+   {
+      valid = false;
+   }
+
+protected:
+   void refresh() const override
+   {
+      if (updating)
+         return;
+      updating = true;
+      try {
+         update();
+      } catch (...) {
+         updating = false;
+         throw;
+      }
+      updating = false;
+   }
+
+private:
+   std::vector<const AttributeBase*> inputs;
+   // Versions of the inputs at the last computation
+   mutable std::vector<std::uint64_t> seen;
+   Kernel kernel;
+   bool elementwise;
+   mutable bool valid = false;
+   mutable bool updating = false;
+   mutable std::size_t computed = 0;
+
+   void update() const
+   {
+      const std::size_t n = this->nentities;
+      std::size_t first = n;
+      std::size_t last = 0;
+      const auto include = [&](std::size_t from, std::size_t to) {
+         if (from < to) {
+            first = std::min(first, from);
+            last = std::max(last, to);
+         }
+      };
+      if (!valid)
+         include(0, n);
+      else if (n > computed)
+         include(computed, n);
+      // Every input is brought up to date here by getVersion, derived ones recompute their values one after the
+      // other, so the kernel can read them in parallel without any refresh
+      for (std::size_t i = 0; i < inputs.size(); ++i) {
+         const std::uint64_t version = inputs[i]->getVersion();
+         if (version == seen[i])
+            continue;
+         if (elementwise) {
+            const auto [from, to] = inputs[i]->changedSince(seen[i]);
+            include(from, std::min(to, n));
+         } else {
+            include(0, n);
+         }
+         seen[i] = version;
+      }
+      valid = true;
+      computed = n;
+      if (first >= last)
+         return;
+
+      const std::size_t k = this->components;
+      T* data = this->values.data();
+#pragma omp parallel if ((last - first) * k > 10000)
+      {
+         std::vector<T> entity(k);
+#pragma omp for schedule(static)
+         for (std::size_t e = first; e < last; ++e) {
+            kernel(e, entity.data());
+            for (std::size_t c = 0; c < k; ++c)
+               data[Layout::index(e, c, n, k)] = entity[c];
+         }
+      }
+      this->log.change(first, last);
+   }
+};
+
+}
+
+#endif //PYULB_DERIVED_H
@@ -22,6 +22,11 @@ public:
 
    virtual uint getTopologyDimension() const noexcept = 0;
 
+   /**
+    * @return The mesh holding the points of the element
+    */
+   virtual MeshBase* getMesh() const noexcept = 0;
+
    virtual ID operator[](std::size_t idx) const = 0;
 
    virtual Eigen::VectorXd center() const = 0;
@@ -59,6 +64,8 @@ public:
 
    ID getID() const noexcept override;
 
+   MeshBase* getMesh() const noexcept override;
+
    ID operator[](std::size_t idx) const override;
 
    std::size_t getNumVertices() const noexcept override;
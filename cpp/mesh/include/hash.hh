@@ -8,6 +8,10 @@
 #include <numeric>
 #include <array>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <utility>
 
 #include "utils.hh"
 #include "elements.h"
@@ -267,6 +271,107 @@ struct generate_hash_type {
 template<typename T, std::size_t N>
 using generate_hash_type_t = typename generate_hash_type<T, N>::type;
 
+/**
+ * Feeds values to a sink as raw bytes, with the size in front of variable length values. All content keys go through
+ * these overloads, so the hash and the recorded bytes of an input always agree. The sink provides write(const unsigned
+ * char*, std::size_t) and value().
+ */
+template<typename Sink>
+class ByteWriter
+{
+   static constexpr bool nothrow = noexcept(std::declval<Sink&>().write(nullptr, 0));
+
+public:
+   ByteWriter& operator()(const void* data, std::size_t nbytes) noexcept(nothrow)
+   {
+      sink.write(static_cast<const unsigned char*>(data), nbytes);
+      return *this;
+   }
+
+   template<typename T>
+   std::enable_if_t<std::is_trivially_copyable_v<T>, ByteWriter&> operator()(const T& value) noexcept(nothrow)
+   {
+      return operator()(&value, sizeof(T));
+   }
+
+   template<typename T>
+   std::enable_if_t<std::is_trivially_copyable_v<T>, ByteWriter&> operator()(const std::vector<T>& values)
+           noexcept(nothrow)
+   {
+      operator()(values.size());
+      return operator()(values.data(), values.size() * sizeof(T));
+   }
+
+   ByteWriter& operator()(const std::string& str) noexcept(nothrow)
+   {
+      operator()(str.size());
+      return operator()(str.data(), str.size());
+   }
+
+   [[nodiscard]]
+   decltype(auto) value() const noexcept
+   {
+      return sink.value();
+   }
+
+private:
+   Sink sink;
+};
+
+/**
+ * 64 bit FNV-1a hash of the bytes.
+ */
+class Fnv1aSink
+{
+public:
+   void write(const unsigned char* bytes, std::size_t nbytes) noexcept
+   {
+      for (std::size_t i = 0; i < nbytes; ++i) {
+         hash ^= bytes[i];
+         hash *= prime;
+      }
+   }
+
+   ullong value() const noexcept
+   {
+      return hash;
+   }
+
+private:
+   static constexpr ullong prime = 1099511628211ULL;
+   ullong hash = 14695981039346656037ULL;
+};
+
+/**
+ * Records the bytes, to compare the full input where a hash alone is not trusted.
+ */
+class RecordingSink
+{
+public:
+   void write(const unsigned char* bytes, std::size_t nbytes)
+   {
+      this->bytes.append(reinterpret_cast<const char*>(bytes), nbytes);
+   }
+
+   const std::string& value() const noexcept
+   {
+      return bytes;
+   }
+
+private:
+   std::string bytes;
+};
+
+/**
+ * Hash used to address content, e.g. the input of a system factory.
+ */
+using Fnv1aHash = ByteWriter<Fnv1aSink>;
+
+/**
+ * Key of the same content as Fnv1aHash, holding all of its bytes.
+ */
+using ByteKey = ByteWriter<RecordingSink>;
+
 }
 
 #endif //PYULB_HASH_HH
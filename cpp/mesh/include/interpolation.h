@@ -0,0 +1,74 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_INTERPOLATION_H
+#define PYULB_INTERPOLATION_H
+
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "attribute.h"
+#include "mesh.h"
+
+namespace mesh
+{
+
+/**
+ * @return The length, area or volume of every simplex of the dimension, 1 for vertices
+ */
+std::vector<double> simplexMeasures(MeshBase* mesh, uint dim);
+
+/**
+ * Maps all components of an attribute with a transfer operator in a parallel sparse matrix vector product. The
+ * attributes need the same extents, their layouts may differ.
+ */
+template<typename T, StorageLocation From, typename FromLayout, StorageLocation To, typename ToLayout>
+void applyTransferOperator(const TransferOperator& op, const Attribute<T, From, FromLayout>& from,
+                           Attribute<T, To, ToLayout>& to)
+{
+   static_assert(std::is_floating_point_v<T>, "Only floating point attributes can be transferred");
+   const std::size_t k = to.getExtents().getSize();
+   if (from.getExtents().getSize() != k)
+      throw std::logic_error("Attributes " + from.getName() + " and " + to.getName() + " have different extents");
+   const std::size_t m = from.getNumEntities();
+   const std::size_t n = to.getNumEntities();
+   if (std::size_t(op.rows()) != n || std::size_t(op.cols()) != m)
+      throw std::logic_error("Transfer operator does not match the attributes");
+   const T* x = static_cast<const T*>(from.data());
+   T* y = to.data();
+#pragma omp parallel for schedule(static)
+   for (Eigen::Index i = 0; i < op.outerSize(); ++i) {
+      for (std::size_t c = 0; c < k; ++c) {
+         double sum = 0.0;
+         for (TransferOperator::InnerIterator it(op, i); it; ++it)
+            sum += it.value() * x[FromLayout::index(it.col(), c, m, k)];
+         y[ToLayout::index(i, c, n, k)] = static_cast<T>(sum);
+      }
+   }
+}
+
+/**
+ * Interpolates the values of an attribute to the entities of another storage location of the same system, e.g.
+ * from the vertices to the cells, with the cached transfer operator of the system mesh (see
+ * MeshBase::transferOperator):
+ *
+ * - To simplices of a higher dimension: the average of the values of the sub-simplices, e.g. of the corners of a
+ *   cell or the edges of a face.
+ * - To simplices of a lower dimension: the average of the values of the simplices they belong to, weighted by their
+ *   length, area or volume, e.g. the area-weighted projection of cell values to the vertices.
+ */
+template<typename T, StorageLocation From, typename FromLayout, StorageLocation To, typename ToLayout>
+void interpolate(const Attribute<T, From, FromLayout>& from, Attribute<T, To, ToLayout>& to)
+{
+   static_assert(From != StorageLocation::SEGMENT && To != StorageLocation::SEGMENT,
+                 "Segment attributes have no simplices to interpolate between");
+   if (from.getSystem() != to.getSystem())
+      throw std::logic_error("Attributes " + from.getName() + " and " + to.getName() + " belong to different systems");
+   applyTransferOperator(*systemMesh(to.getSystem())->transferOperator(From, To), from, to);
+}
+
+}
+
+#endif //PYULB_INTERPOLATION_H
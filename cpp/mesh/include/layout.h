@@ -0,0 +1,82 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_LAYOUT_H
+#define PYULB_LAYOUT_H
+
+#include <cstddef>
+
+namespace mesh
+{
+
+/**
+ * Array of structures of blocks: the values of Block entities are stored component by component, i.e. the first
+ * component of the Block entities, then the second and so on, and the blocks one after the other. The last block is
+ * padded to the full size. A block of 1 entity is the array of structures layout, which stores the values of an
+ * entity together.
+ */
+template<std::size_t Block>
+struct AoSoA
+{
+   static_assert(Block > 0, "Blocks need at least one entity");
+
+   static constexpr std::size_t block = Block;
+
+   /**
+    * @return The position of a component of an entity in the storage of n entities with k components each
+    */
+   static constexpr std::size_t index(std::size_t entity, std::size_t component, std::size_t /*n*/, std::size_t k)
+   {
+      return (entity / Block) * Block * k + component * Block + entity % Block;
+   }
+
+   /**
+    * @return The number of values stored for n entities with k components each
+    */
+   static constexpr std::size_t storageSize(std::size_t n, std::size_t k)
+   {
+      return (n + Block - 1) / Block * Block * k;
+   }
+};
+
+/**
+ * Array of structures, the values of an entity are stored together.
+ */
+using AoS = AoSoA<1>;
+
+/**
+ * Structure of arrays, every component is stored for all entities in a contiguous array of its own.
+ */
+struct SoA
+{
+   // The block covers all entities
+   static constexpr std::size_t block = 0;
+
+   static constexpr std::size_t index(std::size_t entity, std::size_t component, std::size_t n, std::size_t /*k*/)
+   {
+      return component * n + entity;
+   }
+
+   static constexpr std::size_t storageSize(std::size_t n, std::size_t k)
+   {
+      return n * k;
+   }
+};
+
+/**
+ * Copies the values of n entities with k components each from one layout into another. The target has to hold
+ * To::storageSize(n, k) values, padding is left as it is.
+ */
+template<typename From, typename To, typename T>
+void convertLayout(const T* from, T* to, std::size_t n, std::size_t k)
+{
+#pragma omp parallel for if (n * k > 100000)
+   for (std::size_t entity = 0; entity < n; ++entity)
+      for (std::size_t component = 0; component < k; ++component)
+         to[To::index(entity, component, n, k)] = from[From::index(entity, component, n, k)];
+}
+
+}
+
+#endif //PYULB_LAYOUT_H
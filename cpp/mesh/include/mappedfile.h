@@ -0,0 +1,58 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_MAPPEDFILE_H
+#define PYULB_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace mesh
+{
+
+/**
+ * Read-only memory mapping of a whole file. The pages are only loaded by the operating system when accessed.
+ */
+class MappedFile
+{
+public:
+   explicit MappedFile(const std::string& path);
+
+   MappedFile(const MappedFile&) = delete;
+
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   MappedFile(MappedFile&& file) noexcept;
+
+   MappedFile& operator=(MappedFile&& file) noexcept;
+
+   ~MappedFile();
+
+   [[nodiscard]]
+   const char* data() const noexcept
+   {
+      return _data;
+   }
+
+   [[nodiscard]]
+   std::size_t size() const noexcept
+   {
+      return _size;
+   }
+
+   [[nodiscard]]
+   const std::string& path() const noexcept
+   {
+      return _path;
+   }
+
+private:
+   std::string _path;
+   const char* _data = nullptr;
+   std::size_t _size = 0;
+};
+
+}
+
+#endif //PYULB_MAPPEDFILE_H
@@ -25,6 +25,13 @@ namespace mesh
 template<uint Dim, uint TopDim>
 class System;
 
+/**
+ * Sparse operator, which maps values of the simplices of one dimension to those of another, see interpolation.h.
+ */
+using TransferOperator = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+struct TransferOperators;
+
 class ConstMeshElementsProxy
 {
 public:
@@ -232,19 +239,93 @@ public:
       return elements.size();
    }
 
+   [[nodiscard]]
+   uint getSimplexDimension() const noexcept
+   {
+      return elements.getSimplexDimension();
+   }
+
+   [[nodiscard]]
+   MeshBase* getMesh() const noexcept
+   {
+      return elements.getMesh();
+   }
+
    virtual MeshElement* create(const std::vector<ID>& vertices) = 0;
 
    MeshElementsProxy& add(const EigenDRef<const MatrixXid>& indices)
    {
-      for (size_t irow = 0; irow < indices.rows(); ++irow) {
-         std::vector<ID> data;
-         data.reserve(indices.cols());
-         for (std::size_t i = 0; i < indices.cols(); ++i) data.push_back(indices.row(irow)[i]);
-         create(data);
+      return add(indices.data(), indices.rows(), indices.cols(), indices.innerStride(), indices.outerStride());
+   }
+
+   /**
+    * Creates n simplices of k vertices each. The indices may be of any integer type and layout, vertex j of simplex
+    * i is taken from indices[i * row_stride + j * col_stride].
+    */
+   template<typename T>
+   MeshElementsProxy& add(const T* indices, std::size_t n, std::size_t k, std::ptrdiff_t row_stride,
+                          std::ptrdiff_t col_stride)
+   {
+      std::vector<ID> vertices(k);
+      // Signed offsets, the strides of a reversed view are negative
+      for (std::ptrdiff_t i = 0; i < std::ptrdiff_t(n); ++i) {
+         for (std::ptrdiff_t j = 0; j < std::ptrdiff_t(k); ++j)
+            vertices[j] = static_cast<ID>(indices[i * row_stride + j * col_stride]);
+         create(vertices);
       }
       return *this;
    }
 
+   /**
+    * Appends simplices without looking them up first, so the caller has to guarantee that none of them exists yet.
+    *
+    * @param vertices The vertex IDs of the simplices as flat list
+    * @param n The number of simplices
+    */
+   MeshElementsProxy& append(const ID* vertices, std::size_t n)
+   {
+      elements.append(vertices, n);
+      return *this;
+   }
+
+   /**
+    * References simplices of the root mesh by their IDs, which must not be referenced yet. For a root mesh this is a
+    * no-op.
+    */
+   MeshElementsProxy& reference(const ID* ids, std::size_t n)
+   {
+      elements.reference(ids, n);
+      return *this;
+   }
+
+   /**
+    * @return The vertex IDs of all simplices of the root mesh as flat list, ordered by simplex ID. The list grows with
+    * the root mesh, so its data may move when simplices are added.
+    */
+   [[nodiscard]]
+   const std::vector<ID>& connectivity() const noexcept
+   {
+      return elements.connectivity();
+   }
+
+   /**
+    * @return The IDs in the root mesh of the simplices of a child mesh, nullptr for a root mesh
+    */
+   [[nodiscard]]
+   const std::vector<ID>* referencedIDs() const noexcept
+   {
+      return elements.referencedIDs();
+   }
+
+   /**
+    * @return A counter, which grows whenever simplices are added to the root mesh or it is cleared
+    */
+   [[nodiscard]]
+   std::uint64_t getRevision() const noexcept
+   {
+      return elements.getRevision();
+   }
+
    virtual MeshElementsProxy& getOrCreateFromFacets(const EigenDRef<const MatrixXid>& indices)
    {
       throw std::logic_error("Mesh element does not have facets");
@@ -272,6 +353,26 @@ protected:
 class MeshBase
 {
 public:
+   MeshBase() = default;
+
+   /**
+    * Copies start without transfer operators, as the cached ones belong to the simplices of the original.
+    */
+   MeshBase(const MeshBase&) noexcept
+   {}
+
+   MeshBase(MeshBase&&) noexcept = default;
+
+   MeshBase& operator=(const MeshBase&) noexcept
+   {
+      transfer_operators.reset();
+      return *this;
+   }
+
+   MeshBase& operator=(MeshBase&&) noexcept = default;
+
+   virtual ~MeshBase() = default;
+
    [[nodiscard]]
    virtual std::vector<double>& getPointList() const = 0;
 
@@ -294,6 +395,48 @@ public:
    {
       throw std::runtime_error("Mesh does not have peaks");
    }
+
+   [[nodiscard]]
+   virtual uint getDimension() const noexcept = 0;
+
+   [[nodiscard]]
+   virtual uint getTopologyDimension() const noexcept = 0;
+
+   /**
+    * @param dim The topological dimension of the simplices
+    * @return The simplices of the given dimension, e.g. the vertices for 0
+    */
+   MeshElementsProxy& simplices(uint dim)
+   {
+      const uint topdim = getTopologyDimension();
+      if (dim > topdim)
+         throw std::out_of_range("Simplex dimension exceeds the topological dimension of the mesh");
+      switch (topdim - dim) {
+         case 0:
+            return bodies();
+         case 1:
+            return facets();
+         case 2:
+            return ridges();
+         default:
+            return peaks();
+      }
+   }
+
+   /**
+    * @return The operator interpolating values of the simplices of dimension from to those of dimension to. It is
+    * built on first use and rebuilt once simplices of either dimension were added or cleared, see
+    * MeshElementsProxy::getRevision. Only root meshes have operators.
+    */
+   std::shared_ptr<const TransferOperator> transferOperator(uint from, uint to);
+
+   /**
+    * Drops the cached transfer operators, which have to be rebuilt after points were moved.
+    */
+   void clearTransferOperators();
+
+private:
+   std::shared_ptr<TransferOperators> transfer_operators;
 };
 
 template<uint Dim, uint TopDim = Dim>
@@ -317,6 +460,15 @@ public:
 
       VerticesProxy& add(const EigenDRef<const Eigen::MatrixXd>& points);
 
+      /**
+       * Adds n points as new vertices in one go. The coordinates may be of any layout, coordinate d of point i is
+       * taken from points[i * row_stride + d * col_stride].
+       *
+       * @tparam T float or double
+       */
+      template<typename T>
+      VerticesProxy& add(const T* points, std::size_t n, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride);
+
       MeshElement* create(const std::vector<ID>& vertices) override;
 
    private:
@@ -345,6 +497,12 @@ public:
    [[nodiscard]]
    std::vector<double>& getPointList() const override;
 
+   [[nodiscard]]
+   uint getDimension() const noexcept override;
+
+   [[nodiscard]]
+   uint getTopologyDimension() const noexcept override;
+
    MeshElementsProxy& bodies() override;
 
    VerticesProxy& vertices();
@@ -401,6 +559,9 @@ public:
    template<uint TopDim>
    explicit Mesh(Mesh<Dim, TopDim>* mesh);
 
+   [[nodiscard]]
+   uint getTopologyDimension() const noexcept override;
+
    MeshElementsProxy& bodies() override;
 
    MeshElementsProxy& facets() override;
@@ -458,6 +619,9 @@ public:
 
    Mesh& operator=(Mesh&& seg) noexcept = default;
 
+   [[nodiscard]]
+   uint getTopologyDimension() const noexcept override;
+
    MeshElementsProxy& bodies() override;
 
    MeshElementsProxy& facets() override;
@@ -483,6 +647,22 @@ protected:
 template<>
 class Mesh<3, 3> : public Mesh<3, 2>
 {
+   friend System<3, 3>;
+
+public:
+   class CellsProxy : public MeshElementsProxy
+   {
+   public:
+      CellsProxy() = delete;
+
+      explicit CellsProxy(Mesh<3, 3>* mesh);
+
+      MeshElement* create(const std::vector<ID>& indices) override;
+
+   private:
+      Mesh<3, 3>* mesh;
+   };
+
 public:
    Mesh();
 
@@ -500,6 +680,19 @@ public:
 
    explicit Mesh(Mesh<3, 3>* mesh);
 
+   [[nodiscard]]
+   uint getTopologyDimension() const noexcept override;
+
+   MeshElementsProxy& bodies() override;
+
+   MeshElementsProxy& facets() override;
+
+   MeshElementsProxy& ridges() override;
+
+   MeshElementsProxy& peaks() override;
+
+   CellsProxy& cells();
+
    Simplex<3, 3>* getCell(std::size_t idx) const;
 
    Simplex<3, 3>* getCellByID(ID id) const;
@@ -507,13 +700,8 @@ public:
    std::size_t getNumCells() const;
 
 protected:
-   std::unique_ptr<ID[]> cells_lst_owner;
-   std::vector<ID>* cells_lst;
-
-   std::vector<std::unique_ptr<Cell>> cells;
-   std::unordered_multimap<ullong, Cell*> point2body;
-   std::unordered_multimap<ullong, Cell*> edge2body;
-   std::unordered_multimap<ullong, Cell*> face2body;
+   SimplexContainer<3, 3> cells_container;
+   std::unique_ptr<CellsProxy> cells_proxy;
 };
 
 template<uint Dim, uint TopDim>
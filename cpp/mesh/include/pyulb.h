@@ -0,0 +1,92 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+/*
+ * C interface to systems for native code, which is independent of the C++ templates and their ABI. Systems are
+ * passed as opaque handles and arrays are exported as DLPack tensors without copying. The tensors are read-only,
+ * they keep systems opened through this interface alive until their deleter is called. Borrowed systems have to
+ * outlive their tensors.
+ *
+ * All functions returning int give 0 on success and -1 on failure, the reason is then found by pyulb_last_error.
+ */
+
+#ifndef PYULB_PYULB_H
+#define PYULB_PYULB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dlpack.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pyulb_system_s* pyulb_system;
+
+/**
+ * @return The message of the last failure on the calling thread
+ */
+const char* pyulb_last_error(void);
+
+/**
+ * Maps a system file written by System::write.
+ */
+int pyulb_system_open(const char* path, pyulb_system* system);
+
+/**
+ * Maps a system placed in shared memory by System::share.
+ */
+int pyulb_system_attach(const char* name, pyulb_system* system);
+
+/**
+ * Wraps a live system without taking ownership, e.g. the address given by get_raw_address in Python.
+ */
+int pyulb_system_borrow(uint64_t address, uint32_t dim, uint32_t topdim, pyulb_system* system);
+
+void pyulb_system_free(pyulb_system system);
+
+int pyulb_system_dimensions(pyulb_system system, uint32_t* dim, uint32_t* topdim);
+
+int pyulb_system_num_segments(pyulb_system system, size_t* nsegments);
+
+/**
+ * @param name Set to the name of the segment, valid as long as the system
+ */
+int pyulb_system_segment_name(pyulb_system system, size_t segment, const char** name);
+
+/**
+ * Exports the point coordinates as (npoints, dim) float64 tensor.
+ */
+int pyulb_system_coordinates(pyulb_system system, DLManagedTensor** tensor);
+
+/**
+ * Exports the vertex IDs of all simplices of the given dimension as (nsimplices, simplex_dim + 1) int64 tensor.
+ */
+int pyulb_system_connectivity(pyulb_system system, uint32_t simplex_dim, DLManagedTensor** tensor);
+
+/**
+ * Exports the IDs of the simplices of the given dimension belonging to a segment as int64 tensor.
+ */
+int pyulb_system_segment_simplices(pyulb_system system, size_t segment, uint32_t simplex_dim,
+                                   DLManagedTensor** tensor);
+
+/**
+ * Exports the IDs of the simplices of the given dimension belonging to the interface between two segments as int64
+ * tensor, which is empty if the segments have no interface.
+ */
+int pyulb_system_interface_simplices(pyulb_system system, size_t segment1, size_t segment2, uint32_t simplex_dim,
+                                     DLManagedTensor** tensor);
+
+/**
+ * Exports the values of an attribute, with the number of entities as first extent followed by the attribute extents.
+ * Attributes of a borrowed system in the SoA layout come with strides, those in AoSoA blocks cannot be exported.
+ */
+int pyulb_system_attribute(pyulb_system system, const char* name, DLManagedTensor** tensor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //PYULB_PYULB_H
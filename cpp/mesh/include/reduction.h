@@ -0,0 +1,235 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_REDUCTION_H
+#define PYULB_REDUCTION_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "attribute.h"
+
+namespace mesh
+{
+
+enum class ReductionDomain
+{
+   SEGMENTS,
+   INTERFACES
+};
+
+/**
+ * Weighted statistics of an attribute, one row per segment or interface and one column per component, in row major
+ * order. Rows without entities have a mean, minimum and maximum of NaN.
+ */
+struct ReductionTable
+{
+   std::size_t rows = 0;
+   std::size_t columns = 0;
+   std::vector<std::string> names;
+   std::vector<std::size_t> count;
+   // Sum of the weights, i.e. the length, area or volume of the segment or interface
+   std::vector<double> measure;
+   std::vector<double> integral;
+   std::vector<double> mean;
+   std::vector<double> min;
+   std::vector<double> max;
+   // Square root of the integral of the square
+   std::vector<double> l2;
+};
+
+/**
+ * Entities and weights of every segment or interface at a storage location, rows one after the other.
+ */
+struct ReductionRows
+{
+   std::vector<std::string> names;
+   // Entities of row r from entities[offsets[r]] to entities[offsets[r + 1]] - 1
+   std::vector<std::size_t> offsets;
+   std::vector<ID> entities;
+   std::vector<double> weights;
+   std::vector<double> measure;
+   // Number of entities of the system at the location, when the rows were collected
+   std::size_t nentities = 0;
+};
+
+/**
+ * Partial sums of a chunk of entities.
+ */
+struct ReductionPartial
+{
+   double integral = 0.0;
+   double square = 0.0;
+   double min = std::numeric_limits<double>::infinity();
+   double max = -std::numeric_limits<double>::infinity();
+
+   ReductionPartial operator+(const ReductionPartial& other) const noexcept
+   {
+      return {integral + other.integral, square + other.square, std::min(min, other.min), std::max(max, other.max)};
+   }
+};
+
+/**
+ * Kahan summation of a chunk.
+ */
+class KahanSum
+{
+public:
+   void add(double value) noexcept
+   {
+      const double y = value - compensation;
+      const double t = sum + y;
+      compensation = (t - sum) - y;
+      sum = t;
+   }
+
+   double value() const noexcept
+   {
+      return sum;
+   }
+
+private:
+   double sum = 0.0;
+   double compensation = 0.0;
+};
+
+/**
+ * @return The pairwise sum of n partials, every stride-th one
+ */
+inline ReductionPartial pairwiseSum(const ReductionPartial* partials, std::size_t n, std::size_t stride)
+{
+   if (n == 0)
+      return ReductionPartial();
+   if (n == 1)
+      return partials[0];
+   const std::size_t half = n / 2;
+   return pairwiseSum(partials, half, stride) + pairwiseSum(partials + half * stride, n - half, stride);
+}
+
+/**
+ * Computes the integral, mean, minimum, maximum and L2 norm of an attribute over every segment or along every
+ * interface of a system in one parallel pass. Values are weighted by the measure of their entities, vertex values by
+ * an equal share of the measure of the adjacent cells (or facets for interfaces) of the segment.
+ *
+ * The entities are summed in chunks of fixed size with Kahan summation and the chunks are added pairwise, so the
+ * results do not depend on the number of threads. The entities and weights are collected once per location; after
+ * moving vertices clear has to be called.
+ */
+class SegmentReduction
+{
+public:
+   // Entities per chunk
+   static constexpr std::size_t chunk = 4096;
+
+   explicit SegmentReduction(SystemBase* system, ReductionDomain domain = ReductionDomain::SEGMENTS);
+
+   template<typename T, StorageLocation Location, typename Layout>
+   ReductionTable operator()(const Attribute<T, Location, Layout>& attribute)
+   {
+      if (attribute.getSystem() != system)
+         throw std::logic_error("Attribute " + attribute.getName() + " does not belong to the system of the reduction");
+      const std::size_t n = attribute.getNumEntities();
+      const std::size_t k = attribute.getExtents().getSize();
+      const auto* values = static_cast<const T*>(attribute.data());
+      return reduce(rows(Location), k, [=](ID entity, std::size_t c) {
+         return double(values[Layout::index(entity, c, n, k)]);
+      });
+   }
+
+   /**
+    * Reduces an attribute of any type and layout, by way of a copy of its values in double precision.
+    */
+   ReductionTable operator()(const AttributeBase& attribute);
+
+   /**
+    * Collects the entities and weights again on the next reduction.
+    */
+   void clear() noexcept;
+
+   ReductionDomain getDomain() const noexcept
+   {
+      return domain;
+   }
+
+private:
+   SystemBase* system;
+   ReductionDomain domain;
+   std::array<std::unique_ptr<ReductionRows>, 4> cache;
+
+   const ReductionRows& rows(StorageLocation location);
+
+   template<typename Value>
+   static ReductionTable reduce(const ReductionRows& rows, std::size_t k, Value value)
+   {
+      const std::size_t nrows = rows.offsets.size() - 1;
+      std::vector<std::size_t> first_chunk(nrows + 1, 0);
+      for (std::size_t r = 0; r < nrows; ++r)
+         first_chunk[r + 1] = first_chunk[r] + (rows.offsets[r + 1] - rows.offsets[r] + chunk - 1) / chunk;
+      const std::size_t nchunks = first_chunk.back();
+      std::vector<ReductionPartial> partials(nchunks * k);
+
+#pragma omp parallel
+      {
+         std::vector<KahanSum> integral(k);
+         std::vector<KahanSum> square(k);
+#pragma omp for schedule(dynamic)
+         for (std::size_t t = 0; t < nchunks; ++t) {
+            const std::size_t r = std::upper_bound(first_chunk.begin(), first_chunk.end(), t) - first_chunk.begin() - 1;
+            const std::size_t first = rows.offsets[r] + (t - first_chunk[r]) * chunk;
+            const std::size_t last = std::min(first + chunk, rows.offsets[r + 1]);
+            std::fill(integral.begin(), integral.end(), KahanSum());
+            std::fill(square.begin(), square.end(), KahanSum());
+            ReductionPartial* partial = partials.data() + t * k;
+            for (std::size_t i = first; i < last; ++i) {
+               const double w = rows.weights[i];
+               for (std::size_t c = 0; c < k; ++c) {
+                  const double v = value(rows.entities[i], c);
+                  integral[c].add(w * v);
+                  square[c].add(w * v * v);
+                  partial[c].min = std::min(partial[c].min, v);
+                  partial[c].max = std::max(partial[c].max, v);
+               }
+            }
+            for (std::size_t c = 0; c < k; ++c) {
+               partial[c].integral = integral[c].value();
+               partial[c].square = square[c].value();
+            }
+         }
+      }
+
+      ReductionTable table;
+      table.rows = nrows;
+      table.columns = k;
+      table.names = rows.names;
+      table.measure = rows.measure;
+      table.count.resize(nrows);
+      for (auto* column : {&table.integral, &table.mean, &table.min, &table.max, &table.l2})
+         column->resize(nrows * k);
+      const double nan = std::numeric_limits<double>::quiet_NaN();
+      for (std::size_t r = 0; r < nrows; ++r) {
+         table.count[r] = rows.offsets[r + 1] - rows.offsets[r];
+         for (std::size_t c = 0; c < k; ++c) {
+            const ReductionPartial sum = pairwiseSum(partials.data() + first_chunk[r] * k + c,
+                                                     first_chunk[r + 1] - first_chunk[r], k);
+            const bool empty = table.count[r] == 0;
+            table.integral[r * k + c] = sum.integral;
+            table.mean[r * k + c] = rows.measure[r] > 0.0 ? sum.integral / rows.measure[r] : nan;
+            table.min[r * k + c] = empty ? nan : sum.min;
+            table.max[r * k + c] = empty ? nan : sum.max;
+            table.l2[r * k + c] = std::sqrt(sum.square);
+         }
+      }
+      return table;
+   }
+};
+
+}
+
+#endif //PYULB_REDUCTION_H
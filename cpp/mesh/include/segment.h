@@ -73,6 +73,7 @@ private:
 template<uint Dim, uint TopDim>
 class Interface : public Segment<Dim, TopDim - 1>
 {
+   friend System<Dim, TopDim>;
 public:
    using Segment<Dim, TopDim - 1>::Segment;
 
@@ -87,8 +88,8 @@ public:
    std::pair<Segment<Dim, TopDim>*, Segment<Dim, TopDim>*> segments() const;
 
 private:
-   Segment<Dim, TopDim>* seg1;
-   Segment<Dim, TopDim>* seg2;
+   Segment<Dim, TopDim>* seg1 = nullptr;
+   Segment<Dim, TopDim>* seg2 = nullptr;
 };
 
 }
@@ -0,0 +1,131 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_SEGMENTVIEW_H
+#define PYULB_SEGMENTVIEW_H
+
+#include <stdexcept>
+#include <vector>
+
+#include "attribute.h"
+#include "selector.h"
+
+namespace mesh
+{
+
+/**
+ * The values of an attribute for the entities of one segment or interface, packed into a dense array in the order of
+ * the segment mesh, so that kernels of a material run on contiguous data. The index map into the system is computed
+ * once, gather and scatter copy the values in parallel:
+ *
+ *    SegmentView<double, CELL> view(temperature, system->segment("steel"));
+ *    kernel(view.data(), view.getNumEntities());
+ *    view.scatter();
+ *
+ * The packed values are always in the AoS layout, whatever the layout of the attribute.
+ */
+template<typename T, StorageLocation Location = StorageLocation::VERTEX, typename Layout = AoS>
+class SegmentView
+{
+public:
+   /**
+    * Gathers the values of the segment.
+    */
+   SegmentView(Attribute<T, Location, Layout>& attribute, const SegmentBase* segment)
+           : attribute(&attribute),
+             segment(segment),
+             entities(segmentEntities(segment, Location, attribute.getNumEntities())),
+             components(attribute.getExtents().getSize()),
+             values(entities.size() * components)
+   {
+      gather();
+   }
+
+   /**
+    * Copies the current values of the attribute into the view.
+    */
+   void gather()
+   {
+      attribute->gather(entities, values.data());
+   }
+
+   /**
+    * Writes the values of the view back to the attribute.
+    */
+   void scatter()
+   {
+      attribute->scatter(entities, values.data());
+   }
+
+   const SegmentBase* getSegment() const noexcept
+   {
+      return segment;
+   }
+
+   /**
+    * @return The IDs in the system of the entities of the view
+    */
+   const std::vector<ID>& getEntities() const noexcept
+   {
+      return entities;
+   }
+
+   std::size_t getNumEntities() const noexcept
+   {
+      return entities.size();
+   }
+
+   std::size_t getNumComponents() const noexcept
+   {
+      return components;
+   }
+
+   T* data() noexcept
+   {
+      return values.data();
+   }
+
+   const T* data() const noexcept
+   {
+      return values.data();
+   }
+
+   T* begin() noexcept
+   {
+      return values.data();
+   }
+
+   T* end() noexcept
+   {
+      return values.data() + values.size();
+   }
+
+   /**
+    * @return The values of the i-th entity of the segment
+    */
+   T* operator()(std::size_t i)
+   {
+      if (i >= entities.size())
+         throw std::out_of_range("Entity does not exist in the segment");
+      return values.data() + i * components;
+   }
+
+   T& at(std::size_t i, std::size_t component)
+   {
+      if (i >= entities.size() || component >= components)
+         throw std::out_of_range("Entity or component does not exist");
+      return values[i * components + component];
+   }
+
+private:
+   Attribute<T, Location, Layout>* attribute;
+   const SegmentBase* segment;
+   std::vector<ID> entities;
+   std::size_t components;
+   std::vector<T> values;
+};
+
+}
+
+#endif //PYULB_SEGMENTVIEW_H
@@ -0,0 +1,330 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_SELECTOR_H
+#define PYULB_SELECTOR_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "attribute.h"
+#include "bitset.h"
+#include "types.h"
+
+namespace mesh
+{
+
+/*
+ * Selectors for masked assignments to attributes, e.g.
+ *
+ *    velocity[0](inSegment(system->segment("inlet")) & ~inBox<VERTEX, 3>(lower, upper)) = 1.0;
+ *
+ * Compositions with &, | and ~ keep their operands by value and are evaluated together, one word of 64 entities
+ * after the other, when the attribute applies them.
+ */
+
+class SegmentBase;
+
+/**
+ * Coordinates of the vertices and the vertices of the simplices at a storage location.
+ */
+struct EntityGeometry
+{
+   const double* points = nullptr;
+   std::size_t dim = 0;
+   // Vertex IDs of the simplices as flat list, nullptr for vertices
+   const ID* vertices = nullptr;
+   std::size_t nvertices = 1;
+};
+
+EntityGeometry entityGeometry(MeshBase* mesh, StorageLocation location);
+
+/**
+ * @return The n entities at the location, which belong to the segment or interface. At the location SEGMENT this is
+ * the segment itself.
+ */
+Bitset segmentMembers(const SegmentBase* segment, StorageLocation location, std::size_t n);
+
+/**
+ * @return The IDs of the entities at the location, which belong to the segment or interface, in the order of the
+ * segment mesh. All are checked to be less than n, the number of entities of the system.
+ */
+std::vector<ID> segmentEntities(const SegmentBase* segment, StorageLocation location, std::size_t n);
+
+template<typename S, typename = void>
+struct IsSelector : std::false_type
+{
+};
+
+template<typename S>
+struct IsSelector<S, std::enable_if_t<std::is_base_of_v<SelectorBase<S::location>, S>>> : std::true_type
+{
+};
+
+template<typename A, typename B>
+class And final : public SelectorBase<A::location>
+{
+public:
+   And(A a, B b) : a(std::move(a)), b(std::move(b))
+   {}
+
+   void bind(MeshBase* mesh, std::size_t n) const override
+   {
+      a.bind(mesh, n);
+      b.bind(mesh, n);
+   }
+
+   std::uint64_t word(std::size_t iword) const override
+   {
+      return a.word(iword) & b.word(iword);
+   }
+
+private:
+   A a;
+   B b;
+};
+
+template<typename A, typename B>
+class Or final : public SelectorBase<A::location>
+{
+public:
+   Or(A a, B b) : a(std::move(a)), b(std::move(b))
+   {}
+
+   void bind(MeshBase* mesh, std::size_t n) const override
+   {
+      a.bind(mesh, n);
+      b.bind(mesh, n);
+   }
+
+   std::uint64_t word(std::size_t iword) const override
+   {
+      return a.word(iword) | b.word(iword);
+   }
+
+private:
+   A a;
+   B b;
+};
+
+template<typename A>
+class Not final : public SelectorBase<A::location>
+{
+public:
+   explicit Not(A a) : a(std::move(a))
+   {}
+
+   void bind(MeshBase* mesh, std::size_t n) const override
+   {
+      a.bind(mesh, n);
+   }
+
+   std::uint64_t word(std::size_t iword) const override
+   {
+      return ~a.word(iword);
+   }
+
+private:
+   A a;
+};
+
+template<typename A, typename B, typename = std::enable_if_t<IsSelector<A>::value && IsSelector<B>::value>>
+And<A, B> operator&(A a, B b)
+{
+   static_assert(A::location == B::location, "Selectors of different storage locations cannot be combined");
+   return And<A, B>(std::move(a), std::move(b));
+}
+
+template<typename A, typename B, typename = std::enable_if_t<IsSelector<A>::value && IsSelector<B>::value>>
+Or<A, B> operator|(A a, B b)
+{
+   static_assert(A::location == B::location, "Selectors of different storage locations cannot be combined");
+   return Or<A, B>(std::move(a), std::move(b));
+}
+
+template<typename A, typename = std::enable_if_t<IsSelector<A>::value>>
+Not<A> operator~(A a)
+{
+   return Not<A>(std::move(a));
+}
+
+/**
+ * Selects the entities, whose point (vertices) or centroid (simplices) fulfils the predicate. The predicate is
+ * called with a pointer to the coordinates.
+ */
+template<StorageLocation Location, typename Predicate>
+class Where final : public SelectorBase<Location>
+{
+public:
+   explicit Where(Predicate predicate) : predicate(std::move(predicate))
+   {}
+
+   void bind(MeshBase* mesh, std::size_t n) const override
+   {
+      geometry = entityGeometry(mesh, Location);
+      this->n = n;
+   }
+
+   std::uint64_t word(std::size_t iword) const override
+   {
+      const std::size_t first = iword * Bitset::word_bits;
+      const std::size_t last = std::min(first + Bitset::word_bits, n);
+      std::uint64_t bits = 0;
+      std::array<double, 3> centroid{};
+      for (std::size_t i = first; i < last; ++i) {
+         const double* x;
+         if (geometry.vertices == nullptr) {
+            x = geometry.points + i * geometry.dim;
+         } else {
+            centroid.fill(0.0);
+            for (std::size_t j = 0; j < geometry.nvertices; ++j) {
+               const double* point = geometry.points + geometry.vertices[i * geometry.nvertices + j] * geometry.dim;
+               for (std::size_t d = 0; d < geometry.dim; ++d)
+                  centroid[d] += point[d] / geometry.nvertices;
+            }
+            x = centroid.data();
+         }
+         if (predicate(x))
+            bits |= std::uint64_t(1) << (i - first);
+      }
+      return bits;
+   }
+
+private:
+   Predicate predicate;
+   mutable EntityGeometry geometry;
+   mutable std::size_t n = 0;
+};
+
+template<StorageLocation Location = StorageLocation::VERTEX, typename Predicate>
+Where<Location, Predicate> where(Predicate predicate)
+{
+   return Where<Location, Predicate>(std::move(predicate));
+}
+
+/**
+ * Selects the entities inside the closed axis aligned box.
+ */
+template<StorageLocation Location = StorageLocation::VERTEX, std::size_t Dim>
+auto inBox(const std::array<double, Dim>& lower, const std::array<double, Dim>& upper)
+{
+   return where<Location>([lower, upper](const double* x) {
+      for (std::size_t d = 0; d < Dim; ++d)
+         if (x[d] < lower[d] || x[d] > upper[d])
+            return false;
+      return true;
+   });
+}
+
+/**
+ * Selects the entities inside the closed ball.
+ */
+template<StorageLocation Location = StorageLocation::VERTEX, std::size_t Dim>
+auto inBall(const std::array<double, Dim>& center, double radius)
+{
+   return where<Location>([center, radius](const double* x) {
+      double distance = 0.0;
+      for (std::size_t d = 0; d < Dim; ++d)
+         distance += (x[d] - center[d]) * (x[d] - center[d]);
+      return distance <= radius * radius;
+   });
+}
+
+/**
+ * Selects the entities of a segment or interface.
+ */
+template<StorageLocation Location>
+class InSegment final : public SelectorBase<Location>
+{
+public:
+   explicit InSegment(const SegmentBase* segment) : segment(segment)
+   {}
+
+   void bind(MeshBase* /*mesh*/, std::size_t n) const override
+   {
+      members = segmentMembers(segment, Location, n);
+   }
+
+   std::uint64_t word(std::size_t iword) const override
+   {
+      return members.words()[iword];
+   }
+
+private:
+   const SegmentBase* segment;
+   mutable Bitset members;
+};
+
+template<StorageLocation Location = StorageLocation::VERTEX>
+InSegment<Location> inSegment(const SegmentBase* segment)
+{
+   return InSegment<Location>(segment);
+}
+
+/**
+ * Selects the entities, whose component of an attribute is above (or below) a threshold.
+ */
+template<typename T, StorageLocation Location, typename Layout>
+class Threshold final : public SelectorBase<Location>
+{
+public:
+   Threshold(const Attribute<T, Location, Layout>& attribute, T threshold, bool above, std::size_t component)
+           : attribute(attribute), threshold(threshold), above(above), component(component)
+   {
+      if (component >= attribute.getExtents().getSize())
+         throw std::out_of_range("Component does not exist");
+   }
+
+   void bind(MeshBase* /*mesh*/, std::size_t n) const override
+   {
+      if (attribute.getNumEntities() != n)
+         throw std::logic_error("Attribute " + attribute.getName() + " belongs to another system");
+      values = static_cast<const T*>(attribute.data());
+      this->n = n;
+   }
+
+   std::uint64_t word(std::size_t iword) const override
+   {
+      const std::size_t first = iword * Bitset::word_bits;
+      const std::size_t last = std::min(first + Bitset::word_bits, n);
+      const std::size_t k = attribute.getExtents().getSize();
+      std::uint64_t bits = 0;
+      for (std::size_t i = first; i < last; ++i) {
+         const T value = values[Layout::index(i, component, n, k)];
+         bits |= std::uint64_t(above ? value > threshold : value < threshold) << (i - first);
+      }
+      return bits;
+   }
+
+private:
+   const Attribute<T, Location, Layout>& attribute;
+   T threshold;
+   bool above;
+   std::size_t component;
+   mutable const T* values = nullptr;
+   mutable std::size_t n = 0;
+};
+
+template<typename T, StorageLocation Location, typename Layout>
+Threshold<T, Location, Layout> above(const Attribute<T, Location, Layout>& attribute,
+                                     typename std::common_type<T>::type threshold,
+                                     std::size_t component = 0)
+{
+   return Threshold<T, Location, Layout>(attribute, threshold, true, component);
+}
+
+template<typename T, StorageLocation Location, typename Layout>
+Threshold<T, Location, Layout> below(const Attribute<T, Location, Layout>& attribute,
+                                     typename std::common_type<T>::type threshold,
+                                     std::size_t component = 0)
+{
+   return Threshold<T, Location, Layout>(attribute, threshold, false, component);
+}
+
+}
+
+#endif //PYULB_SELECTOR_H
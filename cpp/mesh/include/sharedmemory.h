@@ -0,0 +1,76 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_SHAREDMEMORY_H
+#define PYULB_SHAREDMEMORY_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace mesh
+{
+
+/**
+ * Mapping of a POSIX shared memory segment. The creator maps it writable and removes its name again when destroyed,
+ * processes attaching to it map it read-only and keep their mapping until they are destroyed themselves.
+ */
+class SharedMemory
+{
+public:
+   /**
+    * Creates a new segment of the given size, the name must not be in use.
+    */
+   static std::unique_ptr<SharedMemory> create(const std::string& name, std::size_t size);
+
+   /**
+    * Maps an existing segment read-only.
+    */
+   static std::unique_ptr<SharedMemory> attach(const std::string& name);
+
+   SharedMemory(const SharedMemory&) = delete;
+
+   SharedMemory& operator=(const SharedMemory&) = delete;
+
+   ~SharedMemory();
+
+   [[nodiscard]]
+   const char* data() const noexcept
+   {
+      return _data;
+   }
+
+   /**
+    * @return The writable memory of a created segment, nullptr for an attached one
+    */
+   [[nodiscard]]
+   char* mutableData() noexcept
+   {
+      return owner ? _data : nullptr;
+   }
+
+   [[nodiscard]]
+   std::size_t size() const noexcept
+   {
+      return _size;
+   }
+
+   [[nodiscard]]
+   const std::string& name() const noexcept
+   {
+      return _name;
+   }
+
+private:
+   SharedMemory(std::string name, char* data, std::size_t size, bool owner);
+
+   std::string _name;
+   char* _data;
+   std::size_t _size;
+   bool owner;
+};
+
+}
+
+#endif //PYULB_SHAREDMEMORY_H
@@ -9,6 +9,7 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <cstdint>
 #include <type_traits>
 
 #include "utils.hh"
@@ -24,6 +25,36 @@ public:
 
    virtual std::size_t size() const noexcept = 0;
 
+   virtual uint getSimplexDimension() const noexcept = 0;
+
+   virtual MeshBase* getMesh() const noexcept = 0;
+
+   /**
+    * Appends n simplices given by a flat list of their vertex IDs, which are known not to be in the container yet.
+    * In contrast to insert, no lookup is performed.
+    */
+   virtual void append(const ID* vertices, std::size_t n) = 0;
+
+   /**
+    * References n simplices of the root container by their IDs, which are known not to be referenced yet.
+    */
+   virtual void reference(const ID* ids, std::size_t n) = 0;
+
+   /**
+    * @return The vertex IDs of all simplices of the root container as flat list, ordered by simplex ID
+    */
+   virtual const std::vector<ID>& connectivity() const noexcept = 0;
+
+   /**
+    * @return The IDs of the referenced simplices of the root container, nullptr for a root container
+    */
+   virtual const std::vector<ID>* referencedIDs() const noexcept = 0;
+
+   /**
+    * @return A counter of the root container, which grows whenever simplices are added to it or it is cleared
+    */
+   virtual std::uint64_t getRevision() const noexcept = 0;
+
 };
 
 template<uint Dim, uint SimplexDim>
@@ -43,12 +74,14 @@ public:
    {
       elements_owner = std::make_unique<std::vector<std::unique_ptr<MeshElement>>>();
       elements = elements_owner.get();
-      vertices2elementspos = std::make_shared<std::unordered_map<util::generate_tuple_type_t<ID, SimplexDim + 1>, std::size_t,
-              generate_hash_type_t <ID, SimplexDim + 1>>>();
+      connectivity_owner = std::make_unique<std::vector<ID>>();
+      connectivity_ids = connectivity_owner.get();
+      vertices2elementspos = std::make_shared<Index>();
    }
 
    SimplexContainer(SimplexContainer<Dim, SimplexDim>& container)
-      : mesh (container.mesh), elements(container.elements), vertices2elementspos(container.vertices2elementspos) {}
+      : mesh (container.mesh), elements(container.elements), connectivity_ids(container.connectivity_ids),
+        vertices2elementspos(container.vertices2elementspos) {}
 
    MeshElement* operator[](std::size_t i)
    {
@@ -66,12 +99,16 @@ public:
    std::enable_if_t<std::conjunction_v<std::is_integral<I>...>, MeshElement*>
    insert(const I&... vid) {
       static_assert(sizeof...(I) == (SimplexDim + 1), "Wrong number of vertices given");
-      auto t = std::make_tuple(vid...);
-      auto it = vertices2elementspos->find(t);
-      if (it == vertices2elementspos->end()) {
+      auto t = std::make_tuple(static_cast<ID>(vid)...);
+      auto& positions = index();
+      auto it = positions.find(t);
+      if (it == positions.end()) {
          const ID id = elements->size();
          elements->emplace_back(std::make_unique<Simplex< Dim, SimplexDim>>(mesh, id, t));
-         it = vertices2elementspos->emplace(t, id).first;
+         (connectivity_ids->push_back(static_cast<ID>(vid)), ...);
+         it = positions.emplace(t, id).first;
+         ++vertices2elementspos->nindexed;
+         ++vertices2elementspos->revision;
       }
       return reference(it->second);
    }
@@ -82,41 +119,154 @@ public:
       const auto face = dynamic_cast<Simplex<Dim, SimplexDim>*>((*elements)[id].get());
       if (!ownsElements()) {
          const auto t = face->getVertices();
-         auto it = vertices2refpos.find(t);
-         if (it == vertices2refpos.end()) {
+         auto& refpos = referenceIndex();
+         auto it = refpos.find(t);
+         if (it == refpos.end()) {
             referenced_ids.push_back(id);
-            vertices2refpos[t] = referenced_ids.size() - 1;
+            refpos[t] = referenced_ids.size() - 1;
+            ++nrefindexed;
          }
       }
       return face;
    }
 
+   void append(const ID* vertices, std::size_t n) override
+   {
+      if (n == 0)
+         return;
+      ++vertices2elementspos->revision;
+      reserve(elements, elements->size() + n);
+      connectivity_ids->insert(connectivity_ids->end(), vertices, vertices + n * (SimplexDim + 1));
+      if (!ownsElements())
+         reserve(&referenced_ids, referenced_ids.size() + n);
+      std::array<ID, SimplexDim + 1> simplex;
+      for (std::size_t i = 0; i < n; ++i) {
+         std::copy(vertices + i * (SimplexDim + 1), vertices + (i + 1) * (SimplexDim + 1), simplex.begin());
+         const ID id = elements->size();
+         elements->emplace_back(std::make_unique<Simplex<Dim, SimplexDim>>(mesh, id, simplex));
+         if (!ownsElements())
+            referenced_ids.push_back(id);
+      }
+   }
+
+   void reference(const ID* ids, std::size_t n) override
+   {
+      if (ownsElements())
+         return;
+      reserve(&referenced_ids, referenced_ids.size() + n);
+      for (std::size_t i = 0; i < n; ++i) {
+         if (ids[i] < 0 || elements->size() <= static_cast<std::size_t>(ids[i]))
+            throw std::out_of_range("Referenced simplex does not exist");
+         referenced_ids.push_back(ids[i]);
+      }
+   }
+
    [[nodiscard]]
    inline std::size_t size() const noexcept override
    {
       return ownsElements() ? elements->size() : referenced_ids.size();
    }
 
+   [[nodiscard]]
+   uint getSimplexDimension() const noexcept override
+   {
+      return SimplexDim;
+   }
+
+   [[nodiscard]]
+   MeshBase* getMesh() const noexcept override
+   {
+      return mesh;
+   }
+
+   [[nodiscard]]
+   const std::vector<ID>& connectivity() const noexcept override
+   {
+      return *connectivity_ids;
+   }
+
+   [[nodiscard]]
+   const std::vector<ID>* referencedIDs() const noexcept override
+   {
+      return ownsElements() ? nullptr : &referenced_ids;
+   }
+
+   [[nodiscard]]
+   std::uint64_t getRevision() const noexcept override
+   {
+      return vertices2elementspos->revision;
+   }
+
    void clearAndReserve(std::size_t n) {
       elements->clear();
       elements->reserve(n);
+      connectivity_ids->clear();
+      connectivity_ids->reserve(n * (SimplexDim + 1));
+      vertices2elementspos->positions.clear();
+      vertices2elementspos->nindexed = 0;
+      ++vertices2elementspos->revision;
    }
 
 private:
+   using VerticesMap = std::unordered_map<util::generate_tuple_type_t<ID, SimplexDim + 1>, std::size_t,
+           generate_hash_type_t<ID, SimplexDim + 1>>;
+
+   /**
+    * Lookup of the simplex positions by their vertices, shared by the root container and all the containers
+    * referencing it. Simplices appended in bulk are added lazily on the next lookup. The revision counts the changes
+    * of the root container, so caches derived from its connectivity notice them.
+    */
+   struct Index
+   {
+      VerticesMap positions;
+      std::size_t nindexed = 0;
+      std::uint64_t revision = 0;
+   };
+
    MeshBase* mesh;
    std::unique_ptr<std::vector<std::unique_ptr<MeshElement>>> elements_owner;
    std::vector<std::unique_ptr<MeshElement>>* elements;
+   // The vertex IDs of the elements once more, flat for bulk access
+   std::unique_ptr<std::vector<ID>> connectivity_owner;
+   std::vector<ID>* connectivity_ids;
    std::vector<ID> referenced_ids;
-   std::shared_ptr<std::unordered_map<util::generate_tuple_type_t<ID, SimplexDim + 1>, std::size_t,
-           generate_hash_type_t<ID, SimplexDim + 1>>> vertices2elementspos;
-   std::unordered_map<util::generate_tuple_type_t<ID, SimplexDim + 1>, std::size_t,
-           generate_hash_type_t<ID, SimplexDim + 1>> vertices2refpos;
+   std::shared_ptr<Index> vertices2elementspos;
+   VerticesMap vertices2refpos;
+   std::size_t nrefindexed = 0;
 
    [[nodiscard]]
    inline bool ownsElements() const noexcept
    {
       return elements == elements_owner.get();
    }
+
+   [[nodiscard]]
+   inline util::generate_tuple_type_t<ID, SimplexDim + 1> vertices(ID id) const
+   {
+      return static_cast<Simplex<Dim, SimplexDim>*>((*elements)[id].get())->getVertices();
+   }
+
+   VerticesMap& index()
+   {
+      Index& idx = *vertices2elementspos;
+      for (; idx.nindexed < elements->size(); ++idx.nindexed)
+         idx.positions.emplace(vertices(idx.nindexed), idx.nindexed);
+      return idx.positions;
+   }
+
+   VerticesMap& referenceIndex()
+   {
+      for (; nrefindexed < referenced_ids.size(); ++nrefindexed)
+         vertices2refpos.emplace(vertices(referenced_ids[nrefindexed]), nrefindexed);
+      return vertices2refpos;
+   }
+
+   template<typename T>
+   static void reserve(std::vector<T>* vec, std::size_t n)
+   {
+      if (vec->capacity() < n)
+         vec->reserve(std::max(n, 2 * vec->capacity()));
+   }
 };
 
 }
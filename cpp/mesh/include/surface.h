@@ -0,0 +1,31 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_SURFACE_H
+#define PYULB_SURFACE_H
+
+#include <string>
+
+#include "mesh.h"
+
+namespace mesh
+{
+
+/**
+ * Reads a triangulated surface from a PLY (ASCII or binary), OBJ or binary STL file, the format is taken from the
+ * extension. The file is mapped into memory and converted on all threads. Polygons are split into triangles.
+ *
+ * The points are welded with each other and with the points already in the point list of the mesh, so surfaces of
+ * neighbouring segments loaded one after the other share their common points. Triangles which collapse or repeat
+ * are dropped, the new ones are appended in bulk.
+ *
+ * @param mesh The mesh the faces are added to, for example the input mesh of a factory or one of its segments
+ * @param weld_tolerance The distance up to which points are merged, only identical points are merged if 0
+ * @return The number of faces read into the mesh
+ */
+std::size_t readSurface(const std::string& path, Mesh<3, 2>* mesh, double weld_tolerance = 0.0);
+
+}
+
+#endif //PYULB_SURFACE_H
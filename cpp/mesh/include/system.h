@@ -5,9 +5,18 @@
 #ifndef PYULB_SYSTEM_H
 #define PYULB_SYSTEM_H
 
+#include <functional>
+
 #include "mesh.h"
 #include "segment.h"
 #include "attribute.h"
+#include "selector.h"
+#include "segmentview.h"
+#include "derived.h"
+#include "reduction.h"
+#include "interpolation.h"
+#include "transfer.h"
+#include "systemview.h"
 
 namespace mesh
 {
@@ -32,6 +41,40 @@ public:
    virtual SegmentBase* interface(ID seg1_id, ID seg2_id) const = 0;
 
    virtual SegmentBase* interface(const std::string& seg1, const std::string& seg2) const = 0;
+
+   /**
+    * @return The interface of the given index from 0 to getNumInterfaces() - 1, nullptr if it does not exist
+    */
+   virtual SegmentBase* interface(ID index) const = 0;
+
+   virtual std::size_t getNumSegments() const noexcept = 0;
+
+   virtual std::size_t getNumInterfaces() const noexcept = 0;
+
+   virtual const AttributeBase* getAttribute(const std::string& name) const = 0;
+
+   virtual AttributeBase* getAttribute(const std::string& name) = 0;
+
+   /**
+    * @return The names of all attributes in alphabetical order
+    */
+   virtual std::vector<std::string> getAttributeNames() const = 0;
+};
+
+/**
+ * Axis aligned block of a segment, which is meshed with a structured grid instead of an unstructured mesher.
+ */
+template<uint Dim>
+struct Block
+{
+   ID segment;
+   std::array<double, Dim> lower;
+   std::array<double, Dim> upper;
+   std::array<std::size_t, Dim> divisions;
+   // Ratio of the last to the first cell length along each axis
+   std::array<double, Dim> grading;
+   // Input vertices at the corners, the bits of the index select the upper bound along the axes
+   std::array<ID, (1u << Dim)> corners;
 };
 
 template<uint Dim, uint TopDim = Dim>
@@ -77,10 +120,100 @@ public:
 
    SegmentBase* interface(const std::string& seg1,const std::string& seg2) const override;
 
-   template<typename T, StorageLocation location=StorageLocation::VERTEX>
-   Attribute<T>& addAttribute(const std::string& name, AttributeExtent& extent=AttributeExtent())
+   SegmentBase* interface(ID index) const override;
+
+   std::size_t getNumSegments() const noexcept override;
+
+   std::size_t getNumInterfaces() const noexcept override;
+
+   const AttributeBase* getAttribute(const std::string& name) const override;
+
+   AttributeBase* getAttribute(const std::string& name) override;
+
+   std::vector<std::string> getAttributeNames() const override;
+
+   /**
+    * Writes the mesh, the voronoi diagram, the segments, the interfaces and the attributes in the binary system file
+    * format. All arrays are stored flat and aligned, so that the file can be used in place by SystemView.
+    */
+   void write(std::ostream& out) const;
+
+   /**
+    * Writes the system as by write into a new POSIX shared memory segment, which other processes open by name with
+    * SystemView::attach. The segment is removed when the returned object is destroyed.
+    */
+   std::unique_ptr<SharedMemory> share(const std::string& name) const;
+
+   /**
+    * Reads a system written by write.
+    */
+   static std::unique_ptr<System<Dim, TopDim>> read(std::istream& in);
+
+   /**
+    * Builds a modifiable system from a system file view.
+    */
+   static std::unique_ptr<System<Dim, TopDim>> read(const SystemView& view);
+
+   /**
+    * Reads a mesh in the Gmsh format 4.1, ASCII or binary. Every physical group of the dimension of the system
+    * becomes a segment, the facets shared by two segments form their interfaces. The cells have to be linear
+    * simplices, elements of lower dimension are skipped. Large files are tokenised and converted on all threads.
+    */
+   static std::unique_ptr<System<Dim, TopDim>> readGmsh(const std::string& path);
+
+   /**
+    * Writes the mesh in the Gmsh format 4.1. Every segment becomes a physical group of cells and every interface
+    * (from 2D on) a physical group of facets, both named like in the system.
+    */
+   void writeGmsh(std::ostream& out, bool binary=false) const;
+
+   /**
+    * Adds an attribute with values for all entities at the location, or returns the existing one of that name. The
+    * layout is one of AoS, SoA or AoSoA<Block>.
+    */
+   template<typename T, StorageLocation Location = StorageLocation::VERTEX, typename Layout = AoS>
+   Attribute<T, Location, Layout>& addAttribute(const std::string& name,
+                                                const AttributeExtent& extent = AttributeExtent())
+   {
+      const auto it = attributes.find(name);
+      if (it != attributes.end())
+         return attribute<T, Location, Layout>(name);
+      auto attribute = std::make_unique<Attribute<T, Location, Layout>>(this, name, extent);
+      Attribute<T, Location, Layout>& result = *attribute;
+      attributes.emplace(name, std::move(attribute));
+      return result;
+   }
+
+   /**
+    * Adds an attribute computed from the given inputs by the kernel, see DerivedAttribute.
+    */
+   template<typename T, StorageLocation Location = StorageLocation::VERTEX, typename Layout = AoS>
+   DerivedAttribute<T, Location, Layout>& addDerivedAttribute(
+           const std::string& name, const AttributeExtent& extent, std::vector<const AttributeBase*> inputs,
+           typename DerivedAttribute<T, Location, Layout>::Kernel kernel, bool elementwise = true)
    {
-      return *static_cast<Attribute<T>*>(attributes.emplace(name, std::make_unique<Attribute<T, location>>(this, name, extent)).first->second.get());
+      if (attributes.find(name) != attributes.end())
+         throw std::logic_error("Attribute " + name + " exists already");
+      auto attribute = std::make_unique<DerivedAttribute<T, Location, Layout>>(this, name, extent, std::move(inputs),
+                                                                               std::move(kernel), elementwise);
+      DerivedAttribute<T, Location, Layout>& result = *attribute;
+      attributes.emplace(name, std::move(attribute));
+      return result;
+   }
+
+   /**
+    * @return The attribute of the given name, which has to be of type T at the location in the layout
+    */
+   template<typename T, StorageLocation Location = StorageLocation::VERTEX, typename Layout = AoS>
+   Attribute<T, Location, Layout>& attribute(const std::string& name)
+   {
+      const auto it = attributes.find(name);
+      if (it == attributes.end())
+         throw std::out_of_range("No attribute named " + name);
+      auto* attribute = dynamic_cast<Attribute<T, Location, Layout>*>(it->second.get());
+      if (attribute == nullptr)
+         throw std::logic_error("Attribute " + name + " has a different type, location or layout");
+      return *attribute;
    }
 
    class Factory
@@ -92,14 +225,86 @@ public:
 
       Mesh<Dim, TopDim - 1>* mesh();
 
+      /**
+       * Adds a segment covering an axis aligned block, which is meshed with a structured grid of simplices. This is
+       * much faster than unstructured meshing and supports cells graded towards one side. The block boundary is
+       * added to the input mesh, so blocks sharing corners, edges or faces and (in 2D) unstructured segments
+       * sharing the block sides are meshed conformingly. Neighbouring blocks have to agree on the divisions and
+       * gradings along shared sides.
+       *
+       * @param name The name of the segment
+       * @param lower The lower corner of the block
+       * @param upper The upper corner of the block
+       * @param divisions The number of cells along every axis
+       * @param grading The ratio of the last to the first cell length along every axis, uniform if empty
+       * @return The input mesh of the segment
+       */
+      Mesh<Dim, TopDim - 1>* block(const std::string& name, const std::vector<double>& lower,
+                                   const std::vector<double>& upper, const std::vector<std::size_t>& divisions,
+                                   const std::vector<double>& grading = {});
+
       //std::unique_ptr<System<Dim, TopDim>> create(double area=0.0);
 
-      System<Dim, TopDim>* create(double area=0.0);
+      /**
+       * Meshes the domain described by the input mesh and the segment boundaries.
+       *
+       * @param area The maximal area of a generated simplex, no constraint if <= 0
+       * @param decompose If true, the boundaries shared by the segments are discretised once and every
+       *                  segment is meshed on a thread of its own with its boundary kept fixed. Every segment
+       *                  has to be bounded by a single closed polygon. No voronoi diagram is generated.
+       *                  Always the case if the factory contains blocks.
+       *
+       * The factory is not modified, so it is safe to call create concurrently, also on the same factory. Triangle
+       * runs concurrently as well, if it is built with thread local globals, which cpp/mesh/CMakeLists.txt does for
+       * the Triangle sources it knows. Otherwise its runs are serialised and only the remaining work proceeds
+       * concurrently.
+       */
+      System<Dim, TopDim>* create(double area=0.0, bool decompose=false) const;
+
+      /**
+       * Enables the on-disk cache. Created systems are stored in the directory under the hash of the factory input
+       * and the meshing options, and on a hit loaded from there instead of being meshed again.
+       *
+       * @param directory The cache directory, which is created if necessary. An empty path disables the cache.
+       */
+      void setCacheDirectory(const std::string& directory);
+
+      /**
+       * Meshes many factories on a pool of threads. The same factory can be given multiple times. Every thread
+       * runs Triangle on its own, unless Triangle is built without thread local globals (see create), in which case
+       * its runs are serialised and the threads only overlap them with cache lookups, block meshing and the
+       * assembly of the systems.
+       *
+       * @param areas The maximal simplex area per factory, or a single area used for all of them
+       * @return The created systems in the order of the given factories
+       */
+      static std::vector<System<Dim, TopDim>*> createBatch(const std::vector<const Factory*>& factories,
+                                                           const std::vector<double>& areas,
+                                                           bool decompose=false, int nthreads=0);
 
    private:
+      /**
+       * Meshes the domain in one piece or decomposed, which only 2D and 3D systems can be.
+       */
+      System<Dim, TopDim>* generate(double area, bool decompose) const;
+
+      System<Dim, TopDim>* generate(double area) const;
+
+      /**
+       * Only defined for 2D and 3D systems, see the specialisations below.
+       */
+      System<Dim, TopDim>* generateDecomposed(double area) const;
+
+      /**
+       * @return The bytes of the factory input and the meshing options, which identify a cache entry
+       */
+      std::string cacheKey(double area, bool decompose) const;
+
+      std::string cache_directory;
       std::unique_ptr<System<Dim, TopDim>> system;
       std::unique_ptr<Mesh<Dim, TopDim - 1>> system_input_mesh;
       std::vector<std::unique_ptr<Mesh<Dim, TopDim - 1>>> segment_input_meshes;
+      std::vector<Block<Dim>> blocks;
    };
 
 private:
@@ -113,8 +318,25 @@ private:
 
    Segment<Dim, TopDim>* getOrCreateSegment(const std::string& name);
 
+   /**
+    * Writes the system file into the stream returned by open, which is called with the file size before writing.
+    */
+   void write(const std::function<std::ostream&(std::size_t)>& open) const;
+
 };
 
+template<>
+System<2, 2>* System<2, 2>::Factory::generate(double area) const;
+
+template<>
+System<2, 2>* System<2, 2>::Factory::generateDecomposed(double area) const;
+
+template<>
+System<3, 3>* System<3, 3>::Factory::generate(double area) const;
+
+template<>
+System<3, 3>* System<3, 3>::Factory::generateDecomposed(double area) const;
+
 }
 
 #endif //PYULB_SYSTEM_H
@@ -0,0 +1,195 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_SYSTEMVIEW_H
+#define PYULB_SYSTEMVIEW_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.h"
+#include "attribute.h"
+
+namespace mesh
+{
+
+/**
+ * Read-only view on a contiguous array, which is owned elsewhere.
+ */
+template<typename T>
+class ArrayView
+{
+public:
+   ArrayView() = default;
+
+   ArrayView(const T* data, std::size_t size) : _data(data), _size(size)
+   {}
+
+   [[nodiscard]]
+   const T* data() const noexcept
+   {
+      return _data;
+   }
+
+   [[nodiscard]]
+   std::size_t size() const noexcept
+   {
+      return _size;
+   }
+
+   const T& operator[](std::size_t i) const
+   {
+      return _data[i];
+   }
+
+   const T* begin() const noexcept
+   {
+      return _data;
+   }
+
+   const T* end() const noexcept
+   {
+      return _data + _size;
+   }
+
+private:
+   const T* _data = nullptr;
+   std::size_t _size = 0;
+};
+
+/**
+ * Attribute stored in a system file.
+ */
+struct AttributeView
+{
+   std::string name;
+   StorageLocation location;
+   ScalarType type;
+   std::vector<std::size_t> extents;
+   const void* data;
+   // Number of values
+   std::size_t size;
+};
+
+class MappedFile;
+
+class SharedMemory;
+
+/**
+ * Read-only system backed by the binary system file format written by System::write. When opened from a file, the
+ * file is mapped into memory and all arrays point into the mapping, so opening is independent of the mesh size.
+ * Only the structure of the file is checked, not the IDs stored in it.
+ */
+class SystemView
+{
+public:
+   /**
+    * Maps the system file at the given path.
+    */
+   static std::shared_ptr<SystemView> open(const std::string& path);
+
+   /**
+    * Maps the shared memory segment of a system shared by System::share read-only.
+    */
+   static std::shared_ptr<SystemView> attach(const std::string& name);
+
+   /**
+    * Takes the content of a system file held in memory.
+    */
+   explicit SystemView(std::vector<char> buffer);
+
+   ~SystemView();
+
+   SystemView(const SystemView&) = delete;
+
+   SystemView& operator=(const SystemView&) = delete;
+
+   [[nodiscard]]
+   uint getDimension() const noexcept
+   {
+      return dim;
+   }
+
+   [[nodiscard]]
+   uint getTopologyDimension() const noexcept
+   {
+      return topdim;
+   }
+
+   /**
+    * @param voronoi Whether the coordinates of the voronoi diagram are requested instead of the mesh
+    * @return The point coordinates as flat array
+    */
+   [[nodiscard]]
+   ArrayView<double> coordinates(bool voronoi = false) const;
+
+   /**
+    * @return The vertex IDs of all simplices of the given dimension as flat array
+    */
+   [[nodiscard]]
+   ArrayView<ID> connectivity(uint simplex_dim, bool voronoi = false) const;
+
+   [[nodiscard]]
+   std::size_t getNumSegments() const noexcept
+   {
+      return segment_names.size();
+   }
+
+   [[nodiscard]]
+   const std::string& segmentName(std::size_t iseg) const;
+
+   /**
+    * @return The IDs of the root mesh simplices of the given dimension, which belong to the segment
+    */
+   [[nodiscard]]
+   ArrayView<ID> segmentSimplices(std::size_t iseg, uint simplex_dim) const;
+
+   [[nodiscard]]
+   std::size_t getNumInterfaces() const noexcept
+   {
+      return interface_segments.size() / 2;
+   }
+
+   /**
+    * @return The IDs of the two segments of the interface
+    */
+   [[nodiscard]]
+   std::pair<ID, ID> interfaceSegments(std::size_t iint) const;
+
+   /**
+    * @return The IDs of the root mesh simplices of the given dimension, which belong to the interface
+    */
+   [[nodiscard]]
+   ArrayView<ID> interfaceSimplices(std::size_t iint, uint simplex_dim) const;
+
+   [[nodiscard]]
+   const std::vector<AttributeView>& attributes() const noexcept
+   {
+      return _attributes;
+   }
+
+private:
+   SystemView() = default;
+
+   void parse(const char* data, std::size_t size);
+
+   std::unique_ptr<MappedFile> file;
+   std::unique_ptr<SharedMemory> shared_memory;
+   std::vector<char> buffer;
+   uint dim = 0;
+   uint topdim = 0;
+   std::array<ArrayView<double>, 2> _coordinates;
+   std::array<std::array<ArrayView<ID>, 4>, 2> _connectivity;
+   std::vector<std::string> segment_names;
+   std::vector<std::array<ArrayView<ID>, 4>> segment_simplices;
+   ArrayView<ID> interface_segments;
+   std::vector<std::array<ArrayView<ID>, 4>> interface_simplices;
+   std::vector<AttributeView> _attributes;
+};
+
+}
+
+#endif //PYULB_SYSTEMVIEW_H
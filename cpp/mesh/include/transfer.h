@@ -0,0 +1,86 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_TRANSFER_H
+#define PYULB_TRANSFER_H
+
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "attribute.h"
+#include "interpolation.h"
+#include "mesh.h"
+
+namespace mesh
+{
+
+class PointLocator;
+
+enum class TransferMode
+{
+   // Barycentric interpolation of vertex values, or the value of the containing cell for cell values
+   INTERPOLATE,
+   // Cell values redistributed by the overlap of the cells, which keeps the integral over the domain
+   CONSERVATIVE
+};
+
+/**
+ * Carries attributes over from one system to another one covering the same domain, e.g. from the system before
+ * remeshing to the new one. The points of the target entities (vertices or centroids) are located in the cells of
+ * the source mesh with a grid of buckets, all at once and on all threads. The resulting sparse operator is cached per
+ * pair of locations, so every further attribute only costs a sparse matrix vector product.
+ *
+ * The conservative mode maps cell values to cell values. The overlaps of the cells are estimated by sampling every
+ * target cell and every source cell at a lattice of points, located in the other mesh, so cells much smaller than
+ * the ones of the other mesh are covered as well. The overlaps are then balanced to the volumes of the cells, the
+ * mass of every source cell is handed over completely. Hence the integral is kept exactly, constants are kept exactly
+ * where the cells of one mesh nest in the ones of the other and up to the balancing otherwise, and other values are
+ * accurate to the sampling. If the meshes cover the domain differently, e.g.
+ * along a curved boundary, the integral is kept and the values are scaled by the ratio of the volumes.
+ */
+class AttributeTransfer
+{
+public:
+   /**
+    * @param samples Number of lattice points along an edge of the cells in the conservative mode
+    */
+   AttributeTransfer(SystemBase* source, SystemBase* target, uint samples = 3);
+
+   ~AttributeTransfer();
+
+   /**
+    * @return The operator mapping values at the location of the source system to those of the target system
+    */
+   std::shared_ptr<const TransferOperator> transferOperator(StorageLocation from, StorageLocation to,
+                                                            TransferMode mode);
+
+   template<typename T, StorageLocation From, typename FromLayout, StorageLocation To, typename ToLayout>
+   void operator()(const Attribute<T, From, FromLayout>& from, Attribute<T, To, ToLayout>& to,
+                   TransferMode mode = TransferMode::INTERPOLATE)
+   {
+      if (from.getSystem() != source || to.getSystem() != target)
+         throw std::logic_error("Attributes do not belong to the systems of the transfer");
+      applyTransferOperator(*transferOperator(From, To, mode), from, to);
+   }
+
+   /**
+    * Transfers attributes of any floating point type and layout, by way of a copy of the values in double precision.
+    */
+   void operator()(const AttributeBase& from, AttributeBase& to, TransferMode mode = TransferMode::INTERPOLATE);
+
+private:
+   SystemBase* source;
+   SystemBase* target;
+   uint samples;
+   std::unique_ptr<PointLocator> locator;
+   // Locator of the target mesh, only needed in the conservative mode
+   std::unique_ptr<PointLocator> target_locator;
+   std::map<std::tuple<StorageLocation, StorageLocation, TransferMode>, std::shared_ptr<const TransferOperator>>
+           operators;
+};
+
+}
+
+#endif //PYULB_TRANSFER_H
@@ -0,0 +1,94 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_TRIANGLEFILES_H
+#define PYULB_TRIANGLEFILES_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "system.h"
+
+namespace mesh
+{
+
+/**
+ * Points of a Triangle or TetGen .node file.
+ */
+struct NodeList
+{
+   uint dim = 0;
+   // Index of the first point, either 0 or 1. The indices in all other files of the mesh are relative to it.
+   ID first_index = 0;
+   std::vector<double> coordinates;
+   std::size_t nattributes = 0;
+   std::vector<double> attributes;
+   // Boundary markers, empty if the file has none
+   std::vector<int> markers;
+};
+
+/**
+ * Rows of a .ele, .edge, .face or .neigh file, with the indices made zero based. Missing neighbours stay -1.
+ */
+struct ElementList
+{
+   // Number of vertices (or neighbours) per row
+   uint nvertices = 0;
+   std::vector<ID> vertices;
+   // Number of region attributes (.ele) or boundary markers (.edge, .face) per row
+   std::size_t nattributes = 0;
+   std::vector<double> attributes;
+};
+
+/**
+ * Planar straight line graph of a Triangle .poly file.
+ */
+struct PolyFile
+{
+   NodeList nodes;
+   ElementList segments;
+   // Coordinates of the hole points
+   std::vector<double> holes;
+   // Regions as x, y, attribute and maximal area
+   std::vector<double> regions;
+};
+
+/**
+ * Reads a .node file. The file is mapped into memory and tokenised on all threads.
+ */
+NodeList readNodes(const std::string& path);
+
+/**
+ * Reads a .ele, .edge, .face or .neigh file, the kind is taken from the extension.
+ *
+ * @param first_index The index of the first point of the corresponding .node file
+ */
+ElementList readElements(const std::string& path, ID first_index = 0);
+
+/**
+ * Reads a 2D .poly file. If it contains no points, they are read from the .node file of the same name. TetGen .poly
+ * files describe facets, which the 3D factory does not take as input, therefore they are not supported.
+ */
+PolyFile readPoly(const std::string& path);
+
+/**
+ * Builds a mesh from a .node file and the file of its simplices of the topological dimension (.ele for cells, .face
+ * for TetGen boundary faces or .edge). The simplices in between are generated. Of higher order elements only the
+ * corners are used.
+ */
+template<uint Dim, uint TopDim>
+std::unique_ptr<Mesh<Dim, TopDim>> readTriangleMesh(const std::string& node_path, const std::string& element_path);
+
+/**
+ * Adds a planar straight line graph to the input of a factory. Every bounded face of the graph becomes a segment,
+ * named after the attribute of the region point inside it, otherwise "face<i>". The factory has no holes, faces
+ * with a hole point inside are left out and therefore meshed as part of the face around them.
+ */
+void addPoly(System<2, 2>::Factory& factory, const PolyFile& poly);
+
+}
+
+#endif //PYULB_TRIANGLEFILES_H
@@ -0,0 +1,48 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_VTK_H
+#define PYULB_VTK_H
+
+#include <ostream>
+#include <string>
+
+#include "mesh.h"
+#include "system.h"
+
+namespace mesh
+{
+
+struct VtuOptions
+{
+   // Compress the appended data with zlib, only available if built with zlib
+   bool compress = false;
+   // Uncompressed size of the blocks, which are compressed independently on all threads
+   std::size_t block_size = 1 << 16;
+};
+
+/**
+ * Writes the bodies of a mesh as VTK XML unstructured grid with raw appended data. The data is generated directly
+ * from the mesh containers block by block. For a segment mesh only the vertices of the segment are written.
+ */
+template<uint Dim, uint TopDim>
+void writeVtu(std::ostream& out, Mesh<Dim, TopDim>* mesh, const VtuOptions& options = VtuOptions());
+
+/**
+ * Writes the mesh of a system as VTK XML unstructured grid, with the segment ID of every cell as cell data. Cells
+ * not belonging to any segment get -1.
+ */
+template<uint Dim, uint TopDim>
+void writeVtu(const std::string& path, System<Dim, TopDim>* system, const VtuOptions& options = VtuOptions());
+
+/**
+ * Writes every segment of the system as a piece <stem>_<segment index>.vtu next to the given .pvtu file, which
+ * references all pieces. The pieces are written in parallel.
+ */
+template<uint Dim, uint TopDim>
+void writePvtu(const std::string& path, System<Dim, TopDim>* system, const VtuOptions& options = VtuOptions());
+
+}
+
+#endif //PYULB_VTK_H
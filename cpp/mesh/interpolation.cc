@@ -0,0 +1,174 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#include "interpolation.h"
+#include "closure.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+struct TransferOperators
+{
+   struct Entry
+   {
+      shared_ptr<const TransferOperator> op;
+      // Revisions of the simplices of both dimensions the operator was built for
+      uint64_t from_revision = 0;
+      uint64_t to_revision = 0;
+   };
+
+   map<pair<uint, uint>, Entry> operators;
+};
+
+// Guards the caches of all meshes, operators are built rarely
+static mutex transfer_mutex;
+
+/**
+ * Sorted vertex IDs of a simplex, filled up with -1.
+ */
+using SimplexKey = array<ID, 4>;
+
+static SimplexKey simplexKey(const ID* vertices, size_t n)
+{
+   SimplexKey key;
+   key.fill(-1);
+   copy_n(vertices, n, key.begin());
+   sort(key.begin(), key.begin() + n);
+   return key;
+}
+
+/**
+ * @return The IDs of the sub-simplices of dimension lo of every simplex of dimension hi, as flat list with the same
+ * number of sub-simplices per simplex
+ */
+static vector<ID> subsimplices(MeshBase* mesh, uint hi, uint lo)
+{
+   const vector<ID>& connectivity = mesh->simplices(hi).connectivity();
+   const size_t nhi = mesh->simplices(hi).size();
+   const vector<uint> subsets = localSimplices(hi, lo);
+   vector<ID> ids(nhi * subsets.size());
+   if (lo == 0) {
+      for (size_t i = 0; i < nhi; ++i)
+         copy_n(connectivity.begin() + i * (hi + 1), hi + 1, ids.begin() + i * (hi + 1));
+      return ids;
+   }
+   // Simplices of dimension lo sorted by their vertices, so that they are found by binary search
+   const vector<ID>& lo_connectivity = mesh->simplices(lo).connectivity();
+   const size_t nlo = mesh->simplices(lo).size();
+   vector<pair<SimplexKey, ID>> index(nlo);
+   for (size_t i = 0; i < nlo; ++i)
+      index[i] = {simplexKey(lo_connectivity.data() + i * (lo + 1), lo + 1), ID(i)};
+   sort(index.begin(), index.end());
+   bool complete = true;
+#pragma omp parallel for reduction(&&:complete)
+   for (size_t i = 0; i < nhi; ++i) {
+      const ID* corners = connectivity.data() + i * (hi + 1);
+      for (size_t j = 0; j < subsets.size(); ++j) {
+         array<ID, 4> vertices{};
+         size_t nvertices = 0;
+         for (uint corner = 0; corner <= hi; ++corner)
+            if (subsets[j] & (1u << corner))
+               vertices[nvertices++] = corners[corner];
+         const SimplexKey key = simplexKey(vertices.data(), nvertices);
+         const auto it = lower_bound(index.begin(), index.end(), make_pair(key, ID(-1)));
+         complete = complete && it != index.end() && it->first == key;
+         ids[i * subsets.size() + j] = complete ? it->second : -1;
+      }
+   }
+   if (!complete)
+      throw runtime_error("Mesh lacks sub-simplices of its simplices");
+   return ids;
+}
+
+vector<double> simplexMeasures(MeshBase* mesh, uint dim)
+{
+   const vector<ID>& connectivity = mesh->simplices(dim).connectivity();
+   const vector<double>& points = mesh->getPointList();
+   const uint pdim = mesh->getDimension();
+   const size_t n = mesh->simplices(dim).size();
+   double factorial = 1.0;
+   for (uint d = 2; d <= dim; ++d)
+      factorial *= d;
+   vector<double> result(n);
+#pragma omp parallel for
+   for (size_t i = 0; i < n; ++i) {
+      const ID* corners = connectivity.data() + i * (dim + 1);
+      Eigen::MatrixXd edges(pdim, dim);
+      for (uint j = 0; j < dim; ++j)
+         for (uint d = 0; d < pdim; ++d)
+            edges(d, j) = points[corners[j + 1] * pdim + d] - points[corners[0] * pdim + d];
+      result[i] = sqrt(abs((edges.transpose() * edges).determinant())) / factorial;
+   }
+   return result;
+}
+
+static TransferOperator buildTransferOperator(MeshBase* mesh, uint from, uint to)
+{
+   const size_t nfrom = mesh->simplices(from).size();
+   const size_t nto = mesh->simplices(to).size();
+   TransferOperator op(nto, nfrom);
+   vector<Eigen::Triplet<double>> triplets;
+   if (from == to) {
+      op.setIdentity();
+   } else if (from < to) {
+      // Average of the sub-simplices
+      const vector<ID> ids = subsimplices(mesh, to, from);
+      const size_t nsub = nto > 0 ? ids.size() / nto : 0;
+      triplets.reserve(ids.size());
+      for (size_t i = 0; i < nto; ++i)
+         for (size_t j = 0; j < nsub; ++j)
+            triplets.emplace_back(i, ids[i * nsub + j], 1.0 / nsub);
+      op.setFromTriplets(triplets.begin(), triplets.end());
+   } else {
+      // Average of the simplices containing the sub-simplex, weighted by their measure
+      const vector<ID> ids = subsimplices(mesh, from, to);
+      const vector<double> weights = simplexMeasures(mesh, from);
+      const size_t nsub = nfrom > 0 ? ids.size() / nfrom : 0;
+      vector<double> totals(nto, 0.0);
+      for (size_t i = 0; i < nfrom; ++i)
+         for (size_t j = 0; j < nsub; ++j)
+            totals[ids[i * nsub + j]] += weights[i];
+      triplets.reserve(ids.size());
+      for (size_t i = 0; i < nfrom; ++i)
+         for (size_t j = 0; j < nsub; ++j)
+            if (totals[ids[i * nsub + j]] > 0.0)
+               triplets.emplace_back(ids[i * nsub + j], i, weights[i] / totals[ids[i * nsub + j]]);
+      op.setFromTriplets(triplets.begin(), triplets.end());
+   }
+   op.makeCompressed();
+   return op;
+}
+
+shared_ptr<const TransferOperator> MeshBase::transferOperator(uint from, uint to)
+{
+   if (simplices(from).referencedIDs() != nullptr)
+      throw logic_error("Transfer operators only exist for root meshes");
+   const uint64_t from_revision = simplices(from).getRevision();
+   const uint64_t to_revision = simplices(to).getRevision();
+   lock_guard<mutex> lock(transfer_mutex);
+   if (!transfer_operators)
+      transfer_operators = make_shared<TransferOperators>();
+   auto& entry = transfer_operators->operators[{from, to}];
+   if (!entry.op || entry.from_revision != from_revision || entry.to_revision != to_revision) {
+      entry.op = make_shared<const TransferOperator>(buildTransferOperator(this, from, to));
+      entry.from_revision = from_revision;
+      entry.to_revision = to_revision;
+   }
+   return entry.op;
+}
+
+void MeshBase::clearTransferOperators()
+{
+   lock_guard<mutex> lock(transfer_mutex);
+   transfer_operators.reset();
+}
+
+}
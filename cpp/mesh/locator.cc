@@ -0,0 +1,170 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "locator.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+// Tolerance of the barycentric coordinates of points on the boundary of a cell
+static constexpr double inside_tolerance = 1e-10;
+
+PointLocator::PointLocator(MeshBase* mesh) : dim(mesh->getDimension()), points(&mesh->getPointList())
+{
+   if (mesh->getTopologyDimension() != dim)
+      throw logic_error("Points can only be located in meshes, whose cells fill the space");
+   MeshElementsProxy& proxy = mesh->simplices(dim);
+   if (proxy.referencedIDs() != nullptr)
+      throw logic_error("Points can only be located in root meshes");
+   cells = &proxy.connectivity();
+   ncells = proxy.size();
+
+   array<double, 3> upper{};
+   for (uint d = 0; d < dim; ++d) {
+      lower[d] = numeric_limits<double>::max();
+      upper[d] = numeric_limits<double>::lowest();
+   }
+   for (size_t i = 0; i < points->size(); i += dim) {
+      for (uint d = 0; d < dim; ++d) {
+         lower[d] = min(lower[d], (*points)[i + d]);
+         upper[d] = max(upper[d], (*points)[i + d]);
+      }
+   }
+   // Buckets of about the size of a cell
+   double volume = 1.0;
+   array<double, 3> extent{};
+   for (uint d = 0; d < dim; ++d) {
+      extent[d] = max(upper[d] - lower[d], 1e-300);
+      volume *= extent[d];
+   }
+   const double size = pow(volume / double(max<size_t>(ncells, 1)), 1.0 / dim);
+   for (uint d = 0; d < dim; ++d) {
+      nbuckets[d] = max<size_t>(1, min<size_t>(size_t(extent[d] / size), max<size_t>(ncells, 1)));
+      bucket_size[d] = extent[d] / double(nbuckets[d]);
+   }
+
+   // Bucket ranges of the bounding boxes and inverse edge matrices of the cells
+   vector<array<size_t, 3>> first(ncells);
+   vector<array<size_t, 3>> last(ncells);
+   inverses.resize(ncells * dim * dim);
+#pragma omp parallel for
+   for (size_t c = 0; c < ncells; ++c) {
+      const ID* corners = cell(ID(c));
+      array<double, 3> cell_lower{};
+      array<double, 3> cell_upper{};
+      Eigen::MatrixXd edges(dim, dim);
+      for (uint d = 0; d < dim; ++d) {
+         cell_lower[d] = cell_upper[d] = (*points)[corners[0] * dim + d];
+         for (uint j = 1; j <= dim; ++j) {
+            const double x = (*points)[corners[j] * dim + d];
+            cell_lower[d] = min(cell_lower[d], x);
+            cell_upper[d] = max(cell_upper[d], x);
+            edges(d, j - 1) = x - (*points)[corners[0] * dim + d];
+         }
+      }
+      first[c] = bucket(cell_lower.data());
+      last[c] = bucket(cell_upper.data());
+      const Eigen::MatrixXd inverse = edges.inverse();
+      for (uint i = 0; i < dim; ++i)
+         for (uint j = 0; j < dim; ++j)
+            inverses[(c * dim + i) * dim + j] = inverse(i, j);
+   }
+
+   // Cells per bucket in compressed rows
+   const auto forBuckets = [&](size_t c, auto&& f) {
+      for (size_t i2 = first[c][2]; i2 <= last[c][2]; ++i2)
+         for (size_t i1 = first[c][1]; i1 <= last[c][1]; ++i1)
+            for (size_t i0 = first[c][0]; i0 <= last[c][0]; ++i0)
+               f((i2 * nbuckets[1] + i1) * nbuckets[0] + i0);
+   };
+   offsets.assign(nbuckets[0] * nbuckets[1] * nbuckets[2] + 1, 0);
+   for (size_t c = 0; c < ncells; ++c)
+      forBuckets(c, [&](size_t b) { ++offsets[b + 1]; });
+   partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+   bucket_cells.resize(offsets.back());
+   vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+   for (size_t c = 0; c < ncells; ++c)
+      forBuckets(c, [&](size_t b) { bucket_cells[fill[b]++] = ID(c); });
+}
+
+void PointLocator::barycentric(ID cell, const double* point, double* lambda) const
+{
+   const ID* corners = this->cell(cell);
+   const double* origin = points->data() + corners[0] * dim;
+   const double* inverse = inverses.data() + size_t(cell) * dim * dim;
+   lambda[0] = 1.0;
+   for (uint i = 0; i < dim; ++i) {
+      lambda[i + 1] = 0.0;
+      for (uint j = 0; j < dim; ++j)
+         lambda[i + 1] += inverse[i * dim + j] * (point[j] - origin[j]);
+      lambda[0] -= lambda[i + 1];
+   }
+}
+
+array<size_t, 3> PointLocator::bucket(const double* point) const
+{
+   array<size_t, 3> index{};
+   for (uint d = 0; d < dim; ++d) {
+      const double position = floor((point[d] - lower[d]) / bucket_size[d]);
+      index[d] = position < 0.0 ? 0 : min(size_t(position), nbuckets[d] - 1);
+   }
+   return index;
+}
+
+ID PointLocator::locate(const double* point, double* lambda) const
+{
+   if (ncells == 0)
+      return -1;
+   const array<size_t, 3> center = bucket(point);
+   ID best = -1;
+   double best_min = numeric_limits<double>::lowest();
+   array<double, 4> candidate{};
+   const auto ring_max = long(*max_element(nbuckets.begin(), nbuckets.end()));
+   // Rings of buckets around the bucket of the point, until a ring has cells
+   for (long ring = 0; ring <= ring_max && best < 0; ++ring) {
+      array<long, 3> from{};
+      array<long, 3> to{};
+      for (uint d = 0; d < 3; ++d) {
+         from[d] = max(long(center[d]) - ring, 0L);
+         to[d] = min(long(center[d]) + ring, long(nbuckets[d]) - 1);
+      }
+      for (long i2 = from[2]; i2 <= to[2]; ++i2) {
+         for (long i1 = from[1]; i1 <= to[1]; ++i1) {
+            for (long i0 = from[0]; i0 <= to[0]; ++i0) {
+               const long distance = max({labs(i0 - long(center[0])), labs(i1 - long(center[1])),
+                                          labs(i2 - long(center[2]))});
+               if (distance != ring)
+                  continue;
+               const size_t b = (size_t(i2) * nbuckets[1] + size_t(i1)) * nbuckets[0] + size_t(i0);
+               for (size_t k = offsets[b]; k < offsets[b + 1]; ++k) {
+                  barycentric(bucket_cells[k], point, candidate.data());
+                  const double smallest = *min_element(candidate.begin(), candidate.begin() + dim + 1);
+                  if (smallest > best_min) {
+                     best_min = smallest;
+                     best = bucket_cells[k];
+                     copy_n(candidate.begin(), dim + 1, lambda);
+                     if (smallest >= -inside_tolerance)
+                        return best;
+                  }
+               }
+            }
+         }
+      }
+   }
+   // Outside of all cells, the point is projected onto the nearest one
+   double sum = 0.0;
+   for (uint i = 0; i <= dim; ++i)
+      sum += lambda[i] = max(lambda[i], 0.0);
+   for (uint i = 0; i <= dim; ++i)
+      lambda[i] /= sum;
+   return best;
+}
+
+}
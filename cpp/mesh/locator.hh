@@ -0,0 +1,68 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_LOCATOR_HH
+#define PYULB_LOCATOR_HH
+
+#include <array>
+#include <vector>
+
+#include "mesh.h"
+
+namespace mesh
+{
+
+/**
+ * Finds the cells of a mesh, whose topological dimension equals its dimension, which contain given points. The
+ * bounding boxes of the cells are sorted into a uniform grid of buckets with about one cell each.
+ */
+class PointLocator
+{
+public:
+   explicit PointLocator(MeshBase* mesh);
+
+   /**
+    * Locates a point. Points outside of all cells, e.g. on a curved boundary which was meshed differently, are
+    * assigned to the nearest cell in barycentric coordinates, whose negative coordinates are clipped.
+    *
+    * @param lambda Receives the dim + 1 barycentric coordinates of the point in the cell
+    * @return The cell containing the point, -1 if the mesh has no cells
+    */
+   ID locate(const double* point, double* lambda) const;
+
+   uint getDimension() const noexcept
+   {
+      return dim;
+   }
+
+   /**
+    * @return The vertex IDs of a cell
+    */
+   const ID* cell(ID id) const
+   {
+      return cells->data() + id * (dim + 1);
+   }
+
+private:
+   uint dim;
+   const std::vector<double>* points;
+   const std::vector<ID>* cells;
+   std::size_t ncells;
+   std::array<double, 3> lower{};
+   std::array<double, 3> bucket_size{};
+   std::array<std::size_t, 3> nbuckets{1, 1, 1};
+   // Cells of bucket b from bucket_cells[offsets[b]] to bucket_cells[offsets[b + 1]]
+   std::vector<std::size_t> offsets;
+   std::vector<ID> bucket_cells;
+   // Inverse of the matrix of the edge vectors from the first vertex of every cell, row major
+   std::vector<double> inverses;
+
+   void barycentric(ID cell, const double* point, double* lambda) const;
+
+   std::array<std::size_t, 3> bucket(const double* point) const;
+};
+
+}
+
+#endif //PYULB_LOCATOR_HH
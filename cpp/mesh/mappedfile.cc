@@ -0,0 +1,69 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mappedfile.h"
+
+using namespace std;
+
+namespace mesh
+{
+
+MappedFile::MappedFile(const string& path) : _path(path)
+{
+   const int fd = open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+      throw runtime_error("Cannot open " + path + ": " + strerror(errno));
+   struct stat st{};
+   if (fstat(fd, &st) != 0) {
+      const int err = errno;
+      close(fd);
+      throw runtime_error("Cannot stat " + path + ": " + strerror(err));
+   }
+   _size = st.st_size;
+   if (_size > 0) {
+      void* addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+         const int err = errno;
+         close(fd);
+         throw runtime_error("Cannot map " + path + ": " + strerror(err));
+      }
+      _data = static_cast<const char*>(addr);
+   }
+   // The mapping stays valid after closing the descriptor
+   close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& file) noexcept
+   : _path(move(file._path)), _data(exchange(file._data, nullptr)), _size(exchange(file._size, 0))
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& file) noexcept
+{
+   if (this != &file) {
+      if (_data != nullptr)
+         munmap(const_cast<char*>(_data), _size);
+      _path = move(file._path);
+      _data = exchange(file._data, nullptr);
+      _size = exchange(file._size, 0);
+   }
+   return *this;
+}
+
+MappedFile::~MappedFile()
+{
+   if (_data != nullptr)
+      munmap(const_cast<char*>(_data), _size);
+}
+
+}
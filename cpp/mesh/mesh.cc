@@ -2,6 +2,7 @@
 // Created by klaus on 06.01.19.
 //
 
+#include <numeric>
 #include <sstream>
 
 #include "mesh.h"
@@ -50,12 +51,26 @@ typename Mesh<Dim, 0>::VerticesProxy& Mesh<Dim, 0>::VerticesProxy::add(const Eig
 {
    if (points.cols() != Dim)
       throw logic_error("A vertex consists of one point only");
-   for (size_t row = 0; row < points.rows(); ++row) {
-      for (size_t dim = 0; dim < Dim; ++dim)
-         mesh->coordinates->push_back(points(row, dim));
-      const ID id = mesh->coordinates->size() / Dim - 1;
-      create({id});
-   }
+   return add(points.data(), points.rows(), points.innerStride(), points.outerStride());
+}
+
+template<uint Dim>
+template<typename T>
+typename Mesh<Dim, 0>::VerticesProxy&
+Mesh<Dim, 0>::VerticesProxy::add(const T* points, size_t n, ptrdiff_t row_stride, ptrdiff_t col_stride)
+{
+   vector<double>& coordinates = *mesh->coordinates;
+   const ID first = coordinates.size() / Dim;
+   coordinates.resize(coordinates.size() + Dim * n);
+   double* out = coordinates.data() + Dim * first;
+   // Signed offsets, the strides of a reversed view are negative
+   for (ptrdiff_t i = 0; i < ptrdiff_t(n); ++i)
+      for (ptrdiff_t dim = 0; dim < ptrdiff_t(Dim); ++dim)
+         out[Dim * i + dim] = static_cast<double>(points[i * row_stride + dim * col_stride]);
+   // The points are new, so are their vertices
+   vector<ID> ids(n);
+   iota(ids.begin(), ids.end(), first);
+   mesh->vertices_container.append(ids.data(), n);
    return *this;
 }
 
@@ -77,6 +92,18 @@ vector<double>&  Mesh<Dim, 0>::getPointList() const
    return *coordinates;
 }
 
+template<uint Dim>
+uint Mesh<Dim, 0>::getDimension() const noexcept
+{
+   return Dim;
+}
+
+template<uint Dim>
+uint Mesh<Dim, 0>::getTopologyDimension() const noexcept
+{
+   return 0;
+}
+
 template<uint Dim>
 Mesh<Dim, 1>::Mesh()
    : Mesh<Dim, 0>(), edges_container(this), edges_proxy(make_unique<EdgesProxy>(this))
@@ -103,6 +130,12 @@ MeshElement* Mesh<Dim, 1>::EdgesProxy::create(const vector<ID> &indices)
    return mesh->edges_container.insert(indices[0], indices[1]);
 }
 
+template<uint Dim>
+uint Mesh<Dim, 1>::getTopologyDimension() const noexcept
+{
+   return 1;
+}
+
 template<uint Dim>
 MeshElementsProxy& Mesh<Dim, 1>::bodies()
 {
@@ -147,6 +180,12 @@ MeshElement* Mesh<Dim, 2>::FacesProxy::create(const vector<ID>& indices)
    return mesh->faces_container.insert(indices[0], indices[1], indices[2]);
 }
 
+template<uint Dim>
+uint Mesh<Dim, 2>::getTopologyDimension() const noexcept
+{
+   return 2;
+}
+
 template<uint Dim>
 MeshElementsProxy& Mesh<Dim, 2>::bodies()
 {
@@ -171,32 +210,74 @@ typename Mesh<Dim, 2>::FacesProxy& Mesh<Dim, 2>::faces()
    return *faces_proxy;
 }
 
-Mesh<3, 3>::Mesh() : Mesh<3, 2>()
+Mesh<3, 3>::Mesh() : Mesh<3, 2>(), cells_container(this), cells_proxy(make_unique<CellsProxy>(this))
+{
+}
+
+Mesh<3, 3>::Mesh(Mesh<3, 3>* mesh)
+   : Mesh<3, 2>(mesh), cells_container(mesh->cells_container), cells_proxy(make_unique<CellsProxy>(this))
+{
+}
+
+Mesh<3, 3>::CellsProxy::CellsProxy(Mesh<3, 3>* mesh)
+   : MeshElementsProxy(mesh->cells_container), mesh(mesh)
+{}
+
+MeshElement* Mesh<3, 3>::CellsProxy::create(const vector<ID>& indices)
+{
+   if (indices.size() != 4)
+      throw logic_error("A cell consists of 4 points only");
+   return mesh->cells_container.insert(indices[0], indices[1], indices[2], indices[3]);
+}
+
+uint Mesh<3, 3>::getTopologyDimension() const noexcept
+{
+   return 3;
+}
+
+MeshElementsProxy& Mesh<3, 3>::bodies()
+{
+   return cells();
+}
+
+MeshElementsProxy& Mesh<3, 3>::facets()
 {
+   return Mesh<3, 2>::faces();
 }
 
-Mesh<3, 3>::Mesh(Mesh<3, 3>* mesh) : Mesh<3, 2>(mesh)
+MeshElementsProxy& Mesh<3, 3>::ridges()
 {
+   return Mesh<3, 1>::edges();
+}
+
+MeshElementsProxy& Mesh<3, 3>::peaks()
+{
+   return Mesh<3, 0>::vertices();
+}
+
+Mesh<3, 3>::CellsProxy& Mesh<3, 3>::cells()
+{
+   return *cells_proxy;
 }
 
 Cell* Mesh<3, 3>::getCell(size_t idx) const
 {
-   if (idx >= cells.size()) {
-      cout << "Mesh3D getCell: Index out of bounds" << endl;
-      cout.flush();
+   if (idx >= cells_container.size())
       throw out_of_range("Cell index out of range");
-   }
-   return cells[idx].get();
+   return static_cast<Cell*>(cells_container[idx]);
 }
 
 Cell* Mesh<3, 3>::getCellByID(ID id) const
 {
+   for (size_t idx = 0; idx < cells_container.size(); ++idx)
+      if (cells_container[idx]->getID() == id)
+         return static_cast<Cell*>(cells_container[idx]);
    return nullptr;
 }
 
 size_t Mesh<3, 3>::getNumCells() const
 {
-   return cells.size();
+   return cells_container.size();
 }
 
 template class Mesh<0, 0>;
@@ -212,6 +293,13 @@ template class Mesh<3, 2>;
 // 0D space
 template Mesh<0, 0>::Mesh(Mesh<0, 0>*);
 
+template Mesh<1, 0>::VerticesProxy& Mesh<1, 0>::VerticesProxy::add(const float*, size_t, ptrdiff_t, ptrdiff_t);
+template Mesh<1, 0>::VerticesProxy& Mesh<1, 0>::VerticesProxy::add(const double*, size_t, ptrdiff_t, ptrdiff_t);
+template Mesh<2, 0>::VerticesProxy& Mesh<2, 0>::VerticesProxy::add(const float*, size_t, ptrdiff_t, ptrdiff_t);
+template Mesh<2, 0>::VerticesProxy& Mesh<2, 0>::VerticesProxy::add(const double*, size_t, ptrdiff_t, ptrdiff_t);
+template Mesh<3, 0>::VerticesProxy& Mesh<3, 0>::VerticesProxy::add(const float*, size_t, ptrdiff_t, ptrdiff_t);
+template Mesh<3, 0>::VerticesProxy& Mesh<3, 0>::VerticesProxy::add(const double*, size_t, ptrdiff_t, ptrdiff_t);
+
 // 1D space
 template Mesh<1, 0>::Mesh(Mesh<1, 0>*);
 template Mesh<1, 0>::Mesh(Mesh<1, 1>*);
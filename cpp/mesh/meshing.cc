@@ -2,7 +2,14 @@
 // Created by klaus on 2020-05-02.
 //
 
+#include <map>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+
 #include "system.h"
+#include "structured.hh"
 
 #define VOID void
 #define REAL double
@@ -14,9 +21,73 @@ using namespace Eigen;
 namespace mesh
 {
 
+/**
+ * Triangle output structure, which releases the arrays allocated by Triangle. The hole and region lists are only
+ * copied from the input and therefore not released.
+ */
+struct TriangulateOutput : public triangulateio
+{
+   TriangulateOutput() : triangulateio{}
+   {}
+
+   TriangulateOutput(const TriangulateOutput&) = delete;
+
+   TriangulateOutput& operator=(const TriangulateOutput&) = delete;
+
+   ~TriangulateOutput()
+   {
+      trifree(pointlist);
+      trifree(pointattributelist);
+      trifree(pointmarkerlist);
+      trifree(trianglelist);
+      trifree(triangleattributelist);
+      trifree(neighborlist);
+      trifree(segmentlist);
+      trifree(segmentmarkerlist);
+      trifree(edgelist);
+      trifree(edgemarkerlist);
+      trifree(normlist);
+   }
+};
+
+#ifndef TRIANGLE_REENTRANT
+/**
+ * Serialises the calls of Triangle, unless it is built with thread local globals (see CMakeLists.txt): exactinit
+ * and randomnation write the exact arithmetic error bounds and the random seed on every call.
+ */
+static mutex triangle_mutex;
+#endif
+
+/**
+ * Runs Triangle quietly. Triangle calls triexit, i.e. exit, on invalid input and internal errors, which can't be
+ * caught. Therefore the input is checked for the errors it would terminate on.
+ */
+static void runTriangle(const string& switches, double area, triangulateio& in, triangulateio& out,
+                        triangulateio* vorout = nullptr)
+{
+   if (in.numberofpoints < 3)
+      throw runtime_error("Triangle needs at least three input points");
+   for (int i = 0; i < 2 * in.numberofpoints; ++i)
+      if (!isfinite(in.pointlist[i]))
+         throw runtime_error("Triangle input points have to be finite");
+   for (int i = 0; i < 2 * in.numberofsegments; ++i)
+      if (in.segmentlist[i] < 0 || in.segmentlist[i] >= in.numberofpoints)
+         throw runtime_error("Triangle input segment refers to a missing point");
+   stringstream ss;
+   ss << switches << 'Q';
+   // Triangle does not parse exponents, therefore the area is given in fixed notation
+   if (area > 0.0)
+      ss << 'a' << fixed << setprecision(numeric_limits<double>::max_digits10) << area;
+   string sw = ss.str();
+#ifndef TRIANGLE_REENTRANT
+   lock_guard<mutex> lock(triangle_mutex);
+#endif
+   triangulate(&sw[0], &in, &out, vorout);
+}
+
 template<>
 //unique_ptr<System<2, 2>> System<2, 2>::Factory::create(double area)
-System<2, 2>* System<2, 2>::Factory::create(double area)
+System<2, 2>* System<2, 2>::Factory::generate(double area) const
 {
    // Setup triangle input
    vector<double> pointlist = system_input_mesh->getPointList();
@@ -43,15 +114,10 @@ System<2, 2>* System<2, 2>::Factory::create(double area)
    triin.segmentmarkerlist = &segmmentmarks[0];
    triin.segmentlist = &edges[0];
 
-   triangulateio triout{};
-   triangulateio vout{};
+   TriangulateOutput triout;
+   TriangulateOutput vout;
 
-   stringstream ss;
-   ss << "pecnzqvDV";
-   if (area > 0.0)
-      ss << 'a' << area;
-   triangulate((char*) ss.str().c_str(), &triin, &triout, &vout);
-   std::cout.flush();
+   runTriangle("pecnzqvD", area, triin, triout, &vout);
 
    //auto result_system = std::make_unique<System<2, 2>>();
    System<2, 2>* result_system = new System<2, 2>();
@@ -308,4 +374,115 @@ System<2, 2>* System<2, 2>::Factory::create(double area)
    return result_system;
 }
 
+template<>
+System<2, 2>* System<2, 2>::Factory::generateDecomposed(double area) const
+{
+   const size_t nsegs = segment_input_meshes.size();
+   // Side length of an equilateral triangle with the maximal area, used as target length for the boundary edges
+   const double h = area > 0.0 ? sqrt(4.0 * area / sqrt(3.0)) : numeric_limits<double>::infinity();
+
+   // Discretise every input edge exactly once. An edge shared by two segments, independent of the orientation
+   // it was given in, is split into the same chain of boundary vertices, so that the independently meshed
+   // segments are conforming along their interfaces. The sides of blocks come first, so that their grading is
+   // kept by the neighbouring segments.
+   vector<double> coordinates = system_input_mesh->getPointList();
+   SharedBoundaries<2> shared(coordinates);
+   vector<SegmentPatch<2>> patches(nsegs);
+   vector<const Block<2>*> seg2block(nsegs, nullptr);
+   vector<vector<ID>> block_nodes(nsegs);
+   for (const auto& block : blocks) {
+      seg2block[block.segment] = &block;
+      block_nodes[block.segment] = shared.block(block, block.segment, patches[block.segment].entities);
+   }
+   for (size_t iseg = 0; iseg < nsegs; ++iseg) {
+      if (seg2block[iseg] != nullptr)
+         continue;
+      vector<size_t>& entities = patches[iseg].entities;
+      for (const auto& edge : segment_input_meshes[iseg]->edges()) {
+         const Vector2d pa = Map<const Vector2d>(&coordinates[2 * edge[0]], 2, 1);
+         const Vector2d pb = Map<const Vector2d>(&coordinates[2 * edge[1]], 2, 1);
+         const size_t n = isinf(h) ? 1 : max<size_t>(1, static_cast<size_t>(ceil((pb - pa).norm() / h)));
+         vector<double> positions(n + 1);
+         for (size_t i = 0; i <= n; ++i)
+            positions[i] = double(i) / n;
+         const size_t ichain = shared.chain(edge[0], edge[1], positions);
+         if (find(entities.begin(), entities.end(), ichain) == entities.end()) {
+            entities.push_back(ichain);
+            shared.entities[ichain].segments.push_back(iseg);
+         }
+      }
+   }
+
+   // Mesh every segment on its own with the discretised boundary kept fixed (YY). Triangle keeps the input points
+   // in front of the output points, therefore the first local points map directly onto the boundary vertices.
+   // Triangle runs on all threads at once, as its globals are thread local. Built without them, runTriangle
+   // serialises its calls and only the blocks and the copies of the results proceed in parallel.
+   exception_ptr error = nullptr;
+#pragma omp parallel for schedule(dynamic)
+   for (long iseg = 0; iseg < (long) nsegs; ++iseg) {
+      try {
+         SegmentPatch<2>& patch = patches[iseg];
+         if (seg2block[iseg] != nullptr) {
+            meshBlock(*seg2block[iseg], block_nodes[iseg], patch);
+            continue;
+         }
+         unordered_map<ID, int> global2local;
+         vector<double> pointlist;
+         vector<int> segmentlist;
+         const auto local = [&](ID vid) {
+            const auto it = global2local.find(vid);
+            if (it != global2local.end())
+               return it->second;
+            const int lid = patch.boundary.size();
+            global2local.emplace(vid, lid);
+            patch.boundary.push_back(vid);
+            pointlist.push_back(coordinates[2 * vid]);
+            pointlist.push_back(coordinates[2 * vid + 1]);
+            return lid;
+         };
+         for (const size_t ichain : patch.entities) {
+            const vector<ID>& chain = shared.entities[ichain].nodes;
+            for (size_t i = 0; i + 1 < chain.size(); ++i) {
+               segmentlist.push_back(local(chain[i]));
+               segmentlist.push_back(local(chain[i + 1]));
+            }
+         }
+         if (segmentlist.empty())
+            continue;
+         vector<int> segmentmarkerlist(segmentlist.size() / 2, 1);
+
+         triangulateio triin{};
+         triin.pointlist = &pointlist[0];
+         triin.numberofpoints = pointlist.size() / 2;
+         triin.segmentlist = &segmentlist[0];
+         triin.segmentmarkerlist = &segmentmarkerlist[0];
+         triin.numberofsegments = segmentlist.size() / 2;
+         TriangulateOutput triout;
+
+         runTriangle("pzeqYY", area, triin, triout);
+
+         patch.points.assign(triout.pointlist + 2 * triin.numberofpoints, triout.pointlist + 2 * triout.numberofpoints);
+         patch.simplices[2].assign(triout.trianglelist, triout.trianglelist + 3 * triout.numberoftriangles);
+         // The edges along the boundary are the ones of the chains
+         for (int iedge = 0; iedge < triout.numberofedges; ++iedge) {
+            if (triout.edgemarkerlist[iedge] != 0)
+               continue;
+            patch.simplices[1].push_back(triout.edgelist[2 * iedge]);
+            patch.simplices[1].push_back(triout.edgelist[2 * iedge + 1]);
+         }
+      } catch (...) {
+#pragma omp critical
+         error = current_exception();
+      }
+   }
+   if (error)
+      rethrow_exception(error);
+
+   System<2, 2>* result_system = new System<2, 2>();
+   for (const auto& seg : system->segments)
+      result_system->getOrCreateSegment(seg->name);
+   assemble(result_system, move(coordinates), shared, patches);
+   return result_system;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <stdexcept>
+
+#include "reduction.h"
+#include "interpolation.h"
+#include "system.h"
+
+using namespace std;
+
+namespace mesh
+{
+
+SegmentReduction::SegmentReduction(SystemBase* system, ReductionDomain domain) : system(system), domain(domain)
+{
+   if (system == nullptr)
+      throw invalid_argument("Reduction needs a system");
+}
+
+void SegmentReduction::clear() noexcept
+{
+   for (auto& rows : cache)
+      rows.reset();
+}
+
+/**
+ * @return Kahan sum of the weights of the chunks, added pairwise like the values
+ */
+static double measure(const double* weights, size_t n)
+{
+   vector<ReductionPartial> partials((n + SegmentReduction::chunk - 1) / SegmentReduction::chunk);
+   for (size_t t = 0; t < partials.size(); ++t) {
+      KahanSum sum;
+      for (size_t i = t * SegmentReduction::chunk; i < min(n, (t + 1) * SegmentReduction::chunk); ++i)
+         sum.add(weights[i]);
+      partials[t].integral = sum.value();
+   }
+   return pairwiseSum(partials.data(), partials.size(), 1).integral;
+}
+
+const ReductionRows& SegmentReduction::rows(StorageLocation location)
+{
+   if (location == StorageLocation::SEGMENT)
+      throw logic_error("Segment attributes have one value per segment, there is nothing to reduce");
+   MeshBase* mesh = system->mesh();
+   const size_t n = countEntities(system, location);
+   unique_ptr<ReductionRows>& cached = cache[location];
+   if (cached && cached->nentities == n)
+      return *cached;
+
+   auto rows = make_unique<ReductionRows>();
+   rows->nentities = n;
+   rows->offsets.push_back(0);
+   const bool segments = domain == ReductionDomain::SEGMENTS;
+   const size_t nrows = segments ? system->getNumSegments() : system->getNumInterfaces();
+   vector<vector<double>> measures(mesh->getTopologyDimension() + 1);
+   const auto measuresOf = [&](uint dim) -> const vector<double>& {
+      if (measures[dim].empty())
+         measures[dim] = simplexMeasures(mesh, dim);
+      return measures[dim];
+   };
+   // Shares of the cells at the vertices, only non-zero for the vertices of the current row
+   vector<double> lumped(location == StorageLocation::VERTEX ? n : 0, 0.0);
+
+   for (size_t r = 0; r < nrows; ++r) {
+      const SegmentBase* segment = segments ? system->segment(ID(r)) : system->interface(ID(r));
+      rows->names.push_back(segment->getName());
+      const vector<ID> entities = segmentEntities(segment, location, n);
+      const uint topdim = segment->mesh()->getTopologyDimension();
+      if (location == StorageLocation::VERTEX && topdim > 0) {
+         const auto cell_location = static_cast<StorageLocation>(topdim);
+         const vector<ID> cells = segmentEntities(segment, cell_location, countEntities(system, cell_location));
+         const vector<ID>& connectivity = mesh->simplices(topdim).connectivity();
+         const vector<double>& cell_measures = measuresOf(topdim);
+         for (const ID cell : cells)
+            for (uint j = 0; j <= topdim; ++j)
+               lumped[connectivity[cell * (topdim + 1) + j]] += cell_measures[cell] / (topdim + 1);
+         for (const ID entity : entities) {
+            rows->weights.push_back(lumped[entity]);
+            lumped[entity] = 0.0;
+         }
+      } else {
+         const vector<double>& entity_measures = measuresOf(static_cast<uint>(location));
+         for (const ID entity : entities)
+            rows->weights.push_back(entity_measures[entity]);
+      }
+      rows->entities.insert(rows->entities.end(), entities.begin(), entities.end());
+      rows->offsets.push_back(rows->entities.size());
+      rows->measure.push_back(measure(rows->weights.data() + rows->offsets[r], entities.size()));
+   }
+   cached = move(rows);
+   return *cached;
+}
+
+template<typename T>
+static vector<double> doubleValues(const AttributeBase& attribute)
+{
+   vector<T> values(attribute.getNumEntities() * attribute.getExtents().getSize());
+   attribute.copyTo(values.data());
+   return vector<double>(values.begin(), values.end());
+}
+
+ReductionTable SegmentReduction::operator()(const AttributeBase& attribute)
+{
+   if (attribute.getSystem() != system)
+      throw logic_error("Attribute " + attribute.getName() + " does not belong to the system of the reduction");
+   vector<double> values;
+   switch (attribute.getScalarType()) {
+      case ScalarType::FLOAT64:
+         values = doubleValues<double>(attribute);
+         break;
+      case ScalarType::FLOAT32:
+         values = doubleValues<float>(attribute);
+         break;
+      case ScalarType::INT64:
+         values = doubleValues<int64_t>(attribute);
+         break;
+      case ScalarType::INT32:
+         values = doubleValues<int32_t>(attribute);
+         break;
+      case ScalarType::UINT8:
+         values = doubleValues<uint8_t>(attribute);
+         break;
+   }
+   const size_t k = attribute.getExtents().getSize();
+   const double* data = values.data();
+   return reduce(rows(attribute.getLocation()), k, [=](ID entity, size_t c) { return data[entity * k + c]; });
+}
+
+}
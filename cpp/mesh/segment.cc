@@ -26,7 +26,7 @@ Mesh<Dim, TopDim>* Segment<Dim, TopDim>::mesh()
 template<uint Dim, uint TopDim>
 MeshBase* Segment<Dim, TopDim>::mesh() const
 {
-   return mesh();
+   return _mesh.get();
 }
 
 template<uint Dim, uint TopDim>
@@ -0,0 +1,57 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include "selector.h"
+#include "segment.h"
+
+using namespace std;
+
+namespace mesh
+{
+
+EntityGeometry entityGeometry(MeshBase* mesh, StorageLocation location)
+{
+   if (location == StorageLocation::SEGMENT)
+      throw logic_error("Segments have no geometry to select them by");
+   EntityGeometry geometry;
+   geometry.points = mesh->getPointList().data();
+   geometry.dim = mesh->getDimension();
+   const uint dim = static_cast<uint>(location);
+   if (dim > 0) {
+      if (dim > mesh->getTopologyDimension())
+         throw out_of_range("Mesh has no simplices at the location of the selector");
+      geometry.vertices = mesh->simplices(dim).connectivity().data();
+      geometry.nvertices = dim + 1;
+   }
+   return geometry;
+}
+
+Bitset segmentMembers(const SegmentBase* segment, StorageLocation location, size_t n)
+{
+   Bitset members(n);
+   for (const ID id : segmentEntities(segment, location, n))
+      members.set(id);
+   return members;
+}
+
+vector<ID> segmentEntities(const SegmentBase* segment, StorageLocation location, size_t n)
+{
+   if (segment == nullptr)
+      throw invalid_argument("Segment does not exist");
+   vector<ID> entities;
+   if (location == StorageLocation::SEGMENT) {
+      entities.push_back(segment->getID());
+   } else {
+      const vector<ID>* ids = segment->mesh()->simplices(static_cast<uint>(location)).referencedIDs();
+      if (ids == nullptr)
+         throw logic_error("Segment mesh does not refer to the system mesh");
+      entities = *ids;
+   }
+   for (const ID id : entities)
+      if (id < 0 || size_t(id) >= n)
+         throw out_of_range("Segment " + segment->getName() + " refers to an entity, which does not exist");
+   return entities;
+}
+
+}
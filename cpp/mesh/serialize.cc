@@ -0,0 +1,341 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <map>
+#include <ostream>
+
+#include "system.h"
+#include "systemview.h"
+#include "sharedmemory.h"
+#include "systemformat.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+/**
+ * Section of a system file, which is written once the layout of all sections is known.
+ */
+struct OutputSection
+{
+   format::SectionEntry entry;
+   function<void(ostream&)> write;
+};
+
+template<typename T>
+static void writeValue(ostream& out, const T& value)
+{
+   out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void writePadding(ostream& out, uint64_t n)
+{
+   static const char zeros[format::section_alignment] = {};
+   out.write(zeros, n);
+}
+
+/**
+ * Adds the sections of the simplex IDs of a segment (or interface) mesh, which refer to the root mesh.
+ */
+static void addReferenceSections(vector<OutputSection>& sections, format::SectionKind kind, uint64_t index,
+                                 MeshBase* mesh)
+{
+   for (uint dim = 0; dim <= mesh->getTopologyDimension(); ++dim) {
+      MeshElementsProxy& elements = mesh->simplices(dim);
+      sections.push_back({{kind, dim, index, 0, elements.size() * sizeof(ID)}, [&elements](ostream& out) {
+         for (const auto& element : elements)
+            writeValue<ID>(out, element.getID());
+      }});
+   }
+}
+
+static void addMeshSections(vector<OutputSection>& sections, uint64_t index, MeshBase* mesh)
+{
+   vector<double>& coordinates = mesh->getPointList();
+   sections.push_back({{format::COORDINATES, 0, index, 0, coordinates.size() * sizeof(double)},
+                       [&coordinates](ostream& out) {
+                          out.write(reinterpret_cast<const char*>(coordinates.data()),
+                                    coordinates.size() * sizeof(double));
+                       }});
+   for (uint dim = 0; dim <= mesh->getTopologyDimension(); ++dim) {
+      MeshElementsProxy& elements = mesh->simplices(dim);
+      sections.push_back({{format::CONNECTIVITY, dim, index, 0, elements.size() * (dim + 1) * sizeof(ID)},
+                          [&elements, dim](ostream& out) {
+                             for (const auto& element : elements)
+                                for (size_t iv = 0; iv <= dim; ++iv)
+                                   writeValue<ID>(out, element[iv]);
+                          }});
+   }
+}
+
+/**
+ * Rebuilds the simplices of a mesh from the stored connectivity. The simplices of a stored mesh are unique,
+ * therefore they are appended without lookup.
+ */
+static void readMesh(const SystemView& view, bool voronoi, MeshBase* mesh)
+{
+   const ArrayView<double> coordinates = view.coordinates(voronoi);
+   mesh->getPointList().assign(coordinates.begin(), coordinates.end());
+   const size_t npoints = coordinates.size() / view.getDimension();
+   for (uint dim = 0; dim <= view.getTopologyDimension(); ++dim) {
+      const ArrayView<ID> ids = view.connectivity(dim, voronoi);
+      if (ids.size() % (dim + 1) != 0)
+         throw runtime_error("System file contains a partial simplex");
+      for (const ID id : ids)
+         if (id < 0 || static_cast<size_t>(id) >= npoints)
+            throw runtime_error("System file refers to a vertex, which does not exist");
+      mesh->simplices(dim).append(ids.data(), ids.size() / (dim + 1));
+   }
+}
+
+static void readReferences(const ArrayView<ID>& ids, uint dim, MeshBase* mesh, MeshBase* root)
+{
+   const size_t nroot = root->simplices(dim).size();
+   for (const ID id : ids)
+      if (id < 0 || static_cast<size_t>(id) >= nroot)
+         throw runtime_error("System file refers to a simplex, which does not exist");
+   mesh->simplices(dim).reference(ids.data(), ids.size());
+}
+
+template<typename T, StorageLocation Location>
+static unique_ptr<AttributeBase> makeAttribute(SystemBase* system, const AttributeView& view)
+{
+   AttributeExtent extent(view.extents.empty() ? 1 : view.extents[0]);
+   for (size_t i = 1; i < view.extents.size(); ++i)
+      extent(view.extents[i]);
+   auto attribute = make_unique<Attribute<T, Location>>(system, view.name, extent);
+   attribute->assign(view.data, view.size);
+   return attribute;
+}
+
+template<typename T>
+static unique_ptr<AttributeBase> makeAttribute(SystemBase* system, const AttributeView& view)
+{
+   switch (view.location) {
+      case StorageLocation::VERTEX:
+         return makeAttribute<T, StorageLocation::VERTEX>(system, view);
+      case StorageLocation::EDGE:
+         return makeAttribute<T, StorageLocation::EDGE>(system, view);
+      case StorageLocation::FACE:
+         return makeAttribute<T, StorageLocation::FACE>(system, view);
+      case StorageLocation::CELL:
+         return makeAttribute<T, StorageLocation::CELL>(system, view);
+      case StorageLocation::SEGMENT:
+         return makeAttribute<T, StorageLocation::SEGMENT>(system, view);
+   }
+   throw runtime_error("Unknown attribute location in system file");
+}
+
+static unique_ptr<AttributeBase> makeAttribute(SystemBase* system, const AttributeView& view)
+{
+   switch (view.type) {
+      case ScalarType::FLOAT64:
+         return makeAttribute<double>(system, view);
+      case ScalarType::FLOAT32:
+         return makeAttribute<float>(system, view);
+      case ScalarType::INT64:
+         return makeAttribute<int64_t>(system, view);
+      case ScalarType::INT32:
+         return makeAttribute<int32_t>(system, view);
+      case ScalarType::UINT8:
+         return makeAttribute<uint8_t>(system, view);
+   }
+   throw runtime_error("Unknown attribute type in system file");
+}
+
+/**
+ * Stream buffer writing into a block of memory of fixed size.
+ */
+class MemoryBuffer : public streambuf
+{
+public:
+   MemoryBuffer(char* data, size_t size)
+   {
+      setp(data, data + size);
+   }
+};
+
+template<uint Dim, uint TopDim>
+void System<Dim, TopDim>::write(ostream& out) const
+{
+   write([&out](size_t) -> ostream& { return out; });
+}
+
+template<uint Dim, uint TopDim>
+unique_ptr<SharedMemory> System<Dim, TopDim>::share(const string& name) const
+{
+   unique_ptr<SharedMemory> shared_memory;
+   unique_ptr<MemoryBuffer> buffer;
+   unique_ptr<ostream> out;
+   write([&](size_t size) -> ostream& {
+      shared_memory = SharedMemory::create(name, size);
+      buffer = make_unique<MemoryBuffer>(shared_memory->mutableData(), size);
+      out = make_unique<ostream>(buffer.get());
+      return *out;
+   });
+   if (!*out)
+      throw runtime_error("Writing the system into shared memory failed");
+   return shared_memory;
+}
+
+template<uint Dim, uint TopDim>
+void System<Dim, TopDim>::write(const function<ostream&(size_t)>& open) const
+{
+   vector<OutputSection> sections;
+   addMeshSections(sections, 0, _mesh.get());
+   addMeshSections(sections, 1, _voronoi.get());
+
+   // Segment names as offsets into the concatenated names, padded to whole words
+   vector<uint64_t> name_offsets{segments.size(), 0};
+   for (const auto& seg : segments)
+      name_offsets.push_back(name_offsets.back() + seg->getName().size());
+   const uint64_t names_size = name_offsets.size() * sizeof(uint64_t) + (name_offsets.back() + 7) / 8 * 8;
+   sections.push_back({{format::SEGMENT_NAMES, 0, 0, 0, names_size}, [this, name_offsets](ostream& out) {
+      out.write(reinterpret_cast<const char*>(name_offsets.data()), name_offsets.size() * sizeof(uint64_t));
+      for (const auto& seg : segments)
+         out << seg->getName();
+      writePadding(out, (8 - name_offsets.back() % 8) % 8);
+   }});
+   for (size_t iseg = 0; iseg < segments.size(); ++iseg)
+      addReferenceSections(sections, format::SEGMENT_SIMPLICES, iseg, segments[iseg]->mesh());
+
+   sections.push_back({{format::INTERFACE_SEGMENTS, 0, 0, 0, 2 * interfaces.size() * sizeof(ID)}, [this](ostream& out) {
+      for (const auto& intf : interfaces) {
+         const auto segs = intf->segments();
+         writeValue<ID>(out, segs.first->getID());
+         writeValue<ID>(out, segs.second->getID());
+      }
+   }});
+   for (size_t iint = 0; iint < interfaces.size(); ++iint)
+      addReferenceSections(sections, format::INTERFACE_SIMPLICES, iint, interfaces[iint]->mesh());
+
+   // Attributes in name order, so that equal systems give equal files
+   map<string, const AttributeBase*> sorted_attributes;
+   for (const auto& attribute : attributes)
+      sorted_attributes.emplace(attribute.first, attribute.second.get());
+   uint64_t iattribute = 0;
+   for (const auto& [name, attribute] : sorted_attributes) {
+      format::AttributeHeader header{};
+      header.location = attribute->getLocation();
+      header.type = static_cast<uint32_t>(attribute->getScalarType());
+      header.ndims = attribute->getExtents().getDimension();
+      header.name_length = name.size();
+      header.data_offset = format::align(sizeof(header) + header.ndims * sizeof(uint64_t) + name.size());
+      // Files always hold the values of an entity together, whatever the layout in memory
+      header.size = attribute->getNumEntities() * attribute->getExtents().getSize();
+      const uint64_t nbytes = header.size * scalarSize(attribute->getScalarType());
+      sections.push_back({{format::ATTRIBUTE, 0, iattribute++, 0, header.data_offset + nbytes},
+                          [header, attribute = attribute, name = name, nbytes](ostream& out) {
+                             writeValue(out, header);
+                             for (uint32_t d = 0; d < header.ndims; ++d)
+                                writeValue<uint64_t>(out, attribute->getExtents().getExtent(d));
+                             out << name;
+                             writePadding(out, header.data_offset - (sizeof(header) + header.ndims * sizeof(uint64_t)
+                                                                     + name.size()));
+                             if (attribute->getLayoutBlock() == 1) {
+                                out.write(static_cast<const char*>(attribute->data()), nbytes);
+                             } else {
+                                vector<char> values(nbytes);
+                                attribute->copyTo(values.data());
+                                out.write(values.data(), nbytes);
+                             }
+                          }});
+   }
+
+   format::FileHeader header{};
+   memcpy(header.magic, format::magic, sizeof(header.magic));
+   header.version = format::version;
+   header.byte_order = format::byte_order_mark;
+   header.dim = Dim;
+   header.topdim = TopDim;
+   header.nsections = sections.size();
+   uint64_t offset = format::align(sizeof(header) + sections.size() * sizeof(format::SectionEntry));
+   for (auto& section : sections) {
+      section.entry.offset = offset;
+      offset = format::align(offset + section.entry.size);
+   }
+
+   ostream& out = open(offset);
+   writeValue(out, header);
+   for (const auto& section : sections)
+      writeValue(out, section.entry);
+   uint64_t position = sizeof(header) + sections.size() * sizeof(format::SectionEntry);
+   for (const auto& section : sections) {
+      writePadding(out, section.entry.offset - position);
+      section.write(out);
+      position = section.entry.offset + section.entry.size;
+   }
+   writePadding(out, offset - position);
+}
+
+template<uint Dim, uint TopDim>
+unique_ptr<System<Dim, TopDim>> System<Dim, TopDim>::read(istream& in)
+{
+   vector<char> buffer;
+   char chunk[1 << 16];
+   while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0)
+      buffer.insert(buffer.end(), chunk, chunk + in.gcount());
+   return read(SystemView(move(buffer)));
+}
+
+template<uint Dim, uint TopDim>
+unique_ptr<System<Dim, TopDim>> System<Dim, TopDim>::read(const SystemView& view)
+{
+   if (view.getDimension() != Dim || view.getTopologyDimension() != TopDim)
+      throw runtime_error("Dimensions of the stored system do not match");
+
+   unique_ptr<System<Dim, TopDim>> system(new System<Dim, TopDim>());
+   readMesh(view, false, system->_mesh.get());
+   readMesh(view, true, system->_voronoi.get());
+
+   for (size_t iseg = 0; iseg < view.getNumSegments(); ++iseg) {
+      Segment<Dim, TopDim>* seg = system->getOrCreateSegment(view.segmentName(iseg));
+      for (uint dim = 0; dim <= TopDim; ++dim)
+         readReferences(view.segmentSimplices(iseg, dim), dim, seg->mesh(), system->_mesh.get());
+   }
+
+   for (size_t iint = 0; iint < view.getNumInterfaces(); ++iint) {
+      const auto [seg1_id, seg2_id] = view.interfaceSegments(iint);
+      if (system->segment(seg1_id) == nullptr || system->segment(seg2_id) == nullptr)
+         throw runtime_error("Interface refers to an unknown segment");
+      MeshBase* int_mesh = system->interface(seg1_id, seg2_id)->mesh();
+      for (uint dim = 0; dim < TopDim; ++dim)
+         readReferences(view.interfaceSimplices(iint, dim), dim, int_mesh, system->_mesh.get());
+   }
+
+   for (const auto& attribute : view.attributes())
+      system->attributes[attribute.name] = makeAttribute(system.get(), attribute);
+   return system;
+}
+
+template void System<1, 1>::write(ostream&) const;
+template void System<2, 1>::write(ostream&) const;
+template void System<2, 2>::write(ostream&) const;
+template void System<3, 1>::write(ostream&) const;
+template void System<3, 2>::write(ostream&) const;
+template void System<3, 3>::write(ostream&) const;
+template unique_ptr<SharedMemory> System<1, 1>::share(const string&) const;
+template unique_ptr<SharedMemory> System<2, 1>::share(const string&) const;
+template unique_ptr<SharedMemory> System<2, 2>::share(const string&) const;
+template unique_ptr<SharedMemory> System<3, 1>::share(const string&) const;
+template unique_ptr<SharedMemory> System<3, 2>::share(const string&) const;
+template unique_ptr<SharedMemory> System<3, 3>::share(const string&) const;
+template unique_ptr<System<1, 1>> System<1, 1>::read(istream&);
+template unique_ptr<System<2, 1>> System<2, 1>::read(istream&);
+template unique_ptr<System<2, 2>> System<2, 2>::read(istream&);
+template unique_ptr<System<3, 1>> System<3, 1>::read(istream&);
+template unique_ptr<System<3, 2>> System<3, 2>::read(istream&);
+template unique_ptr<System<3, 3>> System<3, 3>::read(istream&);
+template unique_ptr<System<1, 1>> System<1, 1>::read(const SystemView&);
+template unique_ptr<System<2, 1>> System<2, 1>::read(const SystemView&);
+template unique_ptr<System<2, 2>> System<2, 2>::read(const SystemView&);
+template unique_ptr<System<3, 1>> System<3, 1>::read(const SystemView&);
+template unique_ptr<System<3, 2>> System<3, 2>::read(const SystemView&);
+template unique_ptr<System<3, 3>> System<3, 3>::read(const SystemView&);
+
+}
@@ -0,0 +1,95 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sharedmemory.h"
+
+using namespace std;
+
+namespace mesh
+{
+
+/**
+ * Shared memory names have to start with a slash, which is added if missing.
+ */
+static string segmentName(const string& name)
+{
+   if (name.empty())
+      throw logic_error("Shared memory segments need a name");
+   return name.front() == '/' ? name : '/' + name;
+}
+
+static char* map(int fd, size_t size, int protection, const string& name)
+{
+   void* addr = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+   if (addr == MAP_FAILED) {
+      const int err = errno;
+      close(fd);
+      throw runtime_error("Cannot map shared memory " + name + ": " + strerror(err));
+   }
+   // The mapping stays valid after closing the descriptor
+   close(fd);
+   return static_cast<char*>(addr);
+}
+
+unique_ptr<SharedMemory> SharedMemory::create(const string& name, size_t size)
+{
+   const string shm_name = segmentName(name);
+   const int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+   if (fd < 0)
+      throw runtime_error("Cannot create shared memory " + shm_name + ": " + strerror(errno));
+   // An empty mapping is not possible
+   const size_t mapped_size = max<size_t>(size, 1);
+   if (ftruncate(fd, mapped_size) != 0) {
+      const int err = errno;
+      close(fd);
+      shm_unlink(shm_name.c_str());
+      throw runtime_error("Cannot resize shared memory " + shm_name + ": " + strerror(err));
+   }
+   try {
+      return unique_ptr<SharedMemory>(
+            new SharedMemory(shm_name, map(fd, mapped_size, PROT_READ | PROT_WRITE, shm_name), size, true));
+   } catch (...) {
+      shm_unlink(shm_name.c_str());
+      throw;
+   }
+}
+
+unique_ptr<SharedMemory> SharedMemory::attach(const string& name)
+{
+   const string shm_name = segmentName(name);
+   const int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+   if (fd < 0)
+      throw runtime_error("Cannot open shared memory " + shm_name + ": " + strerror(errno));
+   struct stat st{};
+   if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      const int err = errno;
+      close(fd);
+      throw runtime_error("Cannot stat shared memory " + shm_name + ": " + strerror(err));
+   }
+   return unique_ptr<SharedMemory>(
+         new SharedMemory(shm_name, map(fd, st.st_size, PROT_READ, shm_name), st.st_size, false));
+}
+
+SharedMemory::SharedMemory(string name, char* data, size_t size, bool owner)
+   : _name(move(name)), _data(data), _size(size), owner(owner)
+{}
+
+SharedMemory::~SharedMemory()
+{
+   munmap(_data, max<size_t>(_size, 1));
+   if (owner)
+      shm_unlink(_name.c_str());
+}
+
+}
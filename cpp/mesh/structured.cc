@@ -0,0 +1,141 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <exception>
+
+#include "system.h"
+#include "structured.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+template<uint Dim, uint TopDim>
+Mesh<Dim, TopDim - 1>* System<Dim, TopDim>::Factory::block(const string& name, const vector<double>& lower,
+                                                           const vector<double>& upper, const vector<size_t>& divisions,
+                                                           const vector<double>& grading)
+{
+   if constexpr (Dim < 2 || Dim != TopDim) {
+      throw logic_error("Blocks are only supported for 2D and 3D volume meshes");
+   } else {
+      if (lower.size() != Dim || upper.size() != Dim || divisions.size() != Dim)
+         throw logic_error("Bounds and divisions have to be given for every axis");
+      if (!grading.empty() && grading.size() != Dim)
+         throw logic_error("Either no grading or a grading for every axis has to be given");
+
+      Block<Dim> block{};
+      for (uint d = 0; d < Dim; ++d) {
+         if (!(lower[d] < upper[d]))
+            throw logic_error("The lower corner of a block has to be below the upper corner");
+         block.lower[d] = lower[d];
+         block.upper[d] = upper[d];
+         block.divisions[d] = divisions[d];
+         block.grading[d] = grading.empty() ? 1.0 : grading[d];
+         // Validates the divisions and the grading
+         gradedPositions(block.divisions[d], block.grading[d]);
+      }
+
+      // Corners coinciding with existing input vertices are reused, so that neighbouring blocks share their sides
+      vector<double>& points = system_input_mesh->getPointList();
+      for (unsigned mask = 0; mask < (1u << Dim); ++mask) {
+         array<double, Dim> corner;
+         for (uint d = 0; d < Dim; ++d)
+            corner[d] = (mask & (1u << d)) ? upper[d] : lower[d];
+         ID corner_id = -1;
+         for (size_t vid = 0; vid < points.size() / Dim && corner_id < 0; ++vid)
+            if (equal(corner.begin(), corner.end(), points.begin() + Dim * vid))
+               corner_id = vid;
+         if (corner_id < 0) {
+            corner_id = points.size() / Dim;
+            points.insert(points.end(), corner.begin(), corner.end());
+            system_input_mesh->vertices().create({corner_id});
+         }
+         block.corners[mask] = corner_id;
+      }
+
+      Mesh<Dim, TopDim - 1>* seg_mesh = segment(name);
+      block.segment = system->segment(name)->getID();
+      if (any_of(blocks.begin(), blocks.end(), [&](const Block<Dim>& b) { return b.segment == block.segment; })
+          || seg_mesh->bodies().size() > 0)
+         throw logic_error("A block has to be the only boundary of its segment");
+
+      const auto& c = block.corners;
+      if constexpr (Dim == 2) {
+         for (const auto& edge : {make_pair(0, 1), make_pair(1, 3), make_pair(3, 2), make_pair(2, 0)})
+            seg_mesh->edges().create({c[edge.first], c[edge.second]});
+      } else {
+         // Every face is split along the diagonal from its lowest to its highest corner
+         for (uint d = 0; d < Dim; ++d) {
+            const unsigned a = 1u << (d == 0 ? 1 : 0);
+            const unsigned b = 1u << (d == 2 ? 1 : 2);
+            for (const unsigned side : {0u, 1u << d}) {
+               seg_mesh->faces().create({c[side], c[side | a], c[side | a | b]});
+               seg_mesh->faces().create({c[side], c[side | b], c[side | a | b]});
+            }
+         }
+      }
+      blocks.push_back(block);
+      return seg_mesh;
+   }
+}
+
+template<>
+System<3, 3>* System<3, 3>::Factory::generate(double area) const
+{
+   return generateDecomposed(area);
+}
+
+template<>
+System<3, 3>* System<3, 3>::Factory::generateDecomposed([[maybe_unused]] double area) const
+{
+   const size_t nsegs = segment_input_meshes.size();
+   vector<double> coordinates = system_input_mesh->getPointList();
+   SharedBoundaries<3> shared(coordinates);
+   vector<SegmentPatch<3>> patches(nsegs);
+   vector<const Block<3>*> seg2block(nsegs, nullptr);
+   vector<vector<ID>> block_nodes(nsegs);
+   for (const auto& block : blocks) {
+      seg2block[block.segment] = &block;
+      block_nodes[block.segment] = shared.block(block, block.segment, patches[block.segment].entities);
+   }
+   for (size_t iseg = 0; iseg < nsegs; ++iseg)
+      if (seg2block[iseg] == nullptr && segment_input_meshes[iseg]->bodies().size() > 0)
+         throw runtime_error("Only blocks can be meshed in 3D");
+
+   exception_ptr error = nullptr;
+#pragma omp parallel for schedule(dynamic)
+   for (long iseg = 0; iseg < (long) nsegs; ++iseg) {
+      try {
+         if (seg2block[iseg] != nullptr)
+            meshBlock(*seg2block[iseg], block_nodes[iseg], patches[iseg]);
+      } catch (...) {
+#pragma omp critical
+         error = current_exception();
+      }
+   }
+   if (error)
+      rethrow_exception(error);
+
+   System<3, 3>* result_system = new System<3, 3>();
+   for (const auto& seg : system->segments)
+      result_system->getOrCreateSegment(seg->name);
+   assemble(result_system, move(coordinates), shared, patches);
+   return result_system;
+}
+
+template Mesh<1, 0>* System<1, 1>::Factory::block(const string&, const vector<double>&, const vector<double>&,
+                                                  const vector<size_t>&, const vector<double>&);
+template Mesh<2, 0>* System<2, 1>::Factory::block(const string&, const vector<double>&, const vector<double>&,
+                                                  const vector<size_t>&, const vector<double>&);
+template Mesh<2, 1>* System<2, 2>::Factory::block(const string&, const vector<double>&, const vector<double>&,
+                                                  const vector<size_t>&, const vector<double>&);
+template Mesh<3, 0>* System<3, 1>::Factory::block(const string&, const vector<double>&, const vector<double>&,
+                                                  const vector<size_t>&, const vector<double>&);
+template Mesh<3, 1>* System<3, 2>::Factory::block(const string&, const vector<double>&, const vector<double>&,
+                                                  const vector<size_t>&, const vector<double>&);
+template Mesh<3, 2>* System<3, 3>::Factory::block(const string&, const vector<double>&, const vector<double>&,
+                                                  const vector<size_t>&, const vector<double>&);
+
+}
@@ -0,0 +1,501 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_STRUCTURED_HH
+#define PYULB_STRUCTURED_HH
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <vector>
+
+#include "system.h"
+
+namespace mesh
+{
+
+/**
+ * Relative positions in [0, 1] of the nodes of a graded line.
+ *
+ * @param divisions The number of cells
+ * @param grading The ratio of the last to the first cell length
+ */
+inline std::vector<double> gradedPositions(std::size_t divisions, double grading)
+{
+   if (divisions == 0)
+      throw std::logic_error("At least one division is required");
+   if (!(grading > 0.0))
+      throw std::logic_error("The grading has to be positive");
+   const double ratio = divisions > 1 ? std::pow(grading, 1.0 / (divisions - 1)) : 1.0;
+   std::vector<double> positions(divisions + 1, 0.0);
+   double length = 1.0;
+   for (std::size_t i = 1; i <= divisions; ++i) {
+      positions[i] = positions[i - 1] + length;
+      length *= ratio;
+   }
+   const double total = positions.back();
+   for (double& p : positions)
+      p /= total;
+   positions.back() = 1.0;
+   return positions;
+}
+
+/**
+ * Node grid of up to three dimensions, numbered with the first axis running fastest.
+ */
+struct GridShape
+{
+   std::vector<std::size_t> divisions;
+
+   [[nodiscard]]
+   std::size_t size() const
+   {
+      std::size_t n = 1;
+      for (const std::size_t d : divisions)
+         n *= d + 1;
+      return n;
+   }
+
+   [[nodiscard]]
+   std::size_t stride(uint axis) const
+   {
+      std::size_t s = 1;
+      for (uint d = 0; d < axis; ++d)
+         s *= divisions[d] + 1;
+      return s;
+   }
+
+   [[nodiscard]]
+   std::size_t index(const std::array<std::size_t, 3>& position) const
+   {
+      std::size_t idx = 0;
+      for (uint d = 0; d < divisions.size(); ++d)
+         idx += position[d] * stride(d);
+      return idx;
+   }
+
+   [[nodiscard]]
+   std::array<std::size_t, 3> position(std::size_t index) const
+   {
+      std::array<std::size_t, 3> pos{};
+      for (uint d = 0; d < divisions.size(); ++d) {
+         pos[d] = index % (divisions[d] + 1);
+         index /= divisions[d] + 1;
+      }
+      return pos;
+   }
+};
+
+/**
+ * Simplices of the Freudenthal (Kuhn) subdivision of a grid cell. Every simplex is given by the offsets of its
+ * vertices from its lowest vertex, as bitmasks of the axes. Every face of a cell is split along the diagonal from its
+ * lowest to its highest corner, therefore neighbouring cells are split conformingly.
+ *
+ * @param griddim The dimension of the grid
+ * @param simplexdim The dimension of the simplices
+ */
+inline std::vector<std::vector<unsigned>> freudenthalSimplices(uint griddim, uint simplexdim)
+{
+   const unsigned all = (1u << griddim) - 1;
+   std::vector<std::vector<unsigned>> simplices;
+   std::vector<unsigned> masks{0};
+   // Every step to the next vertex adds a non-empty set of axes not used so far
+   const auto extend = [&](const auto& self) -> void {
+      if (masks.size() == simplexdim + 1) {
+         simplices.push_back(masks);
+         return;
+      }
+      const unsigned used = masks.back();
+      for (unsigned axes = 1; axes <= all; ++axes) {
+         if (axes & used)
+            continue;
+         masks.push_back(used | axes);
+         self(self);
+         masks.pop_back();
+      }
+   };
+   extend(extend);
+   return simplices;
+}
+
+/**
+ * Calls fn with the node indices of every simplex of the Freudenthal subdivision of the grid, which does not lie
+ * within the boundary of the grid. The simplices on the boundary belong to the neighbouring lower dimensional
+ * entities, e.g. the edges along the sides of a 2D grid.
+ */
+template<typename Fn>
+void forEachInteriorSimplex(const GridShape& grid, uint simplexdim, Fn&& fn)
+{
+   const uint griddim = grid.divisions.size();
+   const auto stencils = freudenthalSimplices(griddim, simplexdim);
+   std::vector<std::array<std::size_t, 4>> offsets(stencils.size());
+   for (std::size_t is = 0; is < stencils.size(); ++is)
+      for (uint iv = 0; iv <= simplexdim; ++iv)
+         for (uint d = 0; d < griddim; ++d)
+            if (stencils[is][iv] & (1u << d))
+               offsets[is][iv] += grid.stride(d);
+
+   std::array<std::size_t, 4> nodes{};
+   for (std::size_t inode = 0; inode < grid.size(); ++inode) {
+      const auto pos = grid.position(inode);
+      for (std::size_t is = 0; is < stencils.size(); ++is) {
+         const unsigned axes = stencils[is].back();
+         bool interior = true;
+         for (uint d = 0; d < griddim && interior; ++d) {
+            if (axes & (1u << d))
+               interior = pos[d] < grid.divisions[d];
+            else
+               interior = pos[d] > 0 && pos[d] < grid.divisions[d];
+         }
+         if (!interior)
+            continue;
+         for (uint iv = 0; iv <= simplexdim; ++iv)
+            nodes[iv] = inode + offsets[is][iv];
+         fn(nodes.data());
+      }
+   }
+}
+
+/**
+ * Discretisation of the boundaries between the segments of a decomposed mesh. Every edge chain and, in 3D, every
+ * block face is discretised exactly once, so that independently meshed segments conform along them.
+ */
+template<uint Dim>
+class SharedBoundaries
+{
+public:
+   /**
+    * A chain of vertices along an edge or the node grid of a block face.
+    */
+   struct Entity
+   {
+      GridShape grid;
+      // Vertex IDs in grid order
+      std::vector<ID> nodes;
+      // Chains bounding a face
+      std::vector<std::size_t> subentities;
+      // Segments bounded by the entity
+      std::vector<std::size_t> segments;
+   };
+
+   explicit SharedBoundaries(std::vector<double>& coordinates) : coordinates(coordinates)
+   {}
+
+   /**
+    * Returns the chain along the edge a-b, which is created if it does not exist yet.
+    *
+    * @param positions The relative positions in [0, 1] of the chain vertices from a to b, only used for creation
+    */
+   std::size_t chain(ID a, ID b, const std::vector<double>& positions)
+   {
+      const auto key = std::make_pair(std::min(a, b), std::max(a, b));
+      const auto it = edge2chain.find(key);
+      if (it != edge2chain.end())
+         return it->second;
+      Entity chain;
+      chain.grid.divisions = {positions.size() - 1};
+      chain.nodes.reserve(positions.size());
+      chain.nodes.push_back(key.first);
+      for (std::size_t i = 1; i + 1 < positions.size(); ++i) {
+         // Chains are stored from the lower to the higher vertex ID
+         const double t = a < b ? positions[i] : 1.0 - positions[positions.size() - 1 - i];
+         chain.nodes.push_back(addPoint([&](uint d) {
+            return coordinates[Dim * key.first + d] * (1.0 - t) + coordinates[Dim * key.second + d] * t;
+         }));
+      }
+      chain.nodes.push_back(key.second);
+      edge2chain.emplace(key, entities.size());
+      entities.push_back(std::move(chain));
+      return entities.size() - 1;
+   }
+
+   /**
+    * @return The vertices of the chain ordered starting from the given end
+    */
+   [[nodiscard]]
+   std::vector<ID> chainNodes(std::size_t ichain, ID from) const
+   {
+      std::vector<ID> nodes = entities[ichain].nodes;
+      if (nodes.front() != from)
+         std::reverse(nodes.begin(), nodes.end());
+      return nodes;
+   }
+
+   /**
+    * Returns the face of a block with the given corners, which is created if it does not exist yet. The chains
+    * along the sides of the face have to exist already.
+    */
+   std::size_t face(ID c00, ID c10, ID c01, ID c11)
+   {
+      std::array<ID, 4> key{c00, c10, c01, c11};
+      std::sort(key.begin(), key.end());
+      const auto it = corners2face.find(key);
+      if (it != corners2face.end())
+         return it->second;
+      const std::array<std::size_t, 4> sides{edge2chain.at(std::minmax(c00, c10)), edge2chain.at(std::minmax(c01, c11)),
+                                             edge2chain.at(std::minmax(c00, c01)), edge2chain.at(std::minmax(c10, c11))};
+      const std::vector<ID> bottom = chainNodes(sides[0], c00);
+      const std::vector<ID> top = chainNodes(sides[1], c01);
+      const std::vector<ID> left = chainNodes(sides[2], c00);
+      const std::vector<ID> right = chainNodes(sides[3], c10);
+      Entity face;
+      face.grid.divisions = {bottom.size() - 1, left.size() - 1};
+      face.subentities.assign(sides.begin(), sides.end());
+      face.nodes.resize(face.grid.size());
+      for (std::size_t ib = 0; ib < left.size(); ++ib) {
+         for (std::size_t ia = 0; ia < bottom.size(); ++ia) {
+            ID& node = face.nodes[face.grid.index({ia, ib, 0})];
+            if (ib == 0)
+               node = bottom[ia];
+            else if (ib + 1 == left.size())
+               node = top[ia];
+            else if (ia == 0)
+               node = left[ib];
+            else if (ia + 1 == bottom.size())
+               node = right[ib];
+            else
+               node = addPoint([&](uint d) {
+                  return coordinates[Dim * bottom[ia] + d] + coordinates[Dim * left[ib] + d] - coordinates[Dim * c00 + d];
+               });
+         }
+      }
+      corners2face.emplace(key, entities.size());
+      entities.push_back(std::move(face));
+      return entities.size() - 1;
+   }
+
+   /**
+    * Discretises the boundary of a block and registers the segment with all boundary entities of the block.
+    *
+    * @param entities The boundary entities of the segment, the ones of the block are added
+    * @return The vertex IDs of the block grid nodes on the block boundary, -1 for the interior nodes
+    */
+   std::vector<ID> block(const Block<Dim>& block, std::size_t iseg, std::vector<std::size_t>& seg_entities)
+   {
+      const GridShape grid{std::vector<std::size_t>(block.divisions.begin(), block.divisions.end())};
+      std::vector<ID> nodes(grid.size(), -1);
+      const auto corner = [&](unsigned mask) {
+         std::array<std::size_t, 3> pos{};
+         for (uint d = 0; d < Dim; ++d)
+            pos[d] = (mask & (1u << d)) ? block.divisions[d] : 0;
+         return pos;
+      };
+      const auto bound = [&](std::size_t ientity) {
+         std::vector<std::size_t>& segments = entities[ientity].segments;
+         if (std::find(segments.begin(), segments.end(), iseg) == segments.end())
+            segments.push_back(iseg);
+         seg_entities.push_back(ientity);
+      };
+
+      for (unsigned mask = 0; mask < (1u << Dim); ++mask)
+         nodes[grid.index(corner(mask))] = block.corners[mask];
+
+      for (uint d = 0; d < Dim; ++d) {
+         const std::vector<double> positions = gradedPositions(block.divisions[d], block.grading[d]);
+         for (unsigned mask = 0; mask < (1u << Dim); ++mask) {
+            if (mask & (1u << d))
+               continue;
+            const ID a = block.corners[mask];
+            const std::size_t ichain = chain(a, block.corners[mask | (1u << d)], positions);
+            if (entities[ichain].grid.divisions[0] != block.divisions[d])
+               throw std::logic_error("Neighbouring segments discretise a shared edge differently");
+            bound(ichain);
+            const std::vector<ID> chain_nodes = chainNodes(ichain, a);
+            auto pos = corner(mask);
+            for (std::size_t i = 0; i < chain_nodes.size(); ++i) {
+               pos[d] = i;
+               nodes[grid.index(pos)] = chain_nodes[i];
+            }
+         }
+      }
+
+      if constexpr (Dim == 3) {
+         for (uint d = 0; d < Dim; ++d) {
+            const uint a = d == 0 ? 1 : 0;
+            const uint b = d == 2 ? 1 : 2;
+            for (const unsigned side : {0u, 1u << d}) {
+               const std::size_t iface = face(block.corners[side], block.corners[side | (1u << a)],
+                                              block.corners[side | (1u << b)],
+                                              block.corners[side | (1u << a) | (1u << b)]);
+               bound(iface);
+               const Entity& f = entities[iface];
+               auto pos = corner(side);
+               for (std::size_t ib = 0; ib <= f.grid.divisions[1]; ++ib) {
+                  for (std::size_t ia = 0; ia <= f.grid.divisions[0]; ++ia) {
+                     pos[a] = ia;
+                     pos[b] = ib;
+                     nodes[grid.index(pos)] = f.nodes[f.grid.index({ia, ib, 0})];
+                  }
+               }
+            }
+         }
+      }
+      return nodes;
+   }
+
+   std::vector<Entity> entities;
+
+private:
+   std::vector<double>& coordinates;
+   std::map<std::pair<ID, ID>, std::size_t> edge2chain;
+   std::map<std::array<ID, 4>, std::size_t> corners2face;
+
+   template<typename Coordinate>
+   ID addPoint(Coordinate&& coordinate)
+   {
+      const ID id = coordinates.size() / Dim;
+      for (uint d = 0; d < Dim; ++d)
+         coordinates.push_back(coordinate(d));
+      return id;
+   }
+};
+
+/**
+ * The mesh of one segment of a decomposed mesh, before it is stitched into the system.
+ */
+template<uint Dim>
+struct SegmentPatch
+{
+   // Vertex IDs of the local vertices on the segment boundary, which come first in the local numbering
+   std::vector<ID> boundary;
+   // Coordinates of the interior vertices
+   std::vector<double> points;
+   // Simplices by dimension as local vertex IDs, without the ones within the boundary entities
+   std::array<std::vector<ID>, Dim + 1> simplices;
+   // Boundary entities the segment is bounded by
+   std::vector<std::size_t> entities;
+};
+
+/**
+ * Meshes the interior of a block with the Freudenthal subdivision of its grid.
+ *
+ * @param nodes The vertex IDs of the boundary nodes as returned by SharedBoundaries::block
+ */
+template<uint Dim>
+void meshBlock(const Block<Dim>& block, const std::vector<ID>& nodes, SegmentPatch<Dim>& patch)
+{
+   const GridShape grid{std::vector<std::size_t>(block.divisions.begin(), block.divisions.end())};
+   std::array<std::vector<double>, Dim> positions;
+   for (uint d = 0; d < Dim; ++d)
+      positions[d] = gradedPositions(block.divisions[d], block.grading[d]);
+
+   std::vector<ID> local(grid.size());
+   for (std::size_t inode = 0; inode < grid.size(); ++inode) {
+      if (nodes[inode] < 0)
+         continue;
+      local[inode] = patch.boundary.size();
+      patch.boundary.push_back(nodes[inode]);
+   }
+   ID next = patch.boundary.size();
+   for (std::size_t inode = 0; inode < grid.size(); ++inode) {
+      if (nodes[inode] >= 0)
+         continue;
+      local[inode] = next++;
+      const auto pos = grid.position(inode);
+      for (uint d = 0; d < Dim; ++d)
+         patch.points.push_back(block.lower[d] + (block.upper[d] - block.lower[d]) * positions[d][pos[d]]);
+   }
+
+   for (uint k = 1; k <= Dim; ++k) {
+      std::vector<ID>& simplices = patch.simplices[k];
+      forEachInteriorSimplex(grid, k, [&](const std::size_t* vertices) {
+         for (uint iv = 0; iv <= k; ++iv)
+            simplices.push_back(local[vertices[iv]]);
+      });
+   }
+}
+
+/**
+ * Stitches the segment patches together into the mesh of the system. The simplices are appended in bulk, which is
+ * possible since every simplex belongs to exactly one boundary entity or segment. The entities of codimension one
+ * shared by two segments form their interfaces.
+ *
+ * @param coordinates The coordinates of the input and boundary vertices
+ */
+template<uint Dim>
+void assemble(System<Dim, Dim>* system, std::vector<double>&& coordinates, const SharedBoundaries<Dim>& shared,
+              const std::vector<SegmentPatch<Dim>>& patches)
+{
+   MeshBase* mesh = system->mesh();
+   const std::size_t nsegs = patches.size();
+   std::vector<std::size_t> point_offsets(nsegs + 1, coordinates.size() / Dim);
+   for (std::size_t iseg = 0; iseg < nsegs; ++iseg)
+      point_offsets[iseg + 1] = point_offsets[iseg] + patches[iseg].points.size() / Dim;
+   coordinates.reserve(Dim * point_offsets[nsegs]);
+   for (const auto& patch : patches)
+      coordinates.insert(coordinates.end(), patch.points.begin(), patch.points.end());
+   mesh->getPointList() = std::move(coordinates);
+
+   std::vector<ID> ids(point_offsets[nsegs]);
+   std::iota(ids.begin(), ids.end(), 0);
+   mesh->simplices(0).append(ids.data(), ids.size());
+
+   const auto append = [&](uint k, const std::vector<ID>& vertices) {
+      MeshElementsProxy& elements = mesh->simplices(k);
+      std::vector<ID> appended(vertices.size() / (k + 1));
+      std::iota(appended.begin(), appended.end(), static_cast<ID>(elements.size()));
+      elements.append(vertices.data(), appended.size());
+      return appended;
+   };
+
+   std::vector<std::array<std::vector<ID>, Dim>> entity_simplices(shared.entities.size());
+   for (std::size_t ientity = 0; ientity < shared.entities.size(); ++ientity) {
+      const auto& entity = shared.entities[ientity];
+      for (uint k = 1; k <= entity.grid.divisions.size(); ++k) {
+         std::vector<ID> vertices;
+         forEachInteriorSimplex(entity.grid, k, [&](const std::size_t* nodes) {
+            for (uint iv = 0; iv <= k; ++iv)
+               vertices.push_back(entity.nodes[nodes[iv]]);
+         });
+         entity_simplices[ientity][k] = append(k, vertices);
+      }
+   }
+
+   for (std::size_t iseg = 0; iseg < nsegs; ++iseg) {
+      const SegmentPatch<Dim>& patch = patches[iseg];
+      MeshBase* seg_mesh = system->segment(static_cast<ID>(iseg))->mesh();
+      std::vector<ID> l2g = patch.boundary;
+      for (std::size_t vid = point_offsets[iseg]; vid < point_offsets[iseg + 1]; ++vid)
+         l2g.push_back(vid);
+      seg_mesh->simplices(0).reference(l2g.data(), l2g.size());
+      for (uint k = 1; k <= Dim; ++k) {
+         std::vector<ID> vertices(patch.simplices[k].size());
+         for (std::size_t i = 0; i < vertices.size(); ++i)
+            vertices[i] = l2g[patch.simplices[k][i]];
+         std::vector<ID> refs = append(k, vertices);
+         if (k < Dim)
+            for (const std::size_t ientity : patch.entities)
+               refs.insert(refs.end(), entity_simplices[ientity][k].begin(), entity_simplices[ientity][k].end());
+         seg_mesh->simplices(k).reference(refs.data(), refs.size());
+      }
+   }
+
+   // Sub-entities are shared by the entities of an interface, therefore the references are made unique
+   std::map<std::pair<std::size_t, std::size_t>, std::array<std::vector<ID>, Dim>> interfaces;
+   for (std::size_t ientity = 0; ientity < shared.entities.size(); ++ientity) {
+      const auto& entity = shared.entities[ientity];
+      if (entity.grid.divisions.size() != Dim - 1 || entity.segments.size() != 2)
+         continue;
+      auto& refs = interfaces[std::minmax(entity.segments[0], entity.segments[1])];
+      refs[0].insert(refs[0].end(), entity.nodes.begin(), entity.nodes.end());
+      for (uint k = 1; k < Dim; ++k) {
+         refs[k].insert(refs[k].end(), entity_simplices[ientity][k].begin(), entity_simplices[ientity][k].end());
+         for (const std::size_t isub : entity.subentities)
+            refs[k].insert(refs[k].end(), entity_simplices[isub][k].begin(), entity_simplices[isub][k].end());
+      }
+   }
+   for (auto& [segs, refs] : interfaces) {
+      MeshBase* int_mesh = system->interface(static_cast<ID>(segs.first), static_cast<ID>(segs.second))->mesh();
+      for (uint k = 0; k < Dim; ++k) {
+         std::sort(refs[k].begin(), refs[k].end());
+         refs[k].erase(std::unique(refs[k].begin(), refs[k].end()), refs[k].end());
+         int_mesh->simplices(k).reference(refs[k].data(), refs[k].size());
+      }
+   }
+}
+
+}
+
+#endif //PYULB_STRUCTURED_HH
@@ -0,0 +1,568 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
+
+#include "surface.h"
+#include "mappedfile.h"
+#include "tokens.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+/**
+ * Points and triangles of a surface file, with the triangles referring to the points of the file.
+ */
+struct Surface
+{
+   vector<double> points;
+   vector<ID> triangles;
+};
+
+/**
+ * Splits polygons into fans of triangles.
+ *
+ * @param corners The vertex indices of every polygon, from offsets[i] to offsets[i] + counts[i]
+ */
+template<typename Corner>
+static void triangulateFans(const vector<size_t>& counts, Corner&& corner, vector<ID>& triangles)
+{
+   vector<size_t> first(counts.size() + 1, 0);
+   for (size_t i = 0; i < counts.size(); ++i)
+      first[i + 1] = first[i] + (counts[i] >= 3 ? counts[i] - 2 : 0);
+   triangles.resize(3 * first.back());
+#pragma omp parallel for
+   for (long i = 0; i < (long) counts.size(); ++i) {
+      for (size_t it = 0; it + 2 < counts[i]; ++it) {
+         ID* triangle = &triangles[3 * (first[i] + it)];
+         triangle[0] = corner(i, 0);
+         triangle[1] = corner(i, it + 1);
+         triangle[2] = corner(i, it + 2);
+      }
+   }
+}
+
+enum class PlyType
+{
+   INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64
+};
+
+static PlyType plyType(const string& name)
+{
+   static const unordered_map<string, PlyType> types = {
+      {"char", PlyType::INT8}, {"int8", PlyType::INT8}, {"uchar", PlyType::UINT8}, {"uint8", PlyType::UINT8},
+      {"short", PlyType::INT16}, {"int16", PlyType::INT16}, {"ushort", PlyType::UINT16},
+      {"uint16", PlyType::UINT16}, {"int", PlyType::INT32}, {"int32", PlyType::INT32}, {"uint", PlyType::UINT32},
+      {"uint32", PlyType::UINT32}, {"float", PlyType::FLOAT32}, {"float32", PlyType::FLOAT32},
+      {"double", PlyType::FLOAT64}, {"float64", PlyType::FLOAT64}};
+   const auto it = types.find(name);
+   if (it == types.end())
+      throw runtime_error("Unknown PLY property type " + name);
+   return it->second;
+}
+
+static size_t plySize(PlyType type)
+{
+   switch (type) {
+      case PlyType::INT8:
+      case PlyType::UINT8:
+         return 1;
+      case PlyType::INT16:
+      case PlyType::UINT16:
+         return 2;
+      case PlyType::INT32:
+      case PlyType::UINT32:
+      case PlyType::FLOAT32:
+         return 4;
+      case PlyType::FLOAT64:
+         return 8;
+   }
+   return 0;
+}
+
+template<typename T>
+static double plyScalar(const char* bytes)
+{
+   T value;
+   memcpy(&value, bytes, sizeof(T));
+   return static_cast<double>(value);
+}
+
+struct PlyProperty
+{
+   string name;
+   PlyType type;
+   bool list;
+   PlyType count_type;
+};
+
+struct PlyElement
+{
+   string name;
+   size_t count;
+   vector<PlyProperty> properties;
+};
+
+/**
+ * Values of the body of a PLY file. The position is a byte offset in binary files and a token index in ASCII files,
+ * so that rows of a fixed size can be skipped and converted later in the same way for both.
+ */
+class PlyBody
+{
+public:
+   PlyBody(const char* begin, const char* end, bool binary, bool swap)
+      : begin(begin), end(end), binary(binary), swap(swap)
+   {
+      if (!binary)
+         tokens = tokenise(begin, end);
+   }
+
+   [[nodiscard]]
+   size_t size(PlyType type) const
+   {
+      return binary ? plySize(type) : 1;
+   }
+
+   double value(size_t pos, PlyType type) const
+   {
+      if (!binary)
+         return parseToken<double>(begin + tokens[pos], end);
+      char bytes[8];
+      memcpy(bytes, begin + pos, plySize(type));
+      if (swap)
+         reverse(bytes, bytes + plySize(type));
+      switch (type) {
+         case PlyType::INT8: return plyScalar<int8_t>(bytes);
+         case PlyType::UINT8: return plyScalar<uint8_t>(bytes);
+         case PlyType::INT16: return plyScalar<int16_t>(bytes);
+         case PlyType::UINT16: return plyScalar<uint16_t>(bytes);
+         case PlyType::INT32: return plyScalar<int32_t>(bytes);
+         case PlyType::UINT32: return plyScalar<uint32_t>(bytes);
+         case PlyType::FLOAT32: return plyScalar<float>(bytes);
+         case PlyType::FLOAT64: return plyScalar<double>(bytes);
+      }
+      return 0.0;
+   }
+
+   /**
+    * Skips n values of the given size.
+    *
+    * @return The position of the first value
+    */
+   size_t skip(size_t n, size_t value_size)
+   {
+      const size_t available = binary ? (end - begin) - position : tokens.size() - position;
+      if (value_size != 0 && n > available / value_size)
+         throw runtime_error("PLY file is truncated");
+      const size_t first = position;
+      position += n * value_size;
+      return first;
+   }
+
+   double next(PlyType type)
+   {
+      return value(skip(1, size(type)), type);
+   }
+
+private:
+   const char* begin;
+   const char* end;
+   bool binary;
+   bool swap;
+   vector<size_t> tokens;
+   size_t position = 0;
+};
+
+static Surface readPly(const MappedFile& file)
+{
+   const char* pos = file.data();
+   const char* const end = file.data() + file.size();
+   const auto line = [&]() {
+      const char* eol = find(pos, end, '\n');
+      string text(pos, eol);
+      pos = eol < end ? eol + 1 : end;
+      if (!text.empty() && text.back() == '\r')
+         text.pop_back();
+      return text;
+   };
+
+   if (line() != "ply")
+      throw runtime_error(file.path() + " is not a PLY file");
+   string format;
+   vector<PlyElement> elements;
+   for (string text = line(); text != "end_header"; text = line()) {
+      if (pos == end)
+         throw runtime_error("PLY header is not terminated");
+      istringstream ss(text);
+      string keyword;
+      ss >> keyword;
+      if (keyword == "format") {
+         ss >> format;
+      } else if (keyword == "element") {
+         PlyElement element;
+         ss >> element.name >> element.count;
+         elements.push_back(element);
+      } else if (keyword == "property") {
+         if (elements.empty())
+            throw runtime_error("PLY property outside of an element");
+         PlyProperty property{};
+         string type;
+         ss >> type;
+         if (type == "list") {
+            string count_type;
+            ss >> count_type >> type;
+            property.list = true;
+            property.count_type = plyType(count_type);
+         }
+         property.type = plyType(type);
+         ss >> property.name;
+         elements.back().properties.push_back(property);
+      }
+   }
+   const bool little_endian = [] {
+      const uint16_t probe = 1;
+      return *reinterpret_cast<const char*>(&probe) == 1;
+   }();
+   if (format != "ascii" && format != "binary_little_endian" && format != "binary_big_endian")
+      throw runtime_error("Unknown PLY format " + format);
+   PlyBody body(pos, end, format != "ascii", format == (little_endian ? "binary_big_endian" : "binary_little_endian"));
+
+   Surface surface;
+   for (const auto& element : elements) {
+      const bool fixed = none_of(element.properties.begin(), element.properties.end(),
+                                 [](const PlyProperty& property) { return property.list; });
+      if (element.name == "vertex" && fixed) {
+         // Offsets of the properties in a row
+         size_t row_size = 0;
+         array<long, 3> offsets{-1, -1, -1};
+         array<PlyType, 3> types{};
+         for (const auto& property : element.properties) {
+            for (uint d = 0; d < 3; ++d) {
+               if (property.name == string(1, char('x' + d))) {
+                  offsets[d] = row_size;
+                  types[d] = property.type;
+               }
+            }
+            row_size += body.size(property.type);
+         }
+         if (*min_element(offsets.begin(), offsets.end()) < 0)
+            throw runtime_error("PLY vertices have no x, y and z coordinates");
+         const size_t first = body.skip(element.count, row_size);
+         surface.points.resize(3 * element.count);
+#pragma omp parallel for
+         for (long i = 0; i < (long) element.count; ++i)
+            for (uint d = 0; d < 3; ++d)
+               surface.points[3 * i + d] = body.value(first + i * row_size + offsets[d], types[d]);
+      } else if (fixed) {
+         size_t row_size = 0;
+         for (const auto& property : element.properties)
+            row_size += body.size(property.type);
+         body.skip(element.count, row_size);
+      } else {
+         // Rows with lists are walked through, the polygons are converted afterwards
+         const bool faces = element.name == "face";
+         vector<size_t> polygon_positions, counts;
+         PlyType index_type = PlyType::INT32;
+         for (size_t row = 0; row < element.count; ++row) {
+            for (const auto& property : element.properties) {
+               if (!property.list) {
+                  body.skip(1, body.size(property.type));
+                  continue;
+               }
+               const double count = body.next(property.count_type);
+               if (count < 0)
+                  throw runtime_error("Negative PLY list length");
+               const size_t first = body.skip(static_cast<size_t>(count), body.size(property.type));
+               if (faces && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+                  polygon_positions.push_back(first);
+                  counts.push_back(static_cast<size_t>(count));
+                  index_type = property.type;
+               }
+            }
+         }
+         const size_t index_size = body.size(index_type);
+         triangulateFans(counts, [&](size_t i, size_t ic) {
+            return static_cast<ID>(body.value(polygon_positions[i] + ic * index_size, index_type));
+         }, surface.triangles);
+      }
+   }
+   return surface;
+}
+
+static Surface readObj(const MappedFile& file)
+{
+   const char* const begin = file.data();
+   const char* const end = file.data() + file.size();
+   const vector<size_t> bounds = lineBlocks(begin, end);
+   const size_t nblocks = bounds.size() - 1;
+
+   /**
+    * Calls the visitor with the kind ('v' or 'f'), the first character behind the keyword and the end of every
+    * vertex and face line in the block.
+    */
+   const auto scan = [&](size_t iblock, const auto& visit) {
+      const char* line = begin + bounds[iblock];
+      const char* const block_end = begin + bounds[iblock + 1];
+      while (line < block_end) {
+         const char* eol = static_cast<const char*>(memchr(line, '\n', block_end - line));
+         if (eol == nullptr)
+            eol = block_end;
+         const char* p = line;
+         while (p < eol && (*p == ' ' || *p == '\t'))
+            ++p;
+         if (eol - p >= 2 && (p[0] == 'v' || p[0] == 'f') && (p[1] == ' ' || p[1] == '\t'))
+            visit(p[0], p + 2, eol);
+         line = eol + 1;
+      }
+   };
+   // Number of the face corners in the line
+   const auto countCorners = [](const char* p, const char* eol) {
+      size_t n = 0;
+      bool in_token = false;
+      for (; p < eol; ++p) {
+         const bool space = isSpace(*p);
+         n += !space && !in_token;
+         in_token = !space;
+      }
+      return n;
+   };
+
+   // First the vertices and face corners are counted per block, then converted into their places
+   vector<size_t> nvertices(nblocks + 1, 0), nfaces(nblocks + 1, 0), ncorners(nblocks + 1, 0);
+#pragma omp parallel for
+   for (long iblock = 0; iblock < (long) nblocks; ++iblock) {
+      scan(iblock, [&](char kind, const char* p, const char* eol) {
+         if (kind == 'v') {
+            ++nvertices[iblock + 1];
+         } else {
+            ++nfaces[iblock + 1];
+            ncorners[iblock + 1] += countCorners(p, eol);
+         }
+      });
+   }
+   partial_sum(nvertices.begin(), nvertices.end(), nvertices.begin());
+   partial_sum(nfaces.begin(), nfaces.end(), nfaces.begin());
+   partial_sum(ncorners.begin(), ncorners.end(), ncorners.begin());
+
+   Surface surface;
+   surface.points.resize(3 * nvertices[nblocks]);
+   vector<size_t> counts(nfaces[nblocks]);
+   vector<size_t> face_offsets(nfaces[nblocks]);
+   vector<ID> corners(ncorners[nblocks]);
+   bool valid = true;
+#pragma omp parallel for reduction(&&:valid)
+   for (long iblock = 0; iblock < (long) nblocks; ++iblock) {
+      size_t ivertex = nvertices[iblock], iface = nfaces[iblock], icorner = ncorners[iblock];
+      scan(iblock, [&](char kind, const char* p, const char* eol) {
+         if (kind == 'v') {
+            for (uint d = 0; d < 3; ++d) {
+               char* last;
+               surface.points[3 * ivertex + d] = strtod(p, &last);
+               valid = valid && last != p;
+               p = last;
+            }
+            ++ivertex;
+            return;
+         }
+         face_offsets[iface] = icorner;
+         counts[iface] = countCorners(p, eol);
+         for (size_t ic = 0; ic < counts[iface]; ++ic) {
+            char* last;
+            const long index = strtol(p, &last, 10);
+            valid = valid && last != p && index != 0;
+            // Negative indices count back from the last vertex defined so far
+            corners[icorner++] = index > 0 ? index - 1 : static_cast<long>(ivertex) + index;
+            // Texture and normal indices are skipped
+            p = last;
+            while (p < eol && !isSpace(*p))
+               ++p;
+         }
+         ++iface;
+      });
+   }
+   if (!valid)
+      throw runtime_error("Malformed vertex or face in " + file.path());
+   triangulateFans(counts, [&](size_t i, size_t ic) { return corners[face_offsets[i] + ic]; }, surface.triangles);
+   return surface;
+}
+
+static Surface readStl(const MappedFile& file)
+{
+   constexpr size_t header_size = 84;
+   constexpr size_t triangle_size = 50;
+   uint32_t ntriangles = 0;
+   if (file.size() >= header_size)
+      memcpy(&ntriangles, file.data() + 80, sizeof(ntriangles));
+   if (file.size() < header_size || file.size() != header_size + triangle_size * ntriangles) {
+      if (file.size() >= 5 && strncmp(file.data(), "solid", 5) == 0)
+         throw runtime_error("ASCII STL files are not supported, " + file.path() + " has to be binary");
+      throw runtime_error(file.path() + " is not a binary STL file");
+   }
+
+   // Every triangle has its own points, which are merged by the welding
+   Surface surface;
+   surface.points.resize(9 * ntriangles);
+   surface.triangles.resize(3 * ntriangles);
+#pragma omp parallel for
+   for (long i = 0; i < (long) ntriangles; ++i) {
+      float coordinates[9];
+      // The normal in front is recomputed from the orientation anyway
+      memcpy(coordinates, file.data() + header_size + triangle_size * i + 3 * sizeof(float), sizeof(coordinates));
+      for (size_t c = 0; c < 9; ++c)
+         surface.points[9 * i + c] = coordinates[c];
+      for (size_t iv = 0; iv < 3; ++iv)
+         surface.triangles[3 * i + iv] = 3 * i + iv;
+   }
+   return surface;
+}
+
+struct CellHash
+{
+   size_t operator()(const array<int64_t, 3>& cell) const noexcept
+   {
+      return (cell[0] * 73856093) ^ (cell[1] * 19349663) ^ (cell[2] * 83492791);
+   }
+};
+
+/**
+ * Merges the points closer than the tolerance with each other and with the points already in the point list. The
+ * points are hashed by their cell in a grid with the tolerance as spacing, so only the points of the neighbouring
+ * cells are compared. Without tolerance the cell is the point itself.
+ *
+ * @return The ID in the point list of every point
+ */
+static vector<ID> weld(vector<double>& point_list, const vector<double>& points, double tolerance)
+{
+   const auto cell = [tolerance](const double* p) {
+      array<int64_t, 3> c{};
+      for (uint d = 0; d < 3; ++d) {
+         if (tolerance > 0.0) {
+            c[d] = static_cast<int64_t>(floor(p[d] / tolerance));
+         } else {
+            const double value = p[d] == 0.0 ? 0.0 : p[d];
+            memcpy(&c[d], &value, sizeof(value));
+         }
+      }
+      return c;
+   };
+   // The points of a cell are chained through next, starting with the last one added
+   unordered_map<array<int64_t, 3>, ID, CellHash> heads;
+   vector<ID> next;
+   heads.reserve(point_list.size() / 3 + points.size() / 3);
+   const auto add = [&](ID vid) {
+      const auto [it, inserted] = heads.emplace(cell(&point_list[3 * vid]), vid);
+      next.push_back(inserted ? -1 : it->second);
+      it->second = vid;
+   };
+   const auto lookup = [&](const double* p) -> ID {
+      const array<int64_t, 3> c = cell(p);
+      const int64_t r = tolerance > 0.0 ? 1 : 0;
+      for (int64_t dx = -r; dx <= r; ++dx) {
+         for (int64_t dy = -r; dy <= r; ++dy) {
+            for (int64_t dz = -r; dz <= r; ++dz) {
+               const auto it = heads.find({c[0] + dx, c[1] + dy, c[2] + dz});
+               if (it == heads.end())
+                  continue;
+               for (ID vid = it->second; vid >= 0; vid = next[vid]) {
+                  const double* q = &point_list[3 * vid];
+                  const double dist2 = (p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1])
+                                       + (p[2] - q[2]) * (p[2] - q[2]);
+                  if (dist2 <= tolerance * tolerance)
+                     return vid;
+               }
+            }
+         }
+      }
+      return -1;
+   };
+
+   for (size_t vid = 0; vid < point_list.size() / 3; ++vid)
+      add(vid);
+   vector<ID> ids(points.size() / 3);
+   for (size_t i = 0; i < ids.size(); ++i) {
+      ID vid = lookup(&points[3 * i]);
+      if (vid < 0) {
+         vid = point_list.size() / 3;
+         point_list.insert(point_list.end(), points.begin() + 3 * i, points.begin() + 3 * (i + 1));
+         add(vid);
+      }
+      ids[i] = vid;
+   }
+   return ids;
+}
+
+size_t readSurface(const string& path, Mesh<3, 2>* mesh, double weld_tolerance)
+{
+   string extension = filesystem::path(path).extension().string();
+   transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return tolower(c); });
+   const MappedFile file(path);
+   Surface surface;
+   if (extension == ".ply")
+      surface = readPly(file);
+   else if (extension == ".obj")
+      surface = readObj(file);
+   else if (extension == ".stl")
+      surface = readStl(file);
+   else
+      throw logic_error("Unknown surface file extension '" + extension + "'");
+
+   const size_t npoints = surface.points.size() / 3;
+   for (const ID vid : surface.triangles)
+      if (vid < 0 || static_cast<size_t>(vid) >= npoints)
+         throw runtime_error(path + " refers to a point, which does not exist");
+
+   vector<double>& point_list = mesh->getPointList();
+   const ID nold = point_list.size() / 3;
+   const vector<ID> ids = weld(point_list, surface.points, weld_tolerance);
+
+   // Collapsed triangles are dropped, of repeated ones the first is kept
+   const size_t ntriangles = surface.triangles.size() / 3;
+   vector<pair<array<ID, 3>, size_t>> keys;
+   keys.reserve(ntriangles);
+   for (size_t i = 0; i < ntriangles; ++i) {
+      array<ID, 3> key{ids[surface.triangles[3 * i]], ids[surface.triangles[3 * i + 1]],
+                       ids[surface.triangles[3 * i + 2]]};
+      sort(key.begin(), key.end());
+      if (key[0] != key[1] && key[1] != key[2])
+         keys.emplace_back(key, i);
+   }
+   sort(keys.begin(), keys.end());
+   keys.erase(unique(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first == b.first; }),
+              keys.end());
+   vector<size_t> kept(keys.size());
+   transform(keys.begin(), keys.end(), kept.begin(), [](const auto& key) { return key.second; });
+   sort(kept.begin(), kept.end());
+
+   // Simplices on new points cannot exist yet and are appended, the others are looked up
+   vector<bool> used(point_list.size() / 3, false);
+   vector<ID> appended;
+   for (const size_t i : kept) {
+      const ID triangle[3] = {ids[surface.triangles[3 * i]], ids[surface.triangles[3 * i + 1]],
+                              ids[surface.triangles[3 * i + 2]]};
+      for (const ID vid : triangle)
+         used[vid] = true;
+      if (min({triangle[0], triangle[1], triangle[2]}) >= nold)
+         appended.insert(appended.end(), triangle, triangle + 3);
+      else
+         mesh->faces().create({triangle[0], triangle[1], triangle[2]});
+   }
+   for (ID vid = 0; vid < nold; ++vid)
+      if (used[vid])
+         mesh->vertices().create({vid});
+   vector<ID> new_vertices(point_list.size() / 3 - nold);
+   iota(new_vertices.begin(), new_vertices.end(), nold);
+   mesh->vertices().append(new_vertices.data(), new_vertices.size());
+   mesh->faces().append(appended.data(), appended.size() / 3);
+   return kept.size();
+}
+
+}
@@ -2,9 +2,24 @@
 // Created by klaus on 2019-11-11.
 //
 
+#include <algorithm>
+#include <cstring>
 #include <numeric>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <filesystem>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#define omp_get_max_threads() 1
+#endif
 
 #include "system.h"
+#include "mappedfile.h"
 
 #define VOID void
 #define REAL double
@@ -79,13 +94,16 @@ Segment<Dim, TopDim>* System<Dim, TopDim>::segment(const string& name)
 template<uint Dim, uint TopDim>
 SegmentBase* System<Dim, TopDim>::segment(const string& name) const
 {
-   return segment(name);
+   const auto it = find(segment_names.begin(), segment_names.end(), name);
+   if (it != segment_names.end())
+      return segments[distance(segment_names.begin(), it)].get();
+   return nullptr;
 }
 
 template<uint Dim, uint TopDim>
 Segment<Dim, TopDim>* System<Dim, TopDim>::segment(ID id)
 {
-   if (id < segments.size())
+   if (id >= 0 && static_cast<size_t>(id) < segments.size())
       return segments[id].get();
    return nullptr;
 }
@@ -93,7 +111,9 @@ Segment<Dim, TopDim>* System<Dim, TopDim>::segment(ID id)
 template<uint Dim, uint TopDim>
 SegmentBase* System<Dim, TopDim>::segment(ID id) const
 {
-   return segment(id);
+   if (id >= 0 && static_cast<size_t>(id) < segments.size())
+      return segments[id].get();
+   return nullptr;
 }
 
 template<uint Dim, uint TopDim>
@@ -111,7 +131,19 @@ Interface<Dim, TopDim>* System<Dim, TopDim>::interface(const string& seg1_name,c
 template<uint Dim, uint TopDim>
 SegmentBase* System<Dim, TopDim>::interface(const string& seg1_name,const string& seg2_name) const
 {
-   return interface(seg1_name, seg2_name);
+   const SegmentBase* seg1 = segment(seg1_name);
+   const SegmentBase* seg2 = segment(seg2_name);
+   if (seg1 == nullptr || seg2 == nullptr)
+      return nullptr;
+   return interface(seg1->getID(), seg2->getID());
+}
+
+template<uint Dim, uint TopDim>
+SegmentBase* System<Dim, TopDim>::interface(ID index) const
+{
+   if (index >= 0 && size_t(index) < interfaces.size())
+      return interfaces[index].get();
+   return nullptr;
 }
 
 template<uint Dim, uint TopDim>
@@ -126,6 +158,8 @@ Interface<Dim, TopDim>* System<Dim, TopDim>::interface(ID seg1_id, ID seg2_id)
    inthash2idx[key] = idx;
    interfaces.emplace_back(make_unique<Interface<Dim, TopDim>>(mesh(), idx, segment_names[seg1_id] + "_" + segment_names[seg2_id]));
    Interface<Dim, TopDim>* intf = interfaces.back().get();
+   intf->seg1 = segment(seg1_id);
+   intf->seg2 = segment(seg2_id);
    for (size_t iseg = 0; iseg < segments.size(); ++iseg) {
       if (segments[iseg]->getID() == seg1_id || segments[iseg]->getID() == seg2_id)
          segments[iseg]->_interfaces.push_back(intf);
@@ -136,7 +170,71 @@ Interface<Dim, TopDim>* System<Dim, TopDim>::interface(ID seg1_id, ID seg2_id)
 template<uint Dim, uint TopDim>
 SegmentBase* System<Dim, TopDim>::interface(ID seg1_id, ID seg2_id) const
 {
-   return interface(seg1_id, seg2_id);
+   // Interfaces are not created on demand for const systems
+   SimplexHash<1> hash;
+   const auto it = inthash2idx.find(hash(seg1_id, seg2_id));
+   if (it != inthash2idx.end())
+      return interfaces[it->second].get();
+   return nullptr;
+}
+
+size_t countEntities(const SystemBase* system, StorageLocation location)
+{
+   if (system == nullptr)
+      return 0;
+   if (location == StorageLocation::SEGMENT)
+      return system->getNumSegments();
+   // The storage locations of simplices are their dimensions
+   MeshBase* mesh = system->mesh();
+   const uint dim = static_cast<uint>(location);
+   if (dim > mesh->getTopologyDimension())
+      throw out_of_range("System has no simplices at the location of the attribute");
+   return mesh->simplices(dim).size();
+}
+
+MeshBase* systemMesh(const SystemBase* system)
+{
+   return system != nullptr ? system->mesh() : nullptr;
+}
+
+template<uint Dim, uint TopDim>
+const AttributeBase* System<Dim, TopDim>::getAttribute(const string& name) const
+{
+   const auto it = attributes.find(name);
+   if (it == attributes.end())
+      throw out_of_range("No attribute named " + name);
+   return it->second.get();
+}
+
+template<uint Dim, uint TopDim>
+AttributeBase* System<Dim, TopDim>::getAttribute(const string& name)
+{
+   const auto it = attributes.find(name);
+   if (it == attributes.end())
+      throw out_of_range("No attribute named " + name);
+   return it->second.get();
+}
+
+template<uint Dim, uint TopDim>
+vector<string> System<Dim, TopDim>::getAttributeNames() const
+{
+   vector<string> names;
+   for (const auto& attribute : attributes)
+      names.push_back(attribute.first);
+   sort(names.begin(), names.end());
+   return names;
+}
+
+template<uint Dim, uint TopDim>
+size_t System<Dim, TopDim>::getNumSegments() const noexcept
+{
+   return segments.size();
+}
+
+template<uint Dim, uint TopDim>
+size_t System<Dim, TopDim>::getNumInterfaces() const noexcept
+{
+   return interfaces.size();
 }
 
 template<uint Dim, uint TopDim>
@@ -157,14 +255,161 @@ Mesh<Dim, TopDim - 1>* System<Dim, TopDim>::Factory::segment(const std::string&
 {
    Segment<Dim, TopDim>* seg = system->getOrCreateSegment(name);
    const ID seg_id = seg->getID();
-   if (segment_input_meshes.size() <= seg->getID() || segment_input_meshes[seg_id] == nullptr)
+   if (segment_input_meshes.size() <= static_cast<size_t>(seg_id) || segment_input_meshes[seg_id] == nullptr)
       segment_input_meshes.emplace(segment_input_meshes.begin() + seg_id, make_unique<Mesh<Dim, TopDim - 1>>(system_input_mesh.get()));
    return segment_input_meshes[seg_id].get();
 }
 
+/**
+ * Cache entries start with this header and the key they were created for, followed by the system file.
+ */
+struct CacheEntryHeader
+{
+   char magic[8];
+   uint64_t key_size;
+};
+
+static constexpr char cache_magic[8] = {'P', 'Y', 'M', 'E', 'S', 'H', 'C', 'K'};
+
+/**
+ * @return The system file of the cache entry, which has to be created for the given key
+ */
+static vector<char> readCacheEntry(const string& path, const string& key)
+{
+   const MappedFile file(path);
+   CacheEntryHeader header{};
+   if (file.size() < sizeof(header))
+      throw runtime_error(path + " is not a cache entry");
+   memcpy(&header, file.data(), sizeof(header));
+   if (memcmp(header.magic, cache_magic, sizeof(header.magic)) != 0)
+      throw runtime_error(path + " is not a cache entry");
+   if (header.key_size != key.size() || file.size() - sizeof(header) < key.size()
+       || memcmp(file.data() + sizeof(header), key.data(), key.size()) != 0)
+      throw runtime_error(path + " was created for a different input");
+   return vector<char>(file.data() + sizeof(header) + key.size(), file.data() + file.size());
+}
+
 template<uint Dim, uint TopDim>
 //unique_ptr<System<Dim, TopDim>> System<Dim, TopDim>::Factory::create(double area)
-System<Dim, TopDim>* System<Dim, TopDim>::Factory::create(double area)
+System<Dim, TopDim>* System<Dim, TopDim>::Factory::create(double area, bool decompose) const
+{
+   decompose = decompose || !blocks.empty();
+   if (cache_directory.empty())
+      return generate(area, decompose);
+
+   // The entry is found by the hash of the key, but only used if it holds the same key, as hashes can collide
+   const string key = cacheKey(area, decompose);
+   stringstream name;
+   name << hex << setw(16) << setfill('0') << Fnv1aHash()(key.data(), key.size()).value() << ".system";
+   const filesystem::path path = filesystem::path(cache_directory) / name.str();
+   if (filesystem::exists(path)) {
+      try {
+         return System<Dim, TopDim>::read(SystemView(readCacheEntry(path.string(), key))).release();
+      } catch (const exception&) {
+         // An unreadable entry, or one of another input with the same hash, is replaced by a freshly meshed system
+      }
+   }
+
+   unique_ptr<System<Dim, TopDim>> result(generate(area, decompose));
+
+   // Every writer uses its own temporary file, which then atomically replaces the entry. Failing to store
+   // the system only costs a remeshing next time.
+   stringstream tmp_name;
+   tmp_name << name.str() << '.' << getpid() << '.' << this_thread::get_id() << ".tmp";
+   const filesystem::path tmp = filesystem::path(cache_directory) / tmp_name.str();
+   error_code ec;
+   filesystem::create_directories(cache_directory, ec);
+   bool written;
+   {
+      ofstream out(tmp, ios::binary);
+      CacheEntryHeader header{};
+      memcpy(header.magic, cache_magic, sizeof(header.magic));
+      header.key_size = key.size();
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(key.data(), key.size());
+      result->write(out);
+      written = static_cast<bool>(out);
+   }
+   if (written)
+      filesystem::rename(tmp, path, ec);
+   if (!written || ec)
+      filesystem::remove(tmp, ec);
+   return result.release();
+}
+
+template<uint Dim, uint TopDim>
+void System<Dim, TopDim>::Factory::setCacheDirectory(const string& directory)
+{
+   cache_directory = directory;
+}
+
+template<uint Dim, uint TopDim>
+string System<Dim, TopDim>::Factory::cacheKey(double area, bool decompose) const
+{
+   // Has to be increased whenever the generated systems for the same input change
+   static constexpr uint32_t cache_version = 4;
+
+   ByteKey key;
+   key(cache_version)(Dim)(TopDim)(area)(decompose);
+   key(system_input_mesh->getPointList());
+   for (size_t iseg = 0; iseg < segment_input_meshes.size(); ++iseg) {
+      key(system->segments[iseg]->getName());
+      MeshElementsProxy& elements = segment_input_meshes[iseg]->bodies();
+      key(elements.size());
+      for (const auto& element : elements)
+         for (size_t iv = 0; iv < element.getNumVertices(); ++iv)
+            key(element[iv]);
+   }
+   for (const auto& block : blocks)
+      key(block.segment)(block.lower)(block.upper)(block.divisions)(block.grading);
+   return key.value();
+}
+
+template<uint Dim, uint TopDim>
+vector<System<Dim, TopDim>*> System<Dim, TopDim>::Factory::createBatch(const vector<const Factory*>& factories,
+                                                                      const vector<double>& areas,
+                                                                      bool decompose, int nthreads)
+{
+   if (areas.size() != 1 && areas.size() != factories.size())
+      throw logic_error("Either one area or one area per factory has to be given");
+   if (nthreads <= 0)
+      nthreads = omp_get_max_threads();
+   vector<unique_ptr<System<Dim, TopDim>>> systems(factories.size());
+   // The factories are meshed side by side, runTriangle only serialises Triangle if it is not reentrant
+   exception_ptr error = nullptr;
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+   for (long i = 0; i < (long) factories.size(); ++i) {
+      try {
+         const double area = areas.size() == 1 ? areas[0] : areas[i];
+         systems[i].reset(factories[i]->create(area, decompose));
+      } catch (...) {
+#pragma omp critical
+         error = current_exception();
+      }
+   }
+   if (error)
+      rethrow_exception(error);
+   vector<System<Dim, TopDim>*> result;
+   result.reserve(systems.size());
+   for (auto& system : systems)
+      result.push_back(system.release());
+   return result;
+}
+
+template<uint Dim, uint TopDim>
+System<Dim, TopDim>* System<Dim, TopDim>::Factory::generate(double area, bool decompose) const
+{
+   if constexpr (Dim == TopDim && (Dim == 2 || Dim == 3)) {
+      if (decompose)
+         return generateDecomposed(area);
+   } else if (decompose) {
+      throw logic_error("Only 2D and 3D systems can be meshed decomposed");
+   }
+   return generate(area);
+}
+
+template<uint Dim, uint TopDim>
+System<Dim, TopDim>* System<Dim, TopDim>::Factory::generate([[maybe_unused]] double area) const
 {
    throw runtime_error("Not yet implemented");
 }
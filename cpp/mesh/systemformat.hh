@@ -0,0 +1,87 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_SYSTEMFORMAT_HH
+#define PYULB_SYSTEMFORMAT_HH
+
+#include <cstdint>
+
+/*
+ * Binary system file layout, in native byte order:
+ *
+ *   FileHeader
+ *   SectionEntry[nsections]
+ *   sections, every one starting at a multiple of section_alignment
+ *
+ * Sections holding arrays contain nothing but the flat array, so they can be used in place when the file is mapped
+ * into memory. Segment and interface simplices are stored as IDs of the root mesh simplices.
+ */
+
+namespace mesh
+{
+namespace format
+{
+
+constexpr char magic[8] = {'P', 'Y', 'M', 'E', 'S', 'H', 'S', 'Y'};
+constexpr uint32_t version = 2;
+constexpr uint32_t byte_order_mark = 0x01020304;
+constexpr uint64_t section_alignment = 64;
+
+enum SectionKind : uint32_t
+{
+   // double[npoints * dim], index 0 for the mesh, 1 for the voronoi diagram
+   COORDINATES = 1,
+   // ID[nsimplices * (dim + 1)], index as for the coordinates
+   CONNECTIVITY = 2,
+   // uint64 count, uint64 offsets[count + 1], chars
+   SEGMENT_NAMES = 3,
+   // ID[nsimplices], index of the segment
+   SEGMENT_SIMPLICES = 4,
+   // ID[ninterfaces * 2], the segment IDs of every interface
+   INTERFACE_SEGMENTS = 5,
+   // ID[nsimplices], index of the interface
+   INTERFACE_SIMPLICES = 6,
+   // AttributeHeader, uint64 extents[ndims], name, padding up to data_offset, values
+   ATTRIBUTE = 7
+};
+
+struct FileHeader
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t byte_order;
+   uint32_t dim;
+   uint32_t topdim;
+   uint64_t nsections;
+   uint64_t reserved[4];
+};
+
+struct SectionEntry
+{
+   uint32_t kind;
+   uint32_t dim;
+   uint64_t index;
+   uint64_t offset;
+   uint64_t size;
+};
+
+struct AttributeHeader
+{
+   uint32_t location;
+   uint32_t type;
+   uint32_t ndims;
+   uint32_t name_length;
+   uint64_t data_offset;
+   uint64_t size;
+};
+
+constexpr uint64_t align(uint64_t offset)
+{
+   return (offset + section_alignment - 1) / section_alignment * section_alignment;
+}
+
+}
+}
+
+#endif //PYULB_SYSTEMFORMAT_HH
@@ -0,0 +1,186 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <cstring>
+#include <stdexcept>
+
+#include "systemview.h"
+#include "mappedfile.h"
+#include "sharedmemory.h"
+#include "systemformat.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+template<typename T>
+static ArrayView<T> arrayView(const char* data, const format::SectionEntry& section)
+{
+   if (section.size % sizeof(T) != 0)
+      throw runtime_error("Corrupt section in system file");
+   return ArrayView<T>(reinterpret_cast<const T*>(data + section.offset), section.size / sizeof(T));
+}
+
+shared_ptr<SystemView> SystemView::open(const string& path)
+{
+   shared_ptr<SystemView> view(new SystemView());
+   view->file = make_unique<MappedFile>(path);
+   view->parse(view->file->data(), view->file->size());
+   return view;
+}
+
+shared_ptr<SystemView> SystemView::attach(const string& name)
+{
+   shared_ptr<SystemView> view(new SystemView());
+   view->shared_memory = SharedMemory::attach(name);
+   view->parse(view->shared_memory->data(), view->shared_memory->size());
+   return view;
+}
+
+SystemView::SystemView(vector<char> buffer) : buffer(move(buffer))
+{
+   parse(this->buffer.data(), this->buffer.size());
+}
+
+SystemView::~SystemView() = default;
+
+void SystemView::parse(const char* data, size_t size)
+{
+   format::FileHeader header{};
+   if (size < sizeof(header))
+      throw runtime_error("Not a system file");
+   memcpy(&header, data, sizeof(header));
+   if (memcmp(header.magic, format::magic, sizeof(format::magic)) != 0)
+      throw runtime_error("Not a system file");
+   if (header.byte_order != format::byte_order_mark)
+      throw runtime_error("System file was written with a different byte order");
+   if (header.version != format::version)
+      throw runtime_error("Unsupported system file version");
+   if (header.dim > 3 || header.topdim > header.dim)
+      throw runtime_error("Corrupt system file header");
+   dim = header.dim;
+   topdim = header.topdim;
+
+   if (header.nsections > (size - sizeof(header)) / sizeof(format::SectionEntry))
+      throw runtime_error("Corrupt system file header");
+   const auto* sections = reinterpret_cast<const format::SectionEntry*>(data + sizeof(header));
+   for (size_t isec = 0; isec < header.nsections; ++isec) {
+      const format::SectionEntry& section = sections[isec];
+      if (section.offset % format::section_alignment != 0 || section.offset > size || section.size > size - section.offset)
+         throw runtime_error("Corrupt section in system file");
+      if (section.dim > 3)
+         throw runtime_error("Corrupt section in system file");
+      switch (section.kind) {
+         case format::COORDINATES:
+            if (section.index > 1)
+               throw runtime_error("Corrupt section in system file");
+            _coordinates[section.index] = arrayView<double>(data, section);
+            break;
+         case format::CONNECTIVITY:
+            if (section.index > 1)
+               throw runtime_error("Corrupt section in system file");
+            _connectivity[section.index][section.dim] = arrayView<ID>(data, section);
+            break;
+         case format::SEGMENT_NAMES: {
+            const auto names = arrayView<uint64_t>(data, section);
+            if (names.size() < 2 || names[0] > names.size() - 2)
+               throw runtime_error("Corrupt segment names in system file");
+            const uint64_t count = names[0];
+            const char* chars = reinterpret_cast<const char*>(names.data() + count + 2);
+            const uint64_t nchars = section.size - (count + 2) * sizeof(uint64_t);
+            for (size_t iseg = 0; iseg < count; ++iseg) {
+               if (names[iseg + 1] > names[iseg + 2] || names[iseg + 2] > nchars)
+                  throw runtime_error("Corrupt segment names in system file");
+               segment_names.emplace_back(chars + names[iseg + 1], chars + names[iseg + 2]);
+            }
+            segment_simplices.resize(count);
+            break;
+         }
+         case format::SEGMENT_SIMPLICES:
+            if (section.index >= segment_simplices.size())
+               throw runtime_error("Corrupt section in system file");
+            segment_simplices[section.index][section.dim] = arrayView<ID>(data, section);
+            break;
+         case format::INTERFACE_SEGMENTS:
+            interface_segments = arrayView<ID>(data, section);
+            interface_simplices.resize(interface_segments.size() / 2);
+            break;
+         case format::INTERFACE_SIMPLICES:
+            if (section.index >= interface_simplices.size())
+               throw runtime_error("Corrupt section in system file");
+            interface_simplices[section.index][section.dim] = arrayView<ID>(data, section);
+            break;
+         case format::ATTRIBUTE: {
+            format::AttributeHeader attr{};
+            if (section.size < sizeof(attr))
+               throw runtime_error("Corrupt attribute in system file");
+            const char* begin = data + section.offset;
+            memcpy(&attr, begin, sizeof(attr));
+            if (attr.type < static_cast<uint32_t>(ScalarType::FLOAT64) || attr.type > static_cast<uint32_t>(ScalarType::UINT8)
+                || attr.ndims > 64)
+               throw runtime_error("Corrupt attribute in system file");
+            const uint64_t meta_size = sizeof(attr) + attr.ndims * sizeof(uint64_t) + attr.name_length;
+            const auto type = static_cast<ScalarType>(attr.type);
+            if (attr.location > StorageLocation::SEGMENT || meta_size > attr.data_offset
+                || attr.data_offset > section.size || attr.size > (section.size - attr.data_offset) / scalarSize(type))
+               throw runtime_error("Corrupt attribute in system file");
+            const auto* extents = reinterpret_cast<const uint64_t*>(begin + sizeof(attr));
+            const char* name = begin + sizeof(attr) + attr.ndims * sizeof(uint64_t);
+            _attributes.push_back({string(name, attr.name_length), static_cast<StorageLocation>(attr.location), type,
+                                   vector<size_t>(extents, extents + attr.ndims), begin + attr.data_offset, attr.size});
+            break;
+         }
+         default:
+            // Sections of newer writers are skipped
+            break;
+      }
+   }
+}
+
+ArrayView<double> SystemView::coordinates(bool voronoi) const
+{
+   return _coordinates[voronoi ? 1 : 0];
+}
+
+ArrayView<ID> SystemView::connectivity(uint simplex_dim, bool voronoi) const
+{
+   if (simplex_dim > topdim)
+      throw out_of_range("Simplex dimension exceeds the topological dimension of the system");
+   return _connectivity[voronoi ? 1 : 0][simplex_dim];
+}
+
+const string& SystemView::segmentName(size_t iseg) const
+{
+   if (iseg >= segment_names.size())
+      throw out_of_range("Segment index out of range");
+   return segment_names[iseg];
+}
+
+ArrayView<ID> SystemView::segmentSimplices(size_t iseg, uint simplex_dim) const
+{
+   if (iseg >= segment_simplices.size())
+      throw out_of_range("Segment index out of range");
+   if (simplex_dim > topdim)
+      throw out_of_range("Simplex dimension exceeds the topological dimension of the system");
+   return segment_simplices[iseg][simplex_dim];
+}
+
+pair<ID, ID> SystemView::interfaceSegments(size_t iint) const
+{
+   if (iint >= interface_simplices.size())
+      throw out_of_range("Interface index out of range");
+   return make_pair(interface_segments[2 * iint], interface_segments[2 * iint + 1]);
+}
+
+ArrayView<ID> SystemView::interfaceSimplices(size_t iint, uint simplex_dim) const
+{
+   if (iint >= interface_simplices.size())
+      throw out_of_range("Interface index out of range");
+   if (simplex_dim >= topdim)
+      throw out_of_range("Simplex dimension exceeds the topological dimension of the interfaces");
+   return interface_simplices[iint][simplex_dim];
+}
+
+}
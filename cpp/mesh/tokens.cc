@@ -0,0 +1,81 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <algorithm>
+#include <numeric>
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#define omp_get_max_threads() 1
+#endif
+
+#include "tokens.hh"
+
+using namespace std;
+
+namespace mesh
+{
+
+/**
+ * Calls visit with the offset of every token in [first, last), which has to begin at a line start.
+ */
+template<typename Visitor>
+static void scanTokens(const char* begin, size_t first, size_t last, char comment, Visitor&& visit)
+{
+   bool in_comment = false;
+   bool in_token = false;
+   for (size_t i = first; i < last; ++i) {
+      const char c = begin[i];
+      if (in_comment) {
+         in_comment = c != '\n';
+      } else if (comment != '\0' && c == comment) {
+         in_comment = true;
+         in_token = false;
+      } else if (isSpace(c)) {
+         in_token = false;
+      } else if (!in_token) {
+         in_token = true;
+         visit(i);
+      }
+   }
+}
+
+vector<size_t> lineBlocks(const char* begin, const char* end)
+{
+   const size_t size = end - begin;
+   // Small texts are not worth the threads
+   const size_t nblocks = max<size_t>(1, min<size_t>(omp_get_max_threads(), size >> 16));
+   vector<size_t> bounds(nblocks + 1, size);
+   bounds[0] = 0;
+   for (size_t iblock = 1; iblock < nblocks; ++iblock) {
+      size_t pos = max(bounds[iblock - 1], size / nblocks * iblock);
+      while (pos < size && begin[pos - 1] != '\n')
+         ++pos;
+      bounds[iblock] = pos;
+   }
+   return bounds;
+}
+
+vector<size_t> tokenise(const char* begin, const char* end, char comment)
+{
+   const vector<size_t> bounds = lineBlocks(begin, end);
+   const size_t nblocks = bounds.size() - 1;
+
+   vector<size_t> counts(nblocks + 1, 0);
+#pragma omp parallel for
+   for (long iblock = 0; iblock < (long) nblocks; ++iblock)
+      scanTokens(begin, bounds[iblock], bounds[iblock + 1], comment, [&](size_t) { ++counts[iblock + 1]; });
+   partial_sum(counts.begin(), counts.end(), counts.begin());
+
+   vector<size_t> tokens(counts[nblocks]);
+#pragma omp parallel for
+   for (long iblock = 0; iblock < (long) nblocks; ++iblock) {
+      size_t itoken = counts[iblock];
+      scanTokens(begin, bounds[iblock], bounds[iblock + 1], comment, [&](size_t pos) { tokens[itoken++] = pos; });
+   }
+   return tokens;
+}
+
+}
@@ -0,0 +1,58 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#ifndef PYULB_TOKENS_HH
+#define PYULB_TOKENS_HH
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace mesh
+{
+
+inline bool isSpace(char c) noexcept
+{
+   return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/**
+ * Splits a text into one block of whole lines per thread, small texts into a single block.
+ *
+ * @return The offsets of the block bounds from begin, the last one is the size of the text
+ */
+std::vector<std::size_t> lineBlocks(const char* begin, const char* end);
+
+/**
+ * Finds the whitespace separated tokens of a text. The text is split into blocks of whole lines, which are scanned
+ * on all threads, first counting and then recording the tokens.
+ *
+ * @param comment Character starting a comment up to the end of the line, none if 0
+ * @return The offsets of the tokens from begin
+ */
+std::vector<std::size_t> tokenise(const char* begin, const char* end, char comment = '\0');
+
+/**
+ * Parses a number from a token, which has to be followed by whitespace or the end of the text.
+ */
+template<typename T>
+T parseToken(const char* token, const char* end)
+{
+   char* last = nullptr;
+   T value;
+   if constexpr (std::is_floating_point_v<T>)
+      value = std::strtod(token, &last);
+   else
+      value = static_cast<T>(std::strtoll(token, &last, 10));
+   if (last == token || (last != end && !isSpace(*last)))
+      throw std::runtime_error("Malformed number '" + std::string(token, std::min<std::size_t>(end - token, 32))
+                               + "'");
+   return value;
+}
+
+}
+
+#endif //PYULB_TOKENS_HH
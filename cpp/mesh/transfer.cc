@@ -0,0 +1,318 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <array>
+#include <cmath>
+#include <numeric>
+
+#include "transfer.h"
+#include "locator.hh"
+#include "system.h"
+
+using namespace std;
+
+namespace mesh
+{
+
+/**
+ * @return The points of the entities at the location, the coordinates for vertices and the centroids otherwise
+ */
+static const double* entityPoints(MeshBase* mesh, StorageLocation location, vector<double>& centroids)
+{
+   const uint dim = mesh->getDimension();
+   const auto sdim = static_cast<uint>(location);
+   if (sdim == 0)
+      return mesh->getPointList().data();
+   const vector<ID>& connectivity = mesh->simplices(sdim).connectivity();
+   const vector<double>& points = mesh->getPointList();
+   const size_t n = mesh->simplices(sdim).size();
+   centroids.assign(n * dim, 0.0);
+#pragma omp parallel for
+   for (size_t i = 0; i < n; ++i)
+      for (uint j = 0; j <= sdim; ++j)
+         for (uint d = 0; d < dim; ++d)
+            centroids[i * dim + d] += points[connectivity[i * (sdim + 1) + j] * dim + d] / (sdim + 1);
+   return centroids.data();
+}
+
+static TransferOperator interpolationOperator(const PointLocator& locator, MeshBase* source, MeshBase* target,
+                                              StorageLocation from, StorageLocation to)
+{
+   const uint dim = locator.getDimension();
+   const bool vertex_values = from == StorageLocation::VERTEX;
+   if (!vertex_values && static_cast<uint>(from) != dim)
+      throw logic_error("Only vertex and cell values can be interpolated between meshes");
+   vector<double> centroids;
+   const double* points = entityPoints(target, to, centroids);
+   const size_t n = target->simplices(to).size();
+   const size_t width = vertex_values ? dim + 1 : 1;
+   vector<ID> columns(n * width);
+   vector<double> weights(n * width);
+   bool located = true;
+#pragma omp parallel for reduction(&&:located)
+   for (size_t i = 0; i < n; ++i) {
+      array<double, 4> lambda{};
+      const ID cell = locator.locate(points + i * dim, lambda.data());
+      located = located && cell >= 0;
+      if (cell < 0)
+         continue;
+      if (vertex_values) {
+         copy_n(locator.cell(cell), dim + 1, columns.begin() + i * width);
+         copy_n(lambda.begin(), dim + 1, weights.begin() + i * width);
+      } else {
+         columns[i] = cell;
+         weights[i] = 1.0;
+      }
+   }
+   if (!located)
+      throw runtime_error("Source mesh has no cells");
+   vector<Eigen::Triplet<double>> triplets;
+   triplets.reserve(columns.size());
+   for (size_t i = 0; i < columns.size(); ++i)
+      triplets.emplace_back(i / width, columns[i], weights[i]);
+   TransferOperator op(n, source->simplices(from).size());
+   op.setFromTriplets(triplets.begin(), triplets.end());
+   return op;
+}
+
+/**
+ * @return Barycentric coordinates of the centroids of the upright sub-simplices of a regular subdivision of a simplex
+ * into samples parts along every edge, which are spread evenly over it
+ */
+static vector<array<double, 4>> samplePoints(uint dim, uint samples)
+{
+   vector<array<double, 4>> result;
+   array<uint, 4> index{};
+   const uint n = dim + 1;
+   // All indices of n digits from 0 to samples - 1, which sum up to samples - 1
+   while (true) {
+      uint sum = 0;
+      for (uint j = 0; j < n; ++j)
+         sum += index[j];
+      if (sum == samples - 1) {
+         array<double, 4> lambda{};
+         for (uint j = 0; j < n; ++j)
+            lambda[j] = (index[j] + 1.0 / n) / samples;
+         result.push_back(lambda);
+      }
+      uint j = 0;
+      while (j < n && ++index[j] == samples)
+         index[j++] = 0;
+      if (j == n)
+         break;
+   }
+   return result;
+}
+
+/**
+ * Locates the sample points of every cell of a mesh in the cells of the mesh of the locator.
+ *
+ * @return The cells containing the samples, the ones of every cell one after the other
+ */
+static vector<ID> locateSamples(const PointLocator& locator, MeshBase* mesh, const vector<array<double, 4>>& lambdas)
+{
+   const uint dim = locator.getDimension();
+   const vector<ID>& cells = mesh->simplices(dim).connectivity();
+   const vector<double>& points = mesh->getPointList();
+   const size_t ncells = mesh->simplices(dim).size();
+   const size_t nsamples = lambdas.size();
+   vector<ID> hits(ncells * nsamples);
+   bool located = true;
+#pragma omp parallel for reduction(&&:located)
+   for (size_t c = 0; c < ncells; ++c) {
+      for (size_t q = 0; q < nsamples; ++q) {
+         array<double, 3> x{};
+         for (uint j = 0; j <= dim; ++j)
+            for (uint d = 0; d < dim; ++d)
+               x[d] += lambdas[q][j] * points[cells[c * (dim + 1) + j] * dim + d];
+         array<double, 4> lambda{};
+         hits[c * nsamples + q] = locator.locate(x.data(), lambda.data());
+         located = located && hits[c * nsamples + q] >= 0;
+      }
+   }
+   if (!located)
+      throw runtime_error("Mesh has no cells to locate the samples in");
+   return hits;
+}
+
+/**
+ * @return Barycentric coordinates of points just inside the centres of all faces of a simplex, its corners, edges
+ * and so on, where the lattice of samplePoints leaves gaps
+ */
+static vector<array<double, 4>> insetPoints(uint dim)
+{
+   constexpr double inset = 1e-3;
+   vector<array<double, 4>> result;
+   // Every face as the bit set of its vertices, all but the simplex itself
+   for (uint face = 1; face + 1 < (1u << (dim + 1)); ++face) {
+      uint nvertices = 0;
+      for (uint k = 0; k <= dim; ++k)
+         nvertices += face >> k & 1u;
+      array<double, 4> lambda{};
+      for (uint k = 0; k <= dim; ++k)
+         lambda[k] = (face >> k & 1u) != 0 ? (1.0 - inset) / nvertices : inset / (dim + 1 - nvertices);
+      result.push_back(lambda);
+   }
+   return result;
+}
+
+static TransferOperator conservativeOperator(const PointLocator& source_locator, const PointLocator& target_locator,
+                                             MeshBase* source, MeshBase* target, uint samples)
+{
+   const uint dim = source_locator.getDimension();
+   const size_t ntarget = target->simplices(dim).size();
+   const size_t nsource = source->simplices(dim).size();
+   const vector<double> target_volumes = simplexMeasures(target, dim);
+   const vector<double> source_volumes = simplexMeasures(source, dim);
+
+   // Estimated overlap of the target and source cells from sampling both, as sampling only one side misses the cells
+   // of the other side which are much smaller. A sample in the cells t and s stands for the volume around it, the
+   // inverse of the density of the samples of both cells there, n / |t| + n / |s|. Thin overlaps along the boundaries
+   // of the cells are seeded with a smaller weight from the inset points, so the balancing below can move volume there.
+   vector<Eigen::Triplet<double>> triplets;
+   const auto sample = [&](const vector<array<double, 4>>& lambdas, double factor) {
+      const size_t n = lambdas.size();
+      const auto weight = [&](size_t t, size_t s) {
+         const double sum = target_volumes[t] + source_volumes[s];
+         return sum > 0.0 ? factor * target_volumes[t] * source_volumes[s] / (n * sum) : 0.0;
+      };
+      const vector<ID> target_hits = locateSamples(source_locator, target, lambdas);
+      for (size_t i = 0; i < target_hits.size(); ++i)
+         triplets.emplace_back(i / n, target_hits[i], weight(i / n, target_hits[i]));
+      const vector<ID> source_hits = locateSamples(target_locator, source, lambdas);
+      for (size_t i = 0; i < source_hits.size(); ++i)
+         triplets.emplace_back(source_hits[i], i / n, weight(source_hits[i], i / n));
+   };
+   sample(samplePoints(dim, samples), 1.0);
+   sample(insetPoints(dim), 0.3);
+   TransferOperator op(ntarget, nsource);
+   op.setFromTriplets(triplets.begin(), triplets.end());
+   op.makeCompressed();
+
+   // The overlaps of a target cell have to add up to its volume and the ones of a source cell to its volume, which
+   // the estimate only does approximately. They are balanced by scaling the rows and columns in turns, the columns
+   // last, so the mass of the source cells is handed over exactly. The volumes of the target cells are scaled to the
+   // total of the source, in case the meshes cover the domain differently.
+   const double total_source = accumulate(source_volumes.begin(), source_volumes.end(), 0.0);
+   const double total_target = accumulate(target_volumes.begin(), target_volumes.end(), 0.0);
+   const double scale = total_target > 0.0 ? total_source / total_target : 1.0;
+   constexpr uint max_iterations = 200;
+   constexpr double tolerance = 1e-12;
+   vector<double> sums(nsource);
+   vector<double> factors(ntarget);
+   for (uint iteration = 1;; ++iteration) {
+      fill(sums.begin(), sums.end(), 0.0);
+      for (Eigen::Index t = 0; t < op.outerSize(); ++t)
+         for (TransferOperator::InnerIterator it(op, t); it; ++it)
+            sums[it.col()] += it.value();
+      double deviation = 0.0;
+#pragma omp parallel for reduction(max:deviation)
+      for (Eigen::Index t = 0; t < op.outerSize(); ++t) {
+         double sum = 0.0;
+         for (TransferOperator::InnerIterator it(op, t); it; ++it) {
+            const double column = sums[it.col()];
+            it.valueRef() = column > 0.0 ? it.value() * source_volumes[it.col()] / column : 0.0;
+            sum += it.value();
+         }
+         factors[t] = sum > 0.0 ? scale * target_volumes[t] / sum : 1.0;
+         deviation = max(deviation, abs(factors[t] - 1.0));
+      }
+      if (deviation < tolerance || iteration == max_iterations)
+         break;
+#pragma omp parallel for
+      for (Eigen::Index t = 0; t < op.outerSize(); ++t)
+         for (TransferOperator::InnerIterator it(op, t); it; ++it)
+            it.valueRef() *= factors[t];
+   }
+
+   // Every target cell receives the mass of its overlaps, divided by its volume
+#pragma omp parallel for
+   for (Eigen::Index t = 0; t < op.outerSize(); ++t)
+      for (TransferOperator::InnerIterator it(op, t); it; ++it)
+         it.valueRef() = target_volumes[t] > 0.0 ? it.value() / target_volumes[t] : 0.0;
+   return op;
+}
+
+AttributeTransfer::AttributeTransfer(SystemBase* source, SystemBase* target, uint samples)
+        : source(source), target(target), samples(max(samples, 1u))
+{
+   if (source == nullptr || target == nullptr)
+      throw invalid_argument("Transfer needs a source and a target system");
+}
+
+AttributeTransfer::~AttributeTransfer() = default;
+
+shared_ptr<const TransferOperator> AttributeTransfer::transferOperator(StorageLocation from, StorageLocation to,
+                                                                       TransferMode mode)
+{
+   if (from == StorageLocation::SEGMENT || to == StorageLocation::SEGMENT)
+      throw logic_error("Segment attributes cannot be transferred between meshes");
+   MeshBase* source_mesh = source->mesh();
+   MeshBase* target_mesh = target->mesh();
+   if (source_mesh->getDimension() != target_mesh->getDimension())
+      throw logic_error("Systems of different dimensions");
+   const auto nfrom = Eigen::Index(source_mesh->simplices(from).size());
+   const auto nto = Eigen::Index(target_mesh->simplices(to).size());
+   auto& op = operators[{from, to, mode}];
+   if (op && op->rows() == nto && op->cols() == nfrom)
+      return op;
+   if (!locator)
+      locator = make_unique<PointLocator>(source_mesh);
+   if (mode == TransferMode::CONSERVATIVE) {
+      const uint dim = locator->getDimension();
+      if (static_cast<uint>(from) != dim || static_cast<uint>(to) != dim)
+         throw logic_error("Conservative transfers map cell values to cell values");
+      if (!target_locator)
+         target_locator = make_unique<PointLocator>(target_mesh);
+      op = make_shared<const TransferOperator>(
+              conservativeOperator(*locator, *target_locator, source_mesh, target_mesh, samples));
+   } else {
+      op = make_shared<const TransferOperator>(
+              interpolationOperator(*locator, source_mesh, target_mesh, from, to));
+   }
+   return op;
+}
+
+/**
+ * Copies the values of an attribute in AoS order into doubles.
+ */
+static vector<double> doubleValues(const AttributeBase& attribute)
+{
+   const size_t n = attribute.getNumEntities() * attribute.getExtents().getSize();
+   vector<double> values(n);
+   if (attribute.getScalarType() == ScalarType::FLOAT64) {
+      attribute.copyTo(values.data());
+   } else {
+      vector<float> floats(n);
+      attribute.copyTo(floats.data());
+      copy(floats.begin(), floats.end(), values.begin());
+   }
+   return values;
+}
+
+void AttributeTransfer::operator()(const AttributeBase& from, AttributeBase& to, TransferMode mode)
+{
+   if (from.getSystem() != source || to.getSystem() != target)
+      throw logic_error("Attributes do not belong to the systems of the transfer");
+   for (const AttributeBase* attribute : {&from, static_cast<const AttributeBase*>(&to)})
+      if (attribute->getScalarType() != ScalarType::FLOAT64 && attribute->getScalarType() != ScalarType::FLOAT32)
+         throw logic_error("Only floating point attributes can be transferred, not " + attribute->getName());
+   const size_t k = to.getExtents().getSize();
+   if (from.getExtents().getSize() != k)
+      throw logic_error("Attributes " + from.getName() + " and " + to.getName() + " have different extents");
+   const auto op = transferOperator(from.getLocation(), to.getLocation(), mode);
+   if (size_t(op->cols()) != from.getNumEntities() || size_t(op->rows()) != to.getNumEntities())
+      throw logic_error("Transfer operator does not match the attributes");
+   using Values = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+   const vector<double> x = doubleValues(from);
+   const Values y = *op * Eigen::Map<const Values>(x.data(), op->cols(), k);
+   if (to.getScalarType() == ScalarType::FLOAT64) {
+      to.assign(y.data(), y.size());
+   } else {
+      const vector<float> floats(y.data(), y.data() + y.size());
+      to.assign(floats.data(), floats.size());
+   }
+}
+
+}
@@ -0,0 +1,360 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+#include "trianglefiles.h"
+#include "mappedfile.h"
+#include "closure.hh"
+#include "tokens.hh"
+
+using namespace std;
+using namespace Eigen;
+
+namespace mesh
+{
+
+/**
+ * Tokens of a mapped Triangle file without its comments, read front to back. The rows of the large tables are only
+ * skipped and converted afterwards on all threads.
+ */
+class TriangleFile
+{
+public:
+   explicit TriangleFile(const string& path)
+      : path(path), file(path), tokens(tokenise(file.data(), file.data() + file.size(), '#'))
+   {}
+
+   template<typename T>
+   T next()
+   {
+      if (position >= tokens.size())
+         throw runtime_error(path + " is truncated");
+      return value<T>(position++, 0);
+   }
+
+   /**
+    * Skips a table of rows with the given number of columns.
+    *
+    * @return The position of the first value
+    */
+   size_t skip(size_t nrows, size_t ncolumns)
+   {
+      if (ncolumns != 0 && nrows > (tokens.size() - position) / ncolumns)
+         throw runtime_error(path + " is truncated");
+      const size_t first = position;
+      position += nrows * ncolumns;
+      return first;
+   }
+
+   template<typename T>
+   T value(size_t first, size_t i) const
+   {
+      return parseToken<T>(file.data() + tokens[first + i], file.data() + file.size());
+   }
+
+   [[nodiscard]]
+   bool atEnd() const noexcept
+   {
+      return position >= tokens.size();
+   }
+
+   const string path;
+
+private:
+   const MappedFile file;
+   const vector<size_t> tokens;
+   size_t position = 0;
+};
+
+static NodeList readNodeSection(TriangleFile& file)
+{
+   NodeList nodes;
+   const auto npoints = file.next<size_t>();
+   nodes.dim = file.next<uint>();
+   nodes.nattributes = file.next<size_t>();
+   const bool has_markers = file.next<int>() != 0;
+   if (npoints == 0)
+      return nodes;
+   if (nodes.dim < 1 || nodes.dim > 3)
+      throw runtime_error(file.path + " has an unsupported dimension");
+
+   const size_t ncolumns = 1 + nodes.dim + nodes.nattributes + (has_markers ? 1 : 0);
+   const size_t first = file.skip(npoints, ncolumns);
+   nodes.first_index = file.value<ID>(first, 0);
+   if (nodes.first_index != 0 && nodes.first_index != 1)
+      throw runtime_error(file.path + " has to number the points from 0 or 1");
+   nodes.coordinates.resize(nodes.dim * npoints);
+   nodes.attributes.resize(nodes.nattributes * npoints);
+   if (has_markers)
+      nodes.markers.resize(npoints);
+   bool consecutive = true;
+#pragma omp parallel for reduction(&&:consecutive)
+   for (long i = 0; i < (long) npoints; ++i) {
+      const size_t row = i * ncolumns;
+      consecutive = consecutive && file.value<ID>(first, row) == nodes.first_index + i;
+      for (uint d = 0; d < nodes.dim; ++d)
+         nodes.coordinates[nodes.dim * i + d] = file.value<double>(first, row + 1 + d);
+      for (size_t ia = 0; ia < nodes.nattributes; ++ia)
+         nodes.attributes[nodes.nattributes * i + ia] = file.value<double>(first, row + 1 + nodes.dim + ia);
+      if (has_markers)
+         nodes.markers[i] = file.value<int>(first, row + ncolumns - 1);
+   }
+   if (!consecutive)
+      throw runtime_error(file.path + " has to number the points consecutively");
+   return nodes;
+}
+
+/**
+ * Reads a table of rows with an index, the vertex indices and the attributes.
+ */
+static ElementList readElementRows(TriangleFile& file, size_t nrows, uint nvertices, size_t nattributes,
+                                   ID first_index)
+{
+   ElementList elements;
+   elements.nvertices = nvertices;
+   elements.nattributes = nattributes;
+   const size_t ncolumns = 1 + nvertices + nattributes;
+   const size_t first = file.skip(nrows, ncolumns);
+   elements.vertices.resize(nvertices * nrows);
+   elements.attributes.resize(nattributes * nrows);
+#pragma omp parallel for
+   for (long i = 0; i < (long) nrows; ++i) {
+      const size_t row = i * ncolumns;
+      for (uint iv = 0; iv < nvertices; ++iv) {
+         const auto vid = file.value<ID>(first, row + 1 + iv);
+         elements.vertices[nvertices * i + iv] = vid == -1 ? -1 : vid - first_index;
+      }
+      for (size_t ia = 0; ia < nattributes; ++ia)
+         elements.attributes[nattributes * i + ia] = file.value<double>(first, row + 1 + nvertices + ia);
+   }
+   return elements;
+}
+
+NodeList readNodes(const string& path)
+{
+   TriangleFile file(path);
+   return readNodeSection(file);
+}
+
+ElementList readElements(const string& path, ID first_index)
+{
+   const string extension = filesystem::path(path).extension().string();
+   TriangleFile file(path);
+   const auto nrows = file.next<size_t>();
+   if (extension == ".ele") {
+      const auto nvertices = file.next<uint>();
+      const auto nattributes = file.next<size_t>();
+      return readElementRows(file, nrows, nvertices, nattributes, first_index);
+   }
+   if (extension == ".neigh") {
+      const auto nneighbours = file.next<uint>();
+      return readElementRows(file, nrows, nneighbours, 0, first_index);
+   }
+   if (extension == ".edge" || extension == ".face") {
+      const size_t nmarkers = file.next<int>() != 0 ? 1 : 0;
+      return readElementRows(file, nrows, extension == ".edge" ? 2 : 3, nmarkers, first_index);
+   }
+   throw logic_error("Unknown element file extension '" + extension + "'");
+}
+
+PolyFile readPoly(const string& path)
+{
+   TriangleFile file(path);
+   PolyFile poly;
+   poly.nodes = readNodeSection(file);
+   if (poly.nodes.coordinates.empty())
+      poly.nodes = readNodes(filesystem::path(path).replace_extension(".node").string());
+   if (poly.nodes.dim != 2)
+      throw runtime_error("Only 2D .poly files are supported");
+
+   const auto nsegments = file.next<size_t>();
+   const size_t nmarkers = file.next<int>() != 0 ? 1 : 0;
+   poly.segments = readElementRows(file, nsegments, 2, nmarkers, poly.nodes.first_index);
+
+   const auto nholes = file.next<size_t>();
+   size_t first = file.skip(nholes, 3);
+   poly.holes.resize(2 * nholes);
+   for (size_t i = 0; i < nholes; ++i)
+      for (uint d = 0; d < 2; ++d)
+         poly.holes[2 * i + d] = file.value<double>(first, 3 * i + 1 + d);
+
+   // The regions are optional
+   if (!file.atEnd()) {
+      const auto nregions = file.next<size_t>();
+      first = file.skip(nregions, 5);
+      poly.regions.resize(4 * nregions);
+      for (size_t i = 0; i < nregions; ++i)
+         for (uint c = 0; c < 4; ++c)
+            poly.regions[4 * i + c] = file.value<double>(first, 5 * i + 1 + c);
+   }
+   return poly;
+}
+
+template<uint Dim, uint TopDim>
+unique_ptr<Mesh<Dim, TopDim>> readTriangleMesh(const string& node_path, const string& element_path)
+{
+   NodeList nodes = readNodes(node_path);
+   if (nodes.dim != Dim)
+      throw runtime_error(node_path + " does not contain points of dimension " + to_string(Dim));
+   const ElementList elements = readElements(element_path, nodes.first_index);
+   if (elements.nvertices < TopDim + 1)
+      throw runtime_error(element_path + " does not contain simplices of dimension " + to_string(TopDim));
+
+   const size_t npoints = nodes.coordinates.size() / Dim;
+   const size_t nelements = elements.vertices.size() / elements.nvertices;
+   vector<ID> cells((TopDim + 1) * nelements);
+   for (size_t i = 0; i < nelements; ++i) {
+      for (uint iv = 0; iv <= TopDim; ++iv) {
+         const ID vid = elements.vertices[elements.nvertices * i + iv];
+         if (vid < 0 || static_cast<size_t>(vid) >= npoints)
+            throw runtime_error(element_path + " refers to a point, which does not exist");
+         cells[(TopDim + 1) * i + iv] = vid;
+      }
+   }
+
+   auto mesh = make_unique<Mesh<Dim, TopDim>>();
+   const Closure closure(cells, TopDim);
+   appendClosure(mesh.get(), Dim, move(nodes.coordinates), cells, closure);
+   return mesh;
+}
+
+/**
+ * Bounded face of a planar straight line graph.
+ */
+struct GraphFace
+{
+   vector<ID> corners;
+   // Indices of the undirected edges along the face
+   vector<size_t> edges;
+   double area;
+};
+
+/**
+ * Traces the faces of a planar straight line graph, keeping every face to the left of its half-edges. The faces
+ * traversed counterclockwise are the bounded ones.
+ */
+static vector<GraphFace> boundedFaces(const vector<double>& points, const vector<pair<ID, ID>>& edges)
+{
+   const size_t npoints = points.size() / 2;
+   // Half-edge 2 * e goes from the first to the second vertex of edge e, 2 * e + 1 back
+   const auto origin = [&](size_t h) { return h % 2 == 0 ? edges[h / 2].first : edges[h / 2].second; };
+   const auto target = [&](size_t h) { return h % 2 == 0 ? edges[h / 2].second : edges[h / 2].first; };
+   const auto angle = [&](size_t h) {
+      const ID a = origin(h), b = target(h);
+      return atan2(points[2 * b + 1] - points[2 * a + 1], points[2 * b] - points[2 * a]);
+   };
+
+   // The outgoing half-edges of every vertex sorted counterclockwise
+   vector<vector<size_t>> outgoing(npoints);
+   for (size_t h = 0; h < 2 * edges.size(); ++h)
+      outgoing[origin(h)].push_back(h);
+   vector<size_t> rank(2 * edges.size());
+   for (auto& hs : outgoing) {
+      sort(hs.begin(), hs.end(), [&](size_t a, size_t b) { return angle(a) < angle(b); });
+      for (size_t i = 0; i < hs.size(); ++i)
+         rank[hs[i]] = i;
+   }
+   // Continues with the half-edge clockwise next to the twin at the target
+   const auto next = [&](size_t h) {
+      const vector<size_t>& hs = outgoing[target(h)];
+      const size_t twin = h ^ 1u;
+      return hs[(rank[twin] + hs.size() - 1) % hs.size()];
+   };
+
+   vector<GraphFace> faces;
+   vector<bool> visited(2 * edges.size(), false);
+   for (size_t start = 0; start < 2 * edges.size(); ++start) {
+      if (visited[start])
+         continue;
+      GraphFace face{{}, {}, 0.0};
+      for (size_t h = start; !visited[h]; h = next(h)) {
+         visited[h] = true;
+         const ID a = origin(h), b = target(h);
+         face.corners.push_back(a);
+         face.edges.push_back(h / 2);
+         face.area += 0.5 * (points[2 * a] * points[2 * b + 1] - points[2 * b] * points[2 * a + 1]);
+      }
+      if (face.area > 0.0)
+         faces.push_back(move(face));
+   }
+   return faces;
+}
+
+void addPoly(System<2, 2>::Factory& factory, const PolyFile& poly)
+{
+   const vector<double>& points = poly.nodes.coordinates;
+   const size_t npoints = points.size() / 2;
+   vector<pair<ID, ID>> edges;
+   for (size_t i = 0; i < poly.segments.vertices.size(); i += 2) {
+      const ID a = poly.segments.vertices[i], b = poly.segments.vertices[i + 1];
+      if (a < 0 || b < 0 || static_cast<size_t>(a) >= npoints || static_cast<size_t>(b) >= npoints)
+         throw runtime_error("Segment of the .poly file refers to a point, which does not exist");
+      if (a != b)
+         edges.emplace_back(min(a, b), max(a, b));
+   }
+   sort(edges.begin(), edges.end());
+   edges.erase(unique(edges.begin(), edges.end()), edges.end());
+   const vector<GraphFace> faces = boundedFaces(points, edges);
+
+   vector<Polygon> polygons;
+   for (const auto& face : faces) {
+      vector<Vector2d> corners;
+      for (const ID vid : face.corners)
+         corners.emplace_back(points[2 * vid], points[2 * vid + 1]);
+      polygons.emplace_back(corners);
+   }
+   // Faces may be nested, a point belongs to the smallest face around it
+   const auto faceAt = [&](double x, double y) {
+      long result = -1;
+      for (size_t iface = 0; iface < faces.size(); ++iface)
+         if (polygons[iface].isInside(Vector2d(x, y)) && (result < 0 || faces[iface].area < faces[result].area))
+            result = iface;
+      return result;
+   };
+   vector<string> names(faces.size());
+   for (size_t iface = 0; iface < faces.size(); ++iface)
+      names[iface] = "face" + to_string(iface);
+   for (size_t i = 0; i < poly.regions.size(); i += 4) {
+      const long iface = faceAt(poly.regions[i], poly.regions[i + 1]);
+      if (iface < 0)
+         continue;
+      stringstream ss;
+      ss << poly.regions[i + 2];
+      names[iface] = ss.str();
+   }
+   for (size_t i = 0; i < poly.holes.size(); i += 2) {
+      const long iface = faceAt(poly.holes[i], poly.holes[i + 1]);
+      if (iface >= 0)
+         names[iface].clear();
+   }
+
+   Mesh<2, 1>* input = factory.mesh();
+   vector<double>& input_points = input->getPointList();
+   const ID offset = input_points.size() / 2;
+   input_points.insert(input_points.end(), points.begin(), points.end());
+   vector<ID> ids(npoints);
+   iota(ids.begin(), ids.end(), offset);
+   input->vertices().append(ids.data(), ids.size());
+   for (size_t iface = 0; iface < faces.size(); ++iface) {
+      if (names[iface].empty())
+         continue;
+      Mesh<2, 1>* seg_mesh = factory.segment(names[iface]);
+      for (const size_t iedge : faces[iface].edges)
+         seg_mesh->edges().create({edges[iedge].first + offset, edges[iedge].second + offset});
+   }
+}
+
+template unique_ptr<Mesh<1, 1>> readTriangleMesh(const string&, const string&);
+template unique_ptr<Mesh<2, 1>> readTriangleMesh(const string&, const string&);
+template unique_ptr<Mesh<2, 2>> readTriangleMesh(const string&, const string&);
+template unique_ptr<Mesh<3, 1>> readTriangleMesh(const string&, const string&);
+template unique_ptr<Mesh<3, 2>> readTriangleMesh(const string&, const string&);
+template unique_ptr<Mesh<3, 3>> readTriangleMesh(const string&, const string&);
+
+}
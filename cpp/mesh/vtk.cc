@@ -0,0 +1,333 @@
+//
+// Created by klaus on 2026-10-19.
+//
+
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef ZLIB_ENABLED
+#include <zlib.h>
+#endif
+
+#include "vtk.h"
+#include "segment.h"
+
+using namespace std;
+
+namespace mesh
+{
+
+/**
+ * Array of the appended data, whose values are generated on demand for any range.
+ */
+struct VtuArray
+{
+   string name;
+   string type;
+   uint ncomponents;
+   size_t nvalues;
+   size_t value_size;
+   // Writes the values [first, first + n) to out
+   function<void(size_t first, size_t n, char* out)> fill;
+   // Compressed blocks, if compression is enabled
+   vector<vector<unsigned char>> blocks;
+
+   [[nodiscard]]
+   size_t bytes() const noexcept
+   {
+      return nvalues * value_size;
+   }
+
+   /**
+    * @return The size of the array in the appended data, including its header
+    */
+   [[nodiscard]]
+   size_t appendedSize(bool compressed) const noexcept
+   {
+      if (!compressed)
+         return sizeof(uint64_t) + bytes();
+      size_t size = (3 + blocks.size()) * sizeof(uint64_t);
+      for (const auto& block : blocks)
+         size += block.size();
+      return size;
+   }
+};
+
+template<typename T, typename Generator>
+static VtuArray makeArray(string name, string type, uint ncomponents, size_t nvalues, Generator generator)
+{
+   return {move(name), move(type), ncomponents, nvalues, sizeof(T), [generator](size_t first, size_t n, char* out) {
+      T* values = reinterpret_cast<T*>(out);
+      for (size_t i = 0; i < n; ++i)
+         values[i] = generator(first + i);
+   }, {}};
+}
+
+static const char* byteOrder()
+{
+   const uint16_t probe = 1;
+   return *reinterpret_cast<const char*>(&probe) == 1 ? "LittleEndian" : "BigEndian";
+}
+
+/**
+ * Compresses all blocks of all arrays, distributed over the threads.
+ */
+static void compress(vector<VtuArray>& arrays, size_t block_size)
+{
+#ifdef ZLIB_ENABLED
+   vector<pair<size_t, size_t>> blocks;
+   for (size_t iarray = 0; iarray < arrays.size(); ++iarray) {
+      VtuArray& array = arrays[iarray];
+      array.blocks.resize((array.bytes() + block_size - 1) / block_size);
+      for (size_t iblock = 0; iblock < array.blocks.size(); ++iblock)
+         blocks.emplace_back(iarray, iblock);
+   }
+   exception_ptr error = nullptr;
+#pragma omp parallel
+   {
+      vector<char> buffer(block_size);
+#pragma omp for schedule(dynamic)
+      for (long i = 0; i < (long) blocks.size(); ++i) {
+         VtuArray& array = arrays[blocks[i].first];
+         const size_t values_per_block = block_size / array.value_size;
+         const size_t first = blocks[i].second * values_per_block;
+         const size_t n = min(values_per_block, array.nvalues - first);
+         array.fill(first, n, buffer.data());
+         uLongf size = compressBound(n * array.value_size);
+         vector<unsigned char>& block = array.blocks[blocks[i].second];
+         block.resize(size);
+         if (compress2(block.data(), &size, reinterpret_cast<const Bytef*>(buffer.data()), n * array.value_size,
+                       Z_DEFAULT_COMPRESSION) != Z_OK) {
+#pragma omp critical
+            error = make_exception_ptr(runtime_error("Compressing VTU data failed"));
+         }
+         block.resize(size);
+      }
+   }
+   if (error)
+      rethrow_exception(error);
+#else
+   throw runtime_error("Compression requires zlib, which was not available at build time");
+#endif
+}
+
+static void writeAppended(ostream& out, const VtuArray& array, bool compressed, size_t block_size)
+{
+   if (compressed) {
+      const size_t last = array.bytes() - (array.blocks.empty() ? 0 : (array.blocks.size() - 1) * block_size);
+      vector<uint64_t> header{array.blocks.size(), block_size, array.blocks.empty() ? 0 : last};
+      for (const auto& block : array.blocks)
+         header.push_back(block.size());
+      out.write(reinterpret_cast<const char*>(header.data()), header.size() * sizeof(uint64_t));
+      for (const auto& block : array.blocks)
+         out.write(reinterpret_cast<const char*>(block.data()), block.size());
+      return;
+   }
+   const uint64_t nbytes = array.bytes();
+   out.write(reinterpret_cast<const char*>(&nbytes), sizeof(nbytes));
+   vector<char> buffer(block_size);
+   const size_t values_per_block = block_size / array.value_size;
+   for (size_t first = 0; first < array.nvalues; first += values_per_block) {
+      const size_t n = min(values_per_block, array.nvalues - first);
+      array.fill(first, n, buffer.data());
+      out.write(buffer.data(), n * array.value_size);
+   }
+}
+
+static void writeDataArray(ostream& out, const VtuArray& array, size_t offset)
+{
+   out << "<DataArray type=\"" << array.type << '"';
+   if (!array.name.empty())
+      out << " Name=\"" << array.name << '"';
+   if (array.ncomponents > 1)
+      out << " NumberOfComponents=\"" << array.ncomponents << '"';
+   out << " format=\"appended\" offset=\"" << offset << "\"/>\n";
+}
+
+/**
+ * Writes a piece with the given points (3 components), cell arrays (connectivity, offsets, types) and cell data.
+ */
+static void writePiece(ostream& out, size_t npoints, size_t ncells, vector<VtuArray> arrays, size_t ncelldata,
+                       const VtuOptions& options)
+{
+   if (options.block_size == 0 || options.block_size % sizeof(uint64_t) != 0)
+      throw logic_error("The block size has to be a positive multiple of 8");
+   if (options.compress)
+      compress(arrays, options.block_size);
+
+   out << "<?xml version=\"1.0\"?>\n";
+   out << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" << byteOrder()
+       << "\" header_type=\"UInt64\"";
+   if (options.compress)
+      out << " compressor=\"vtkZLibDataCompressor\"";
+   out << ">\n<UnstructuredGrid>\n";
+   out << "<Piece NumberOfPoints=\"" << npoints << "\" NumberOfCells=\"" << ncells << "\">\n";
+   vector<size_t> offsets(arrays.size() + 1, 0);
+   for (size_t i = 0; i < arrays.size(); ++i)
+      offsets[i + 1] = offsets[i] + arrays[i].appendedSize(options.compress);
+   out << "<Points>\n";
+   writeDataArray(out, arrays[0], offsets[0]);
+   out << "</Points>\n<Cells>\n";
+   for (size_t i = 1; i < 4; ++i)
+      writeDataArray(out, arrays[i], offsets[i]);
+   out << "</Cells>\n";
+   if (ncelldata > 0) {
+      out << "<CellData>\n";
+      for (size_t i = 4; i < 4 + ncelldata; ++i)
+         writeDataArray(out, arrays[i], offsets[i]);
+      out << "</CellData>\n";
+   }
+   out << "</Piece>\n</UnstructuredGrid>\n<AppendedData encoding=\"raw\">\n_";
+   for (const auto& array : arrays)
+      writeAppended(out, array, options.compress, options.block_size);
+   out << "\n</AppendedData>\n</VTKFile>\n";
+}
+
+/**
+ * Builds the point and cell arrays of a mesh. The vertices are renumbered, unless the mesh contains all points of
+ * the root mesh in order.
+ */
+template<uint Dim, uint TopDim>
+static vector<VtuArray> meshArrays(Mesh<Dim, TopDim>* mesh, size_t& npoints, size_t& ncells)
+{
+   static constexpr uint8_t cell_types[] = {1, 3, 5, 10};
+   const vector<double>& coordinates = mesh->getPointList();
+   MeshElementsProxy& vertices = mesh->simplices(0);
+   MeshElementsProxy& cells = mesh->bodies();
+
+   bool identity = vertices.size() == coordinates.size() / Dim;
+   for (size_t i = 0; i < vertices.size() && identity; ++i)
+      identity = (*vertices[i])[0] == static_cast<ID>(i);
+   auto local2global = make_shared<vector<ID>>();
+   auto global2local = make_shared<vector<ID>>();
+   if (!identity) {
+      global2local->assign(coordinates.size() / Dim, -1);
+      local2global->reserve(vertices.size());
+      for (const auto& vertex : vertices) {
+         (*global2local)[vertex[0]] = local2global->size();
+         local2global->push_back(vertex[0]);
+      }
+   }
+   npoints = identity ? coordinates.size() / Dim : local2global->size();
+   ncells = cells.size();
+
+   vector<VtuArray> arrays;
+   arrays.push_back(makeArray<double>("", "Float64", 3, 3 * npoints, [&coordinates, local2global, identity](size_t i) {
+      const size_t c = i % 3;
+      if (c >= Dim)
+         return 0.0;
+      const size_t vid = identity ? i / 3 : (*local2global)[i / 3];
+      return coordinates[Dim * vid + c];
+   }));
+   arrays.push_back(makeArray<int64_t>("connectivity", "Int64", 1, (TopDim + 1) * ncells,
+                                       [&cells, global2local, identity](size_t i) {
+      const ID vid = (*cells[i / (TopDim + 1)])[i % (TopDim + 1)];
+      return static_cast<int64_t>(identity ? vid : (*global2local)[vid]);
+   }));
+   arrays.push_back(makeArray<int64_t>("offsets", "Int64", 1, ncells, [](size_t i) {
+      return static_cast<int64_t>((i + 1) * (TopDim + 1));
+   }));
+   arrays.push_back(makeArray<uint8_t>("types", "UInt8", 1, ncells, [](size_t) {
+      return cell_types[TopDim];
+   }));
+   return arrays;
+}
+
+template<uint Dim, uint TopDim>
+void writeVtu(ostream& out, Mesh<Dim, TopDim>* mesh, const VtuOptions& options)
+{
+   size_t npoints, ncells;
+   vector<VtuArray> arrays = meshArrays(mesh, npoints, ncells);
+   writePiece(out, npoints, ncells, move(arrays), 0, options);
+}
+
+template<uint Dim, uint TopDim>
+void writeVtu(const string& path, System<Dim, TopDim>* system, const VtuOptions& options)
+{
+   size_t npoints, ncells;
+   vector<VtuArray> arrays = meshArrays(system->mesh(), npoints, ncells);
+   auto cell2segment = make_shared<vector<int32_t>>(ncells, -1);
+   for (size_t iseg = 0; iseg < system->getNumSegments(); ++iseg)
+      for (const auto& cell : system->segment(static_cast<ID>(iseg))->mesh()->bodies())
+         (*cell2segment)[cell.getID()] = iseg;
+   arrays.push_back(makeArray<int32_t>("segment", "Int32", 1, ncells, [cell2segment](size_t i) {
+      return (*cell2segment)[i];
+   }));
+
+   ofstream out(path, ios::binary);
+   writePiece(out, npoints, ncells, move(arrays), 1, options);
+   if (!out)
+      throw runtime_error("Writing " + path + " failed");
+}
+
+template<uint Dim, uint TopDim>
+void writePvtu(const string& path, System<Dim, TopDim>* system, const VtuOptions& options)
+{
+   const filesystem::path pvtu(path);
+   const string stem = pvtu.stem().string();
+   const size_t nsegs = system->getNumSegments();
+
+   exception_ptr error = nullptr;
+#pragma omp parallel for schedule(dynamic)
+   for (long iseg = 0; iseg < (long) nsegs; ++iseg) {
+      try {
+         size_t npoints, ncells;
+         vector<VtuArray> arrays = meshArrays(system->segment(static_cast<ID>(iseg))->mesh(), npoints, ncells);
+         arrays.push_back(makeArray<int32_t>("segment", "Int32", 1, ncells, [iseg](size_t) {
+            return static_cast<int32_t>(iseg);
+         }));
+         const filesystem::path piece = pvtu.parent_path() / (stem + "_" + to_string(iseg) + ".vtu");
+         ofstream out(piece, ios::binary);
+         writePiece(out, npoints, ncells, move(arrays), 1, options);
+         if (!out)
+            throw runtime_error("Writing " + piece.string() + " failed");
+      } catch (...) {
+#pragma omp critical
+         error = current_exception();
+      }
+   }
+   if (error)
+      rethrow_exception(error);
+
+   ofstream out(pvtu, ios::binary);
+   out << "<?xml version=\"1.0\"?>\n";
+   out << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\"" << byteOrder()
+       << "\" header_type=\"UInt64\">\n";
+   out << "<PUnstructuredGrid GhostLevel=\"0\">\n";
+   out << "<PPoints>\n<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n</PPoints>\n";
+   out << "<PCellData>\n<PDataArray type=\"Int32\" Name=\"segment\"/>\n</PCellData>\n";
+   for (size_t iseg = 0; iseg < nsegs; ++iseg)
+      out << "<Piece Source=\"" << stem << "_" << iseg << ".vtu\"/>\n";
+   out << "</PUnstructuredGrid>\n</VTKFile>\n";
+   if (!out)
+      throw runtime_error("Writing " + path + " failed");
+}
+
+template void writeVtu(ostream&, Mesh<1, 1>*, const VtuOptions&);
+template void writeVtu(ostream&, Mesh<2, 1>*, const VtuOptions&);
+template void writeVtu(ostream&, Mesh<2, 2>*, const VtuOptions&);
+template void writeVtu(ostream&, Mesh<3, 1>*, const VtuOptions&);
+template void writeVtu(ostream&, Mesh<3, 2>*, const VtuOptions&);
+template void writeVtu(ostream&, Mesh<3, 3>*, const VtuOptions&);
+template void writeVtu(const string&, System<1, 1>*, const VtuOptions&);
+template void writeVtu(const string&, System<2, 1>*, const VtuOptions&);
+template void writeVtu(const string&, System<2, 2>*, const VtuOptions&);
+template void writeVtu(const string&, System<3, 1>*, const VtuOptions&);
+template void writeVtu(const string&, System<3, 2>*, const VtuOptions&);
+template void writeVtu(const string&, System<3, 3>*, const VtuOptions&);
+template void writePvtu(const string&, System<1, 1>*, const VtuOptions&);
+template void writePvtu(const string&, System<2, 1>*, const VtuOptions&);
+template void writePvtu(const string&, System<2, 2>*, const VtuOptions&);
+template void writePvtu(const string&, System<3, 1>*, const VtuOptions&);
+template void writePvtu(const string&, System<3, 2>*, const VtuOptions&);
+template void writePvtu(const string&, System<3, 3>*, const VtuOptions&);
+
+}
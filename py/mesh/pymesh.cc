@@ -2,9 +2,21 @@
 #include <pybind11/eigen.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
+#include <pybind11/numpy.h>
+
+#include <fstream>
+#include <numeric>
+#include <optional>
+#include <unordered_map>
 
 #include "mesh.h"
 #include "system.h"
+#include "systemview.h"
+#include "vtk.h"
+#include "trianglefiles.h"
+#include "surface.h"
+#include "sharedmemory.h"
+#include "checkpoint.h"
 
 namespace py = pybind11;
 using rvp = py::return_value_policy;
@@ -18,7 +30,339 @@ PYBIND11_MAKE_OPAQUE(vector<Segment<2, 1>>);
 PYBIND11_MAKE_OPAQUE(vector<Segment<1, 1>>);
 PYBIND11_MAKE_OPAQUE(vector<Segment<3, 1>>);
 PYBIND11_MAKE_OPAQUE(vector<Segment<3, 2>>);
+PYBIND11_MAKE_OPAQUE(vector<Segment<3, 3>>);
+
+/**
+ * Marks meshes as busy. Meshes sharing a point list, i.e. a root mesh and its children, are marked together by the
+ * address of the point list. Calls running without the GIL keep their meshes busy, all other bindings touching a
+ * mesh, its segments or attributes check it first, so other Python threads get an error instead of modifying or
+ * reading them concurrently. Calls which only read the meshes, like meshing a factory, mark them as shared, so any
+ * number of them run at once. The busy set itself is only accessed with the GIL held.
+ */
+class Busy
+{
+public:
+   explicit Busy(vector<const void*> point_lists, bool shared = false) : point_lists(move(point_lists)), shared(shared)
+   {
+      sort(this->point_lists.begin(), this->point_lists.end());
+      this->point_lists.erase(unique(this->point_lists.begin(), this->point_lists.end()), this->point_lists.end());
+      for (size_t i = 0; i < this->point_lists.size(); ++i) {
+         const auto it = busy.find(this->point_lists[i]);
+         if (it != busy.end() && (!shared || it->second == exclusive)) {
+            for (size_t j = 0; j < i; ++j)
+               release(this->point_lists[j]);
+            throw runtime_error("Mesh is in use by another thread");
+         }
+         if (shared)
+            ++busy[this->point_lists[i]];
+         else
+            busy[this->point_lists[i]] = exclusive;
+      }
+   }
+
+   Busy(const Busy&) = delete;
+
+   Busy& operator=(const Busy&) = delete;
+
+   ~Busy()
+   {
+      for (const void* point_list : point_lists)
+         release(point_list);
+   }
+
+   /**
+    * Throws if the mesh is busy, unless it is only read. Sufficient for calls which keep the GIL and only read the
+    * mesh, as no other call can start meanwhile.
+    */
+   static void check(const void* point_list)
+   {
+      const auto it = busy.find(point_list);
+      if (it != busy.end() && it->second == exclusive)
+         throw runtime_error("Mesh is in use by another thread");
+   }
+
+   /**
+    * Throws if the mesh is busy at all, for calls which keep the GIL and modify the mesh.
+    */
+   static void checkIdle(const void* point_list)
+   {
+      if (busy.count(point_list) != 0)
+         throw runtime_error("Mesh is in use by another thread");
+   }
+
+   static const void* key(const MeshBase* mesh)
+   {
+      return &mesh->getPointList();
+   }
+
+   static const void* key(const MeshBase& mesh)
+   {
+      return key(&mesh);
+   }
+
+   static const void* key(const MeshElement& element)
+   {
+      return key(element.getMesh());
+   }
+
+   static const void* key(const MeshElementsProxy& proxy)
+   {
+      return key(proxy.getMesh());
+   }
+
+   static const void* key(const SegmentBase& segment)
+   {
+      return key(segment.mesh());
+   }
+
+   static const void* key(const SystemBase& system)
+   {
+      return key(system.mesh());
+   }
+
+   static const void* key(const AttributeBase& attribute)
+   {
+      return key(systemMesh(attribute.getSystem()));
+   }
+
+private:
+   // Number of shared marks of a point list, or exclusive
+   static constexpr size_t exclusive = SIZE_MAX;
+   static inline unordered_map<const void*, size_t> busy;
+   vector<const void*> point_lists;
+   bool shared;
+
+   void release(const void* point_list) const
+   {
+      if (!shared || --busy[point_list] == 0)
+         busy.erase(point_list);
+   }
+};
+
+/**
+ * Counts the NumPy views of the storage of meshes, per family of meshes sharing a point list like Busy. The views of
+ * coordinates, connectivity, IDs and attribute values point into vectors, which reallocate when the mesh grows.
+ * Therefore growing a mesh is refused with a BufferError while views of it exist, like resizing a bytearray. The
+ * counts are only accessed with the GIL held.
+ */
+class Exports
+{
+public:
+   /**
+    * @return The base object for a view of the storage of the meshes of the point list, which keeps the owner alive
+    * and counts the view until it is released
+    */
+   static py::object base(const void* point_list, py::object owner)
+   {
+      auto* view = new View{point_list, move(owner)};
+      ++counts[point_list];
+      return py::capsule(view, [](void* pointer) {
+         auto* view = static_cast<View*>(pointer);
+         if (--counts[view->point_list] == 0)
+            counts.erase(view->point_list);
+         delete view;
+      });
+   }
+
+   /**
+    * Throws a BufferError if views of the storage of the meshes of the point list exist.
+    */
+   static void checkGrowth(const void* point_list)
+   {
+      if (counts.count(point_list) != 0)
+         throw py::buffer_error("Mesh can't grow while NumPy views of its points, elements or attributes exist");
+   }
+
+private:
+   struct View
+   {
+      const void* point_list;
+      py::object owner;
+   };
+
+   static inline unordered_map<const void*, size_t> counts;
+};
+
+/**
+ * Runs f without the GIL while the meshes of the given point lists are busy.
+ */
+template<typename F>
+static decltype(auto) withoutGil(vector<const void*> point_lists, F&& f)
+{
+   Busy busy(move(point_lists));
+   py::gil_scoped_release release;
+   return f();
+}
+
+/**
+ * Runs f without the GIL while the meshes of the given point lists are marked as shared, f must only read them.
+ */
+template<typename F>
+static decltype(auto) readingWithoutGil(vector<const void*> point_lists, F&& f)
+{
+   Busy busy(move(point_lists), true);
+   py::gil_scoped_release release;
+   return f();
+}
+
+/**
+ * Wraps a method, which checks first that the mesh of the object is not busy.
+ */
+template<typename C, typename R, typename... Args, bool NoExcept>
+static auto checked(R (C::*method)(Args...) noexcept(NoExcept))
+{
+   return [method](C& self, Args... args) -> R {
+      Busy::check(Busy::key(self));
+      return (self.*method)(forward<Args>(args)...);
+   };
+}
+
+template<typename C, typename R, typename... Args, bool NoExcept>
+static auto checked(R (C::*method)(Args...) const noexcept(NoExcept))
+{
+   return [method](const C& self, Args... args) -> R {
+      Busy::check(Busy::key(self));
+      return (self.*method)(forward<Args>(args)...);
+   };
+}
+
+/**
+ * Iterator over the elements of a proxy, which checks before every element that the mesh is not busy.
+ */
+class CheckedIterator
+{
+public:
+   CheckedIterator(MeshElementsProxy::iterator it, const void* key) : it(it), key(key)
+   {}
+
+   MeshElement& operator*()
+   {
+      Busy::check(key);
+      return *it;
+   }
+
+   CheckedIterator& operator++()
+   {
+      ++it;
+      return *this;
+   }
+
+   bool operator==(const CheckedIterator& other) const noexcept
+   {
+      return it == other.it;
+   }
 
+   bool operator!=(const CheckedIterator& other) const noexcept
+   {
+      return it != other.it;
+   }
+
+private:
+   MeshElementsProxy::iterator it;
+   const void* key;
+};
+
+
+/**
+ * Calls f(data, rows, cols, row_stride, col_stride) with the data of a 2D array, strides counted in elements. Arrays
+ * of one of the element types T, Ts... are passed as they are, in whatever order or with whatever strides. Other
+ * arrays are converted into a C ordered array of T first.
+ */
+template<typename T, typename... Ts, typename F>
+static void visitArray(const py::object& object, F&& f)
+{
+   // Sequences other than arrays are taken as well
+   const auto array = py::array::ensure(object);
+   if (!array)
+      throw py::error_already_set();
+   if (array.ndim() != 2)
+      throw logic_error("Expected a 2D array");
+   bool visited = false;
+   const auto visit = [&](auto* tag) {
+      using U = remove_pointer_t<decltype(tag)>;
+      constexpr auto size = py::ssize_t(sizeof(U));
+      if (visited || !py::isinstance<py::array_t<U>>(array) || array.strides(0) % size != 0
+          || array.strides(1) % size != 0)
+         return;
+      f(static_cast<const U*>(array.data()), size_t(array.shape(0)), size_t(array.shape(1)), array.strides(0) / size,
+        array.strides(1) / size);
+      visited = true;
+   };
+   visit(static_cast<T*>(nullptr));
+   (visit(static_cast<Ts*>(nullptr)), ...);
+   if (!visited) {
+      const auto converted = py::array_t<T, py::array::c_style | py::array::forcecast>::ensure(array);
+      if (!converted)
+         throw py::error_already_set();
+      f(converted.data(), size_t(converted.shape(0)), size_t(converted.shape(1)), converted.shape(1), py::ssize_t(1));
+   }
+}
+
+/**
+ * Adds an attribute of the type, location and layout chosen at runtime, or returns the existing one of that name.
+ */
+template<typename SystemClass, typename T, StorageLocation Location>
+static AttributeBase* createAttribute(SystemClass& system, const string& name, const AttributeExtent& extent, bool soa)
+{
+   if (soa)
+      return &system.template addAttribute<T, Location, SoA>(name, extent);
+   return &system.template addAttribute<T, Location>(name, extent);
+}
+
+template<typename SystemClass, typename T>
+static AttributeBase* createAttribute(SystemClass& system, const string& name, const AttributeExtent& extent,
+                                      StorageLocation location, bool soa)
+{
+   switch (location) {
+      case StorageLocation::VERTEX:
+         return createAttribute<SystemClass, T, StorageLocation::VERTEX>(system, name, extent, soa);
+      case StorageLocation::EDGE:
+         return createAttribute<SystemClass, T, StorageLocation::EDGE>(system, name, extent, soa);
+      case StorageLocation::FACE:
+         return createAttribute<SystemClass, T, StorageLocation::FACE>(system, name, extent, soa);
+      case StorageLocation::CELL:
+         return createAttribute<SystemClass, T, StorageLocation::CELL>(system, name, extent, soa);
+      case StorageLocation::SEGMENT:
+         return createAttribute<SystemClass, T, StorageLocation::SEGMENT>(system, name, extent, soa);
+   }
+   throw logic_error("Unknown storage location");
+}
+
+template<typename SystemClass>
+static AttributeBase* createAttribute(SystemClass& system, const string& name, const AttributeExtent& extent,
+                                      StorageLocation location, ScalarType type, bool soa)
+{
+   switch (type) {
+      case ScalarType::FLOAT64:
+         return createAttribute<SystemClass, double>(system, name, extent, location, soa);
+      case ScalarType::FLOAT32:
+         return createAttribute<SystemClass, float>(system, name, extent, location, soa);
+      case ScalarType::INT64:
+         return createAttribute<SystemClass, int64_t>(system, name, extent, location, soa);
+      case ScalarType::INT32:
+         return createAttribute<SystemClass, int32_t>(system, name, extent, location, soa);
+      case ScalarType::UINT8:
+         return createAttribute<SystemClass, uint8_t>(system, name, extent, location, soa);
+   }
+   throw logic_error("Unknown scalar type");
+}
+
+static ScalarType dtypeScalarType(const py::dtype& dtype)
+{
+   const char kind = dtype.kind();
+   const auto itemsize = dtype.itemsize();
+   if (kind == 'f' && itemsize == 8)
+      return ScalarType::FLOAT64;
+   if (kind == 'f' && itemsize == 4)
+      return ScalarType::FLOAT32;
+   if (kind == 'i' && itemsize == 8)
+      return ScalarType::INT64;
+   if (kind == 'i' && itemsize == 4)
+      return ScalarType::INT32;
+   if (kind == 'u' && itemsize == 1)
+      return ScalarType::UINT8;
+   throw invalid_argument("Attributes are float64, float32, int64, int32 or uint8");
+}
 
 template<uint Dim>
 static py::class_<Mesh<Dim, 0>, MeshBase> declareMesh0D(py::module &m)
@@ -28,12 +372,22 @@ static py::class_<Mesh<Dim, 0>, MeshBase> declareMesh0D(py::module &m)
    const string name = Dim == 0 ? "Mesh0D" : "Mesh" + to_string(Dim) + "0D";
 
    py::class_<typename Class::VerticesProxy, MeshElementsProxy> proxy(m, ("VerticesProxy" + to_string(Dim) + "D").c_str());
-   proxy.def("add_points", py::overload_cast<const EigenDRef<const MatrixXd>&>(&Class::VerticesProxy::add), rvp::reference_internal, py::arg().noconvert());
+   proxy.def("add_points", [](typename Class::VerticesProxy& vertices, const py::object& points)
+           -> typename Class::VerticesProxy& {
+      visitArray<double, float>(points, [&](const auto* data, size_t n, size_t cols, ptrdiff_t row_stride,
+                                            ptrdiff_t col_stride) {
+         if (cols != Dim)
+            throw logic_error("A vertex consists of one point only");
+         Exports::checkGrowth(Busy::key(vertices.getMesh()));
+         withoutGil({Busy::key(vertices.getMesh())}, [&] { vertices.add(data, n, row_stride, col_stride); });
+      });
+      return vertices;
+   }, rvp::reference_internal, "points"_a);
 
    PyClass cls(m, name.c_str());
    cls.def(py::init<>())
            .def(py::init<Mesh<Dim, 0> *>())
-           .def_property_readonly("vertices", &Class::vertices, rvp::reference_internal);
+           .def_property_readonly("vertices", checked(&Class::vertices), rvp::reference_internal);
    return cls;
 }
 
@@ -49,7 +403,7 @@ static py::class_<Mesh<Dim, 1>, Mesh<Dim, 0>> declareMesh1D(py::module &m)
    PyClass cls(m, name.c_str());
    cls.def(py::init<>())
            .def(py::init<Mesh<Dim, 1> *>())
-           .def_property_readonly("edges", &Class::edges, rvp::reference_internal);
+           .def_property_readonly("edges", checked(&Class::edges), rvp::reference_internal);
 
    return cls;
 }
@@ -66,7 +420,27 @@ static py::class_<Mesh<Dim, 2>, Mesh<Dim, 1>> declareMesh2D(py::module &m)
    PyClass cls(m, name.c_str());
    cls.def(py::init<>())
            .def(py::init<Mesh<Dim, 2> *>())
-           .def_property_readonly("faces", &Class::faces, rvp::reference_internal);
+           .def_property_readonly("faces", checked(&Class::faces), rvp::reference_internal);
+   if constexpr (Dim == 3) {
+      cls.def("read_surface", [](Class& self, const string& path, double weld_tolerance) {
+         Exports::checkGrowth(Busy::key(&self));
+         return withoutGil({Busy::key(&self)}, [&] { return readSurface(path, &self, weld_tolerance); });
+      }, "path"_a, "weld_tolerance"_a = 0.0);
+   }
+   return cls;
+}
+
+static py::class_<Mesh<3, 3>, Mesh<3, 2>> declareMesh3D(py::module &m)
+{
+   using Class = Mesh<3, 3>;
+   using PyClass = py::class_<Class, Mesh<3, 2>>;
+
+   py::class_<Class::CellsProxy, MeshElementsProxy> proxy(m, "CellsProxy3D");
+
+   PyClass cls(m, "Mesh3D");
+   cls.def(py::init<>())
+           .def(py::init<Mesh<3, 3> *>())
+           .def_property_readonly("cells", checked(&Class::cells), rvp::reference_internal);
    return cls;
 }
 
@@ -89,7 +463,7 @@ template<uint Dim, uint TopDim>
 static void declareSegment(py::module &m)
 {
    using Class = Segment<Dim, TopDim>;
-   using PyClass = py::class_<Class>;
+   using PyClass = py::class_<Class, SegmentBase>;
 
    stringstream ss;
    ss << "Segment";
@@ -98,8 +472,8 @@ static void declareSegment(py::module &m)
    else
       ss << Dim << TopDim << 'D';
    PyClass cls(m, ss.str().c_str());
-   cls.def_property_readonly("id", &Class::getID);
-   cls.def_property_readonly("mesh", py::overload_cast<>(&Class::mesh), rvp::reference_internal);
+   cls.def_property_readonly("id", checked(&Class::getID));
+   cls.def_property_readonly("mesh", checked(py::overload_cast<>(&Class::mesh)), rvp::reference_internal);
 }
 
 template<uint Dim, uint TopDim>
@@ -115,8 +489,8 @@ static void declareInterface(py::module &m)
    else
       ss << Dim << TopDim << 'D';
    PyClass cls(m, ss.str().c_str());
-   cls.def_property_readonly("id", &Class::getID);
-   cls.def_property_readonly("mesh", py::overload_cast<>(&Class::mesh), rvp::reference_internal);
+   cls.def_property_readonly("id", checked(&Class::getID));
+   cls.def_property_readonly("mesh", checked(py::overload_cast<>(&Class::mesh)), rvp::reference_internal);
 }
 
 template<uint Dim, uint TopDim>
@@ -133,13 +507,91 @@ static void declareSystem(py::module &m)
       system_ss << Dim << TopDim << 'D';
 
    PyClassSystem cls_system(m, system_ss.str().c_str());
-   cls_system.def("segment", py::overload_cast<const string&>(&SystemClass::segment), rvp::reference_internal);
-   cls_system.def("segment", py::overload_cast<ID>(&SystemClass::segment), rvp::reference_internal);
-   cls_system.def_property_readonly("mesh", py::overload_cast<>(&SystemClass::mesh, py::const_), rvp::reference_internal);
-   cls_system.def_property_readonly("voronoi", &SystemClass::voronoi, rvp::reference_internal);
-   cls_system.def("interface", py::overload_cast<const string&, const string&>(&SystemClass::interface), rvp::reference_internal);
-   cls_system.def("interface", py::overload_cast<ID, ID>(&SystemClass::interface), rvp::reference_internal);
+   cls_system.def("segment", checked(py::overload_cast<const string&>(&SystemClass::segment)), rvp::reference_internal);
+   cls_system.def("segment", checked(py::overload_cast<ID>(&SystemClass::segment)), rvp::reference_internal);
+   cls_system.def_property_readonly("mesh", checked(py::overload_cast<>(&SystemClass::mesh, py::const_)), rvp::reference_internal);
+   cls_system.def_property_readonly("voronoi", checked(&SystemClass::voronoi), rvp::reference_internal);
+   cls_system.def("interface", checked(py::overload_cast<const string&, const string&>(&SystemClass::interface)), rvp::reference_internal);
+   cls_system.def("interface", checked(py::overload_cast<ID, ID>(&SystemClass::interface)), rvp::reference_internal);
+   cls_system.def("add_attribute", [](SystemClass& system, const string& name, const vector<size_t>& extents,
+                                      StorageLocation location, const py::object& dtype, const string& layout) {
+      if (layout != "aos" && layout != "soa")
+         throw invalid_argument("Layout must be aos or soa, blocked layouts have no NumPy view");
+      AttributeExtent extent(extents.empty() ? 1 : extents[0]);
+      for (size_t i = 1; i < extents.size(); ++i)
+         extent(extents[i]);
+      const ScalarType type = dtypeScalarType(py::dtype::from_args(dtype));
+      Busy busy({Busy::key(system.mesh())});
+      return createAttribute(system, name, extent, location, type, layout == "soa");
+   }, "name"_a, "extents"_a = vector<size_t>(), "location"_a = StorageLocation::VERTEX, "dtype"_a = "float64",
+      "layout"_a = "aos", rvp::reference_internal);
+   cls_system.def("attribute", checked(py::overload_cast<const string&>(&SystemClass::getAttribute)), "name"_a,
+                  rvp::reference_internal);
+   cls_system.def("transfer_attributes", [](SystemClass& system, SystemClass& source, const vector<string>& names,
+                                            TransferMode mode, uint samples) {
+      // The target attributes are added with the type, location, extents and layout of the source ones
+      Busy::check(Busy::key(source));
+      Busy::check(Busy::key(system));
+      vector<pair<const AttributeBase*, AttributeBase*>> pairs;
+      for (const string& name : names) {
+         const AttributeBase* from = static_cast<const SystemClass&>(source).getAttribute(name);
+         AttributeBase* to = createAttribute(system, name, from->getExtents(), from->getLocation(),
+                                             from->getScalarType(), from->getLayoutBlock() == 0);
+         pairs.emplace_back(from, to);
+      }
+      withoutGil({Busy::key(source.mesh()), Busy::key(system.mesh())}, [&] {
+         AttributeTransfer transfer(&source, &system, samples);
+         for (const auto& [from, to] : pairs)
+            transfer(*from, *to, mode);
+      });
+   }, "source"_a, "names"_a, "mode"_a = TransferMode::INTERPOLATE, "samples"_a = 3);
    cls_system.def("get_raw_address", [](SystemClass& foo){ return reinterpret_cast<uint64_t>(&foo);});
+   cls_system.def("write", [](const SystemClass& system, const string& path) {
+      withoutGil({Busy::key(system.mesh())}, [&] {
+         ofstream out(path, ios::binary);
+         system.write(out);
+         if (!out)
+            throw runtime_error("Writing " + path + " failed");
+      });
+   }, "path"_a);
+   cls_system.def("reduction", [](SystemClass& system, ReductionDomain domain) {
+      return make_unique<SegmentReduction>(&system, domain);
+   }, "domain"_a = ReductionDomain::SEGMENTS, py::keep_alive<0, 1>());
+   cls_system.def("write_checkpoint", [](const SystemClass& system, CheckpointWriter& writer, uint64_t step,
+                                         double time, const vector<string>& names) {
+      // Only the snapshot is taken here, the writer thread does the rest
+      withoutGil({Busy::key(system.mesh())}, [&] { writer.write(system, step, time, names); });
+   }, "writer"_a, "step"_a, "time"_a = 0.0, "names"_a = vector<string>());
+   cls_system.def("read_checkpoint", [](SystemClass& system, const CheckpointReader& reader, uint64_t step) {
+      withoutGil({Busy::key(system.mesh())}, [&] { reader.read(step, system); });
+   }, "reader"_a, "step"_a);
+   cls_system.def("share", [](const SystemClass& system, const string& name) {
+      return withoutGil({Busy::key(system.mesh())}, [&] { return system.share(name); });
+   }, "name"_a);
+   cls_system.def_static("read", [](const string& path) {
+      return SystemClass::read(*SystemView::open(path)).release();
+   }, "path"_a, rvp::take_ownership, py::call_guard<py::gil_scoped_release>());
+   cls_system.def("write_gmsh", [](const SystemClass& system, const string& path, bool binary) {
+      withoutGil({Busy::key(system.mesh())}, [&] {
+         ofstream out(path, ios::binary);
+         system.writeGmsh(out, binary);
+         if (!out)
+            throw runtime_error("Writing " + path + " failed");
+      });
+   }, "path"_a, "binary"_a = false);
+   cls_system.def_static("read_gmsh", [](const string& path) {
+      return SystemClass::readGmsh(path).release();
+   }, "path"_a, rvp::take_ownership, py::call_guard<py::gil_scoped_release>());
+   cls_system.def("write_vtu", [](SystemClass& system, const string& path, bool compress, bool per_segment) {
+      VtuOptions options;
+      options.compress = compress;
+      withoutGil({Busy::key(system.mesh())}, [&] {
+         if (per_segment)
+            writePvtu(path, &system, options);
+         else
+            writeVtu(path, &system, options);
+      });
+   }, "path"_a, "compress"_a = false, "per_segment"_a = false);
 
    stringstream systemfactory_ss;
    systemfactory_ss << "SystemFactory";
@@ -147,39 +599,442 @@ static void declareSystem(py::module &m)
       systemfactory_ss << TopDim << 'D';
    else
       systemfactory_ss << Dim << TopDim << 'D';
-   py::class_<typename System<Dim, TopDim>::Factory> cls_systemfactory(m, systemfactory_ss.str().c_str());
+   using Factory = typename System<Dim, TopDim>::Factory;
+   py::class_<Factory> cls_systemfactory(m, systemfactory_ss.str().c_str());
    cls_systemfactory.def(py::init<>());
-   cls_systemfactory.def_property_readonly("mesh", &System<Dim, TopDim>::Factory::mesh, rvp::reference_internal);
-   cls_systemfactory.def("segment", &System<Dim, TopDim>::Factory::segment, rvp::reference_internal);
-   cls_systemfactory.def("create", &System<Dim, TopDim>::Factory::create, "area"_a = 0.0, rvp::take_ownership);
+   cls_systemfactory.def_property_readonly("mesh", [](Factory& factory) {
+      Busy::check(Busy::key(factory.mesh()));
+      return factory.mesh();
+   }, rvp::reference_internal);
+   cls_systemfactory.def("segment", [](Factory& factory, const string& name) {
+      // Adds the segment if it does not exist yet
+      Busy::checkIdle(Busy::key(factory.mesh()));
+      return factory.segment(name);
+   }, rvp::reference_internal);
+   cls_systemfactory.def("block", [](Factory& factory, const string& name, const vector<double>& lower,
+                                     const vector<double>& upper, const vector<size_t>& divisions,
+                                     const vector<double>& grading) {
+      Exports::checkGrowth(Busy::key(factory.mesh()));
+      return withoutGil({Busy::key(factory.mesh())}, [&] {
+         return factory.block(name, lower, upper, divisions, grading);
+      });
+   }, "name"_a, "lower"_a, "upper"_a, "divisions"_a, "grading"_a = vector<double>(), rvp::reference_internal);
+   cls_systemfactory.def("set_cache_directory", [](Factory& factory, const string& directory) {
+      Busy::checkIdle(Busy::key(factory.mesh()));
+      factory.setCacheDirectory(directory);
+   }, "directory"_a);
+   cls_systemfactory.def("create", [](Factory& factory, double area, bool decompose) {
+      return readingWithoutGil({Busy::key(factory.mesh())}, [&] { return factory.create(area, decompose); });
+   }, "area"_a = 0.0, "decompose"_a = false, rvp::take_ownership);
+   if constexpr (Dim == 2 && TopDim == 2)
+      cls_systemfactory.def("add_poly", [](Factory& factory, const string& path) {
+         Exports::checkGrowth(Busy::key(factory.mesh()));
+         withoutGil({Busy::key(factory.mesh())}, [&] { addPoly(factory, readPoly(path)); });
+      }, "path"_a);
+   cls_systemfactory.def_static("create_batch", [](const vector<Factory*>& factories, const vector<double>& areas,
+                                                   bool decompose, int nthreads) {
+      vector<const void*> point_lists;
+      for (Factory* factory : factories)
+         point_lists.push_back(Busy::key(factory->mesh()));
+      return readingWithoutGil(move(point_lists), [&] {
+         return Factory::createBatch({factories.begin(), factories.end()}, areas, decompose, nthreads);
+      });
+   }, "factories"_a, "areas"_a, "decompose"_a = false, "nthreads"_a = 0, rvp::take_ownership);
+}
+
+/**
+ * Wraps data as read-only NumPy array without copying, which keeps its owner alive.
+ */
+template<typename T>
+static py::array readOnlyArray(const T* data, const vector<py::ssize_t>& shape, const py::object& owner)
+{
+   py::array array(py::dtype::of<T>(), shape, data, owner);
+   py::detail::array_proxy(array.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+   return array;
+}
+
+/**
+ * Wraps storage of the meshes of the point list as read-only NumPy array, which is counted by Exports.
+ */
+template<typename T>
+static py::array readOnlyArray(const T* data, const vector<py::ssize_t>& shape, const void* point_list,
+                               const py::object& owner)
+{
+   return readOnlyArray(data, shape, Exports::base(point_list, owner));
+}
+
+template<typename T>
+static py::array readOnlyArray(const ArrayView<T>& view, const vector<py::ssize_t>& shape, const py::object& owner)
+{
+   return readOnlyArray(view.data(), shape, owner);
+}
+
+/**
+ * The vertex IDs of the simplices as (n, k) array. For a root mesh this is a view of its connectivity, for a child
+ * mesh the rows of the referenced simplices are gathered into a new array.
+ */
+static py::array connectivityArray(const py::object& self)
+{
+   const auto& proxy = self.cast<const MeshElementsProxy&>();
+   Busy::check(Busy::key(proxy));
+   const py::ssize_t nvertices = proxy.getSimplexDimension() + 1;
+   const vector<ID>& connectivity = proxy.connectivity();
+   const vector<ID>* ids = proxy.referencedIDs();
+   if (ids == nullptr)
+      return readOnlyArray(connectivity.data(), {py::ssize_t(connectivity.size()) / nvertices, nvertices},
+                           Busy::key(proxy), self);
+   py::array_t<ID> array({py::ssize_t(ids->size()), nvertices});
+   ID* data = array.mutable_data();
+   withoutGil({Busy::key(proxy.getMesh())}, [&] {
+      for (size_t i = 0; i < ids->size(); ++i)
+         copy_n(connectivity.begin() + (*ids)[i] * nvertices, nvertices, data + i * nvertices);
+   });
+   return array;
+}
+
+static py::dtype scalarDtype(ScalarType type)
+{
+   switch (type) {
+      case ScalarType::FLOAT64:
+         return py::dtype::of<double>();
+      case ScalarType::FLOAT32:
+         return py::dtype::of<float>();
+      case ScalarType::INT64:
+         return py::dtype::of<int64_t>();
+      case ScalarType::INT32:
+         return py::dtype::of<int32_t>();
+      case ScalarType::UINT8:
+         return py::dtype::of<uint8_t>();
+   }
+   throw logic_error("Unknown scalar type");
+}
+
+/**
+ * Shape (n, *extents) and byte strides of the values of an attribute in its layout. Extents of 1 are left out, like
+ * in the C interface.
+ */
+static pair<vector<py::ssize_t>, vector<py::ssize_t>> attributeStrides(const AttributeBase& attribute)
+{
+   const auto itemsize = py::ssize_t(scalarSize(attribute.getScalarType()));
+   const auto n = py::ssize_t(attribute.getNumEntities());
+   vector<py::ssize_t> shape{n};
+   for (size_t d = 0; d < attribute.getExtents().getDimension(); ++d)
+      if (attribute.getExtents().getExtent(d) != 1)
+         shape.push_back(py::ssize_t(attribute.getExtents().getExtent(d)));
+   vector<py::ssize_t> strides(shape.size());
+   switch (attribute.getLayoutBlock()) {
+      case 1:
+         strides.back() = itemsize;
+         for (size_t d = shape.size() - 1; d > 0; --d)
+            strides[d - 1] = strides[d] * shape[d];
+         break;
+      case 0:
+         // Every component is an array over the entities
+         strides.front() = itemsize;
+         if (shape.size() > 1) {
+            strides.back() = n * itemsize;
+            for (size_t d = shape.size() - 2; d > 0; --d)
+               strides[d] = strides[d + 1] * shape[d + 1];
+         }
+         break;
+      default:
+         throw logic_error("Attribute " + attribute.getName() + " is stored in blocks, which have no strided view");
+   }
+   return {shape, strides};
+}
+
+/**
+ * Writable view of the values of an attribute, counted by Exports, as the values move when the mesh grows. Writes
+ * through it are not recorded in the change log of the attribute, they need a call of modified.
+ */
+static py::array attributeArray(const py::object& self)
+{
+   const auto& attribute = self.cast<const AttributeBase&>();
+   Busy::check(Busy::key(attribute));
+   const auto [shape, strides] = attributeStrides(attribute);
+   // The values belong to the attribute, only the interface is const
+   return py::array(scalarDtype(attribute.getScalarType()), shape, strides, const_cast<void*>(attribute.data()),
+                    Exports::base(Busy::key(attribute), self));
+}
+
+static void declareAttribute(py::module &m)
+{
+   py::enum_<StorageLocation>(m, "StorageLocation")
+           .value("VERTEX", StorageLocation::VERTEX)
+           .value("EDGE", StorageLocation::EDGE)
+           .value("FACE", StorageLocation::FACE)
+           .value("CELL", StorageLocation::CELL)
+           .value("SEGMENT", StorageLocation::SEGMENT);
+
+   py::enum_<TransferMode>(m, "TransferMode")
+           .value("INTERPOLATE", TransferMode::INTERPOLATE)
+           .value("CONSERVATIVE", TransferMode::CONSERVATIVE);
+
+   py::enum_<ReductionDomain>(m, "ReductionDomain")
+           .value("SEGMENTS", ReductionDomain::SEGMENTS)
+           .value("INTERFACES", ReductionDomain::INTERFACES);
+
+   // Reductions of an attribute as dict of arrays with a row per segment or interface
+   py::class_<SegmentReduction>(m, "SegmentReduction")
+           .def_property_readonly("domain", &SegmentReduction::getDomain)
+           .def("clear", &SegmentReduction::clear)
+           .def("__call__", [](SegmentReduction& reduction, const AttributeBase& attribute) {
+              const ReductionTable table = withoutGil({Busy::key(systemMesh(attribute.getSystem()))}, [&] {
+                 return reduction(attribute);
+              });
+              const auto rows = py::ssize_t(table.rows);
+              const auto columns = py::ssize_t(table.columns);
+              py::dict result;
+              result["names"] = table.names;
+              result["count"] = py::array_t<size_t>(rows, table.count.data());
+              result["measure"] = py::array_t<double>(rows, table.measure.data());
+              result["integral"] = py::array_t<double>({rows, columns}, table.integral.data());
+              result["mean"] = py::array_t<double>({rows, columns}, table.mean.data());
+              result["min"] = py::array_t<double>({rows, columns}, table.min.data());
+              result["max"] = py::array_t<double>({rows, columns}, table.max.data());
+              result["l2"] = py::array_t<double>({rows, columns}, table.l2.data());
+              return result;
+           }, "attribute"_a);
+
+   py::class_<SegmentBase>(m, "SegmentBase")
+           .def_property_readonly("id", checked(&SegmentBase::getID))
+           .def_property_readonly("name", checked(&SegmentBase::getName));
+
+   py::class_<AttributeBase>(m, "Attribute", py::buffer_protocol())
+           .def_property_readonly("name", checked(&AttributeBase::getName))
+           .def_property_readonly("location", checked(&AttributeBase::getLocation))
+           .def_property_readonly("dtype", [](const AttributeBase& attribute) {
+              Busy::check(Busy::key(attribute));
+              return scalarDtype(attribute.getScalarType());
+           })
+           .def_property_readonly("extents", [](const AttributeBase& attribute) {
+              Busy::check(Busy::key(attribute));
+              vector<size_t> extents;
+              for (size_t d = 0; d < attribute.getExtents().getDimension(); ++d)
+                 extents.push_back(attribute.getExtents().getExtent(d));
+              return extents;
+           })
+           .def("__len__", checked(&AttributeBase::getNumEntities))
+           .def_buffer([](AttributeBase& attribute) {
+              // The buffer is taken from a counted view, which is released together with the buffer
+              const py::array array = attributeArray(py::cast(attribute, rvp::reference));
+              auto view = make_unique<Py_buffer>();
+              if (PyObject_GetBuffer(array.ptr(), view.get(), PyBUF_RECORDS) != 0)
+                 throw py::error_already_set();
+              return py::buffer_info(view.release());
+           })
+           .def_property_readonly("values", &attributeArray,
+                                  "Writable view of the values. Writes through it or the buffer protocol are not "
+                                  "recorded, call modified afterwards, so derived attributes and caches see them.")
+           .def("modified", [](AttributeBase& attribute, size_t first, optional<size_t> last) {
+              Busy::check(Busy::key(attribute));
+              attribute.modified(first, last.value_or(SIZE_MAX));
+           }, "first"_a = 0, "last"_a = py::none(),
+              "Records that the values of the entities first to last - 1 were written through values or a buffer.")
+           .def("invalidate", checked(&AttributeBase::invalidate),
+                "Recomputes the values of a derived attribute on the next access.")
+           .def("indices", [](const AttributeBase& attribute, const py::object& segment) -> py::array {
+              // The entities of a segment as index array into the values, a view for simplices
+              const auto& seg = segment.cast<const SegmentBase&>();
+              Busy::check(Busy::key(attribute));
+              Busy::check(Busy::key(seg));
+              if (attribute.getLocation() == StorageLocation::SEGMENT) {
+                 py::array_t<ID> ids(1);
+                 ids.mutable_data()[0] = seg.getID();
+                 return ids;
+              }
+              const vector<ID>* ids = seg.mesh()->simplices(attribute.getLocation()).referencedIDs();
+              if (ids == nullptr)
+                 throw logic_error("Segment mesh does not refer to the system mesh");
+              return readOnlyArray(ids->data(), {py::ssize_t(ids->size())}, Busy::key(seg), segment);
+           }, "segment"_a)
+           .def("segment_values", [](const py::object& self, const py::object& segment) -> py::array {
+              // A strided view if the entities of the segment follow each other, which holds for generated systems
+              const py::array ids = self.attr("indices")(segment);
+              const auto* data = static_cast<const ID*>(ids.data());
+              const auto n = ids.size();
+              for (py::ssize_t i = 1; i < n; ++i)
+                 if (data[i] != data[0] + i)
+                    throw logic_error("Entities of the segment are not contiguous, "
+                                      "use values[attribute.indices(segment)] instead");
+              const py::ssize_t first = n > 0 ? data[0] : 0;
+              return attributeArray(self)[py::slice(first, first + n, 1)].cast<py::array>();
+           }, "segment"_a)
+           .def("gather", [](const AttributeBase& attribute, const SegmentBase& segment) {
+              // A dense copy of the values of the segment in the order of the segment mesh
+              Busy::check(Busy::key(attribute));
+              Busy::check(Busy::key(segment));
+              const vector<ID> entities = segmentEntities(&segment, attribute.getLocation(),
+                                                          attribute.getNumEntities());
+              auto shape = attributeStrides(attribute).first;
+              shape.front() = py::ssize_t(entities.size());
+              py::array values(scalarDtype(attribute.getScalarType()), shape);
+              void* data = values.mutable_data();
+              withoutGil({Busy::key(systemMesh(attribute.getSystem()))}, [&] {
+                 attribute.gather(entities, data);
+              });
+              return values;
+           }, "segment"_a)
+           .def("scatter", [](AttributeBase& attribute, const SegmentBase& segment, const py::object& values) {
+              // Writes the values of a segment as gathered back
+              Busy::check(Busy::key(attribute));
+              Busy::check(Busy::key(segment));
+              const vector<ID> entities = segmentEntities(&segment, attribute.getLocation(),
+                                                          attribute.getNumEntities());
+              const py::array array = py::module::import("numpy").attr("ascontiguousarray")(
+                      values, scalarDtype(attribute.getScalarType()));
+              if (size_t(array.size()) != entities.size() * attribute.getExtents().getSize())
+                 throw invalid_argument("Values do not match the entities of segment " + segment.getName());
+              const void* data = array.data();
+              withoutGil({Busy::key(systemMesh(attribute.getSystem()))}, [&] {
+                 attribute.scatter(entities, data);
+              });
+           }, "segment"_a, "values"_a);
+}
+
+static void declareCheckpoint(py::module &m)
+{
+   py::class_<CheckpointWriter>(m, "CheckpointWriter")
+           .def(py::init([](const string& path, bool compress, int level, size_t buffers) {
+              return make_unique<CheckpointWriter>(path, CheckpointOptions{compress, level, buffers});
+           }), "path"_a, "compress"_a = true, "level"_a = 1, "buffers"_a = 2)
+           .def_property_readonly("path", &CheckpointWriter::getPath)
+           .def("flush", &CheckpointWriter::flush, py::call_guard<py::gil_scoped_release>())
+           .def("close", &CheckpointWriter::close, py::call_guard<py::gil_scoped_release>())
+           .def("__enter__", [](CheckpointWriter& writer) -> CheckpointWriter& { return writer; },
+                rvp::reference)
+           .def("__exit__", [](CheckpointWriter& writer, const py::object&, const py::object&, const py::object&) {
+              py::gil_scoped_release release;
+              writer.close();
+           });
+
+   py::class_<CheckpointReader>(m, "CheckpointReader")
+           .def(py::init<const string&>(), "path"_a, py::call_guard<py::gil_scoped_release>())
+           .def_property_readonly("steps", [](const CheckpointReader& reader) {
+              vector<uint64_t> steps;
+              for (const CheckpointStep& step : reader.getSteps())
+                 steps.push_back(step.step);
+              return steps;
+           })
+           .def_property_readonly("times", [](const CheckpointReader& reader) {
+              vector<double> times;
+              for (const CheckpointStep& step : reader.getSteps())
+                 times.push_back(step.time);
+              return times;
+           })
+           .def("attribute_names", &CheckpointReader::getAttributeNames, "step"_a)
+           .def("read", [](const CheckpointReader& reader, uint64_t step, AttributeBase& attribute) {
+              withoutGil({Busy::key(attribute)}, [&] { reader.read(step, attribute); });
+           }, "step"_a, "attribute"_a);
+}
+
+static void declareSystemView(py::module &m)
+{
+   // Keeps a shared system alive, the segment is removed when it is garbage collected
+   py::class_<SharedMemory>(m, "SharedMemory")
+           .def_property_readonly("name", &SharedMemory::name)
+           .def_property_readonly("size", &SharedMemory::size);
+
+   py::class_<SystemView, shared_ptr<SystemView>> cls(m, "SystemView");
+   cls.def_static("open", &SystemView::open, "path"_a, py::call_guard<py::gil_scoped_release>());
+   cls.def_static("attach", &SystemView::attach, "name"_a, py::call_guard<py::gil_scoped_release>());
+   cls.def_property_readonly("dim", &SystemView::getDimension);
+   cls.def_property_readonly("topdim", &SystemView::getTopologyDimension);
+   cls.def("coordinates", [](const py::object& self, bool voronoi) {
+      const auto& view = self.cast<const SystemView&>();
+      const auto coordinates = view.coordinates(voronoi);
+      return readOnlyArray(coordinates, {py::ssize_t(coordinates.size() / view.getDimension()), view.getDimension()}, self);
+   }, "voronoi"_a = false);
+   cls.def("connectivity", [](const py::object& self, uint dim, bool voronoi) {
+      const auto ids = self.cast<const SystemView&>().connectivity(dim, voronoi);
+      return readOnlyArray(ids, {py::ssize_t(ids.size() / (dim + 1)), dim + 1}, self);
+   }, "dim"_a, "voronoi"_a = false);
+   cls.def_property_readonly("segment_names", [](const SystemView& view) {
+      vector<string> names;
+      for (size_t iseg = 0; iseg < view.getNumSegments(); ++iseg)
+         names.push_back(view.segmentName(iseg));
+      return names;
+   });
+   cls.def("segment_simplices", [](const py::object& self, size_t iseg, uint dim) {
+      const auto ids = self.cast<const SystemView&>().segmentSimplices(iseg, dim);
+      return readOnlyArray(ids, {py::ssize_t(ids.size())}, self);
+   }, "segment"_a, "dim"_a);
+   cls.def_property_readonly("interface_segments", [](const SystemView& view) {
+      vector<pair<ID, ID>> segments;
+      for (size_t iint = 0; iint < view.getNumInterfaces(); ++iint)
+         segments.push_back(view.interfaceSegments(iint));
+      return segments;
+   });
+   cls.def("interface_simplices", [](const py::object& self, size_t iint, uint dim) {
+      const auto ids = self.cast<const SystemView&>().interfaceSimplices(iint, dim);
+      return readOnlyArray(ids, {py::ssize_t(ids.size())}, self);
+   }, "interface"_a, "dim"_a);
 }
 
 PYBIND11_MODULE(pymesh, m) {
    py::class_<MeshElement>(m, "MeshElement")
-           .def_property_readonly("num_vertices", &MeshElement::getNumVertices)
-           .def_property_readonly("id", &MeshElement::getID)
-           .def("__getitem__", [](MeshElement *melm, size_t idx) { return (*melm)[idx]; }, py::is_operator(), rvp::reference_internal)
-           .def("__len__", &MeshElement::getNumVertices)
-           .def("point", py::overload_cast<size_t>(&MeshElement::getPoint, py::const_), rvp::reference_internal)
-           .def_property_readonly("points", &MeshElement::getPoints, rvp::move)
-           .def_property_readonly("center", &MeshElement::center, rvp::move);
+           .def_property_readonly("num_vertices", checked(&MeshElement::getNumVertices))
+           .def_property_readonly("id", checked(&MeshElement::getID))
+           .def("__getitem__", [](MeshElement *melm, size_t idx) {
+              Busy::check(Busy::key(*melm));
+              return (*melm)[idx];
+           }, py::is_operator(), rvp::reference_internal)
+           .def("__len__", checked(&MeshElement::getNumVertices))
+           .def("point", checked(py::overload_cast<size_t>(&MeshElement::getPoint, py::const_)), rvp::reference_internal)
+           .def_property_readonly("points", checked(&MeshElement::getPoints), rvp::move)
+           .def_property_readonly("center", checked(&MeshElement::center), rvp::move);
 
    py::class_<MeshElementsProxy>(m, "MeshElementsProxy")
-           .def("__len__", &MeshElementsProxy::size)
-           .def("__getitem__", [](MeshElementsProxy *obj, size_t idx) { return (*obj)[idx]; }, py::is_operator(), rvp::reference_internal)
+           .def("__len__", checked(&MeshElementsProxy::size))
+           .def("__getitem__", [](MeshElementsProxy *obj, size_t idx) {
+              Busy::check(Busy::key(*obj));
+              return (*obj)[idx];
+           }, py::is_operator(), rvp::reference_internal)
            .def("__iter__", [](MeshElementsProxy &obj) {
-              return py::make_iterator(obj.begin(), obj.end());
+              Busy::check(Busy::key(obj));
+              return py::make_iterator(CheckedIterator(obj.begin(), Busy::key(obj)),
+                                       CheckedIterator(obj.end(), Busy::key(obj)));
               },
                 py::keep_alive<0, 1>() /* Essential: keep object alive while iterator exists */)
-           .def("create", &MeshElementsProxy::create, rvp::reference_internal)
-           .def("add", py::overload_cast<const EigenDRef<const MatrixXid>&>(&MeshElementsProxy::add), rvp::reference_internal);
+           .def_property_readonly("connectivity", &connectivityArray)
+           .def_property_readonly("ids", [](const py::object& self) -> py::array {
+              // The IDs in the root mesh, a view for child meshes
+              const auto& proxy = self.cast<const MeshElementsProxy&>();
+              Busy::check(Busy::key(proxy));
+              if (const vector<ID>* ids = proxy.referencedIDs())
+                 return readOnlyArray(ids->data(), {py::ssize_t(ids->size())}, Busy::key(proxy), self);
+              py::array_t<ID> ids(py::ssize_t(proxy.size()));
+              iota(ids.mutable_data(), ids.mutable_data() + ids.size(), ID(0));
+              return ids;
+           })
+           .def("create", [](MeshElementsProxy& proxy, const vector<ID>& vertices) {
+              Exports::checkGrowth(Busy::key(proxy));
+              Busy busy({Busy::key(proxy.getMesh())});
+              return proxy.create(vertices);
+           }, rvp::reference_internal)
+           .def("add", [](MeshElementsProxy& proxy, const py::object& indices) -> MeshElementsProxy& {
+              visitArray<ID, int32_t>(indices, [&](const auto* data, size_t n, size_t k, ptrdiff_t row_stride,
+                                                   ptrdiff_t col_stride) {
+                 Exports::checkGrowth(Busy::key(proxy));
+                 withoutGil({Busy::key(proxy.getMesh())}, [&] { proxy.add(data, n, k, row_stride, col_stride); });
+              });
+              return proxy;
+           }, rvp::reference_internal, "indices"_a);
 
    py::class_<MeshBase>(m, "MeshBase")
-           .def_property_readonly("bodies", &MeshBase::bodies, rvp::reference_internal)
-           .def_property_readonly("facets", &MeshBase::facets, rvp::reference_internal)
-           .def_property_readonly("ridges", &MeshBase::ridges, rvp::reference_internal)
-           .def_property_readonly("peaks", &MeshBase::peaks, rvp::reference_internal)
-           .def_property_readonly("pointlist", py::overload_cast<>(&MeshBase::getPointList, py::const_), rvp::reference_internal);
+           .def_property_readonly("bodies", checked(&MeshBase::bodies), rvp::reference_internal)
+           .def_property_readonly("facets", checked(&MeshBase::facets), rvp::reference_internal)
+           .def_property_readonly("ridges", checked(&MeshBase::ridges), rvp::reference_internal)
+           .def_property_readonly("peaks", checked(&MeshBase::peaks), rvp::reference_internal)
+           .def_property_readonly("pointlist", [](const py::object& self) {
+              // Writable view of the coordinates, no points can be added to the mesh while it exists
+              const auto& mesh = self.cast<const MeshBase&>();
+              Busy::check(Busy::key(mesh));
+              vector<double>& points = mesh.getPointList();
+              const py::ssize_t dim = mesh.getDimension();
+              return py::array_t<double>({py::ssize_t(points.size()) / dim, dim}, points.data(),
+                                         Exports::base(Busy::key(mesh), self));
+           });
 
    declareSimplex<1, 0>(m);
    declareSimplex<2, 0>(m);
@@ -200,6 +1055,9 @@ PYBIND11_MODULE(pymesh, m) {
    declareMesh1D<3>(m);
    declareMesh2D<2>(m);
    declareMesh2D<3>(m);
+   declareMesh3D(m);
+
+   declareAttribute(m);
 
    declareSegment<1, 0>(m);
    declareSegment<2, 0>(m);
@@ -209,15 +1067,38 @@ PYBIND11_MODULE(pymesh, m) {
    declareSegment<3, 1>(m);
    declareSegment<2, 2>(m);
    declareSegment<3, 2>(m);
+   declareSegment<3, 3>(m);
 
    declareInterface<1, 1>(m);
    declareInterface<2, 1>(m);
    declareInterface<3, 1>(m);
    declareInterface<2, 2>(m);
    declareInterface<3, 2>(m);
+   declareInterface<3, 3>(m);
+
+   declareSystemView(m);
+   declareCheckpoint(m);
 
    declareSystem<1, 1>(m);
    declareSystem<2, 1>(m);
    declareSystem<2, 2>(m);
+   declareSystem<3, 3>(m);
+
+   // The mesh type follows from the dimension of the points and the kind of the element file
+   m.def("read_triangle_mesh", [](const string& node_path, const string& element_path) -> py::object {
+      const uint dim = withoutGil({}, [&] { return readNodes(node_path).dim; });
+      const string extension = element_path.substr(element_path.find_last_of('.') + 1);
+      const uint topdim = extension == "edge" ? 1 : (extension == "face" ? 2 : dim);
+      // The mesh is read without the GIL, only its conversion needs it
+      switch (10 * dim + topdim) {
+         case 11: return py::cast(withoutGil({}, [&] { return readTriangleMesh<1, 1>(node_path, element_path); }));
+         case 21: return py::cast(withoutGil({}, [&] { return readTriangleMesh<2, 1>(node_path, element_path); }));
+         case 22: return py::cast(withoutGil({}, [&] { return readTriangleMesh<2, 2>(node_path, element_path); }));
+         case 31: return py::cast(withoutGil({}, [&] { return readTriangleMesh<3, 1>(node_path, element_path); }));
+         case 32: return py::cast(withoutGil({}, [&] { return readTriangleMesh<3, 2>(node_path, element_path); }));
+         case 33: return py::cast(withoutGil({}, [&] { return readTriangleMesh<3, 3>(node_path, element_path); }));
+         default: throw runtime_error("Unsupported mesh dimensions");
+      }
+   }, "node_path"_a, "element_path"_a);
 
 }